@@ -165,10 +165,12 @@ int main()
 	while(platform::PollPlatformWindow(window))
 	{
 		glm::mat4 model(1.0f), view(1.0f), projection(1.0f);
-		platform::GetPlatformViewport(model, view, projection);
+		platform::GetPlatformViewport(window, model, view, projection);
 
 		// Get next drawable
 		render::Drawable *drawable = renderDevice->GetNextDrawable();
+		if(!drawable)
+			continue;
 
 		// Create command buffer
 		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
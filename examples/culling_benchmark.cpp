@@ -0,0 +1,104 @@
+#include <render_device/cpu_culling.h>
+#include <render_device/thread_pool.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Times CpuCullingPass over a million objects against a plain scalar loop
+
+static const unsigned int kObjectCount = 1000000;
+static const int kIterationCount = 20;
+
+// The straightforward array-of-structures test the pass is measured against
+static unsigned int CullScalar(render::CullBoundsType boundsType, const std::vector<glm::vec4> &bounds, const glm::vec4 planes[6], std::vector<unsigned int> &visibleIndices)
+{
+	visibleIndices.clear();
+	for(unsigned int i = 0; i < kObjectCount; i++)
+	{
+		bool inside = true;
+		for(int p = 0; p < 6 && inside; p++)
+		{
+			glm::vec3 normal(planes[p]);
+			if(boundsType == render::CULLBOUNDS_SPHERE)
+				inside = glm::dot(normal, glm::vec3(bounds[i])) + planes[p].w >= -bounds[i].w;
+			else
+			{
+				glm::vec3 boundsMin(bounds[i * 2]), boundsMax(bounds[i * 2 + 1]);
+				glm::vec3 corner(normal.x >= 0.0f ? boundsMax.x : boundsMin.x, normal.y >= 0.0f ? boundsMax.y : boundsMin.y, normal.z >= 0.0f ? boundsMax.z : boundsMin.z);
+				inside = glm::dot(normal, corner) + planes[p].w >= 0.0f;
+			}
+		}
+		if(inside)
+			visibleIndices.push_back(i);
+	}
+	return static_cast<unsigned int>(visibleIndices.size());
+}
+
+template<typename Function>
+static double TimeMilliseconds(Function function)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < kIterationCount; i++)
+		function();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / kIterationCount;
+}
+
+int main()
+{
+	// objects scattered through a 200 unit cube around a camera looking down -z
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	std::vector<glm::vec4> spheres(kObjectCount), boxes(kObjectCount * 2);
+	for(unsigned int i = 0; i < kObjectCount; i++)
+	{
+		glm::vec3 center(position(generator), position(generator), position(generator));
+		float radius = size(generator);
+		spheres[i] = glm::vec4(center, radius);
+		boxes[i * 2] = glm::vec4(center - glm::vec3(radius), 0.0f);
+		boxes[i * 2 + 1] = glm::vec4(center + glm::vec3(radius), 0.0f);
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f));
+	glm::vec4 planes[6];
+	render::ExtractFrustumPlanes(projection * view, planes);
+
+	render::ThreadPool threadPool;
+	printf("%u objects, %d iterations, %u worker threads\n", kObjectCount, kIterationCount, threadPool.GetThreadCount());
+
+	int result = 0;
+	for(int type = 0; type < 2; type++)
+	{
+		render::CullBoundsType boundsType = type == 0 ? render::CULLBOUNDS_SPHERE : render::CULLBOUNDS_AABB;
+		const std::vector<glm::vec4> &bounds = type == 0 ? spheres : boxes;
+
+		render::CpuCullingPass singleThreaded(boundsType);
+		render::CpuCullingPass multiThreaded(boundsType, &threadPool);
+		singleThreaded.SetBounds(bounds.data(), kObjectCount);
+		multiThreaded.SetBounds(bounds.data(), kObjectCount);
+
+		std::vector<unsigned int> scalarIndices, singleIndices, multiIndices;
+		double scalarTime = TimeMilliseconds([&] { CullScalar(boundsType, bounds, planes, scalarIndices); });
+		double singleTime = TimeMilliseconds([&] { singleThreaded.Cull(projection, view, singleIndices); });
+		double multiTime = TimeMilliseconds([&] { multiThreaded.Cull(projection, view, multiIndices); });
+
+		bool matches = scalarIndices == singleIndices && scalarIndices == multiIndices;
+		printf("%s: %zu visible%s\n", type == 0 ? "spheres" : "AABBs", scalarIndices.size(), matches ? "" : " (MISMATCH)");
+		printf("   scalar         %8.3f ms\n", scalarTime);
+		printf("   SIMD           %8.3f ms (%.1fx)\n", singleTime, scalarTime / singleTime);
+		printf("   SIMD + threads %8.3f ms (%.1fx)\n", multiTime, scalarTime / multiTime);
+
+		if(!matches)
+			result = 1;
+	}
+
+	return result;
+}
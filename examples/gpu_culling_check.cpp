@@ -0,0 +1,183 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+#include <render_device/gpu_culling.h>
+
+#include <cstdio>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Culls a row of small objects with GpuCullingPass on the headless platform and checks the
+// survivors against the ones known to lie inside the frustum, for spheres and boxes.
+//
+// Objects are centered every quarter unit along x from -25 to 24.75 with a half size of 0.1,
+// seen through an orthographic frustum spanning -10 to 10, so exactly those centered within
+// -10 to 10 survive.
+
+static const unsigned int kObjectCount = 200;
+static const unsigned int kFirstVisible = 60;
+static const unsigned int kLastVisible = 140;
+static const float kSpacing = 0.25f;
+static const float kHalfSize = 0.1f;
+
+// Copies the draw count and the indirect records into a row of texels the CPU can read back:
+// texel 0 holds the draw count, texel 1 + i the indexCount, instanceCount and baseInstance of record i
+static const char *readbackShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 64) in;\n"
+	"struct DrawArguments {\n"
+	"   uint indexCount;\n"
+	"   uint instanceCount;\n"
+	"   uint indexStart;\n"
+	"   int baseVertex;\n"
+	"   uint baseInstance;\n"
+	"};\n"
+	"layout(std430, binding = 0) readonly buffer VisibleBuffer {\n"
+	"   DrawArguments visibleArguments[];\n"
+	"};\n"
+	"layout(std430, binding = 1) readonly buffer DrawCountBuffer {\n"
+	"   uint drawCount;\n"
+	"};\n"
+	"layout(rgba32f, binding = 0) uniform writeonly image2D result;\n"
+	"void main()\n"
+	"{\n"
+	"   uint index = gl_GlobalInvocationID.x;\n"
+	"   if(index == 0u)\n"
+	"      imageStore(result, ivec2(0, 0), vec4(float(drawCount), 0.0, 0.0, 0.0));\n"
+	"   if(index < uint(imageSize(result).x - 1))\n"
+	"   {\n"
+	"      DrawArguments drawArguments = visibleArguments[index];\n"
+	"      imageStore(result, ivec2(int(index) + 1, 0), vec4(float(drawArguments.indexCount), float(drawArguments.instanceCount), float(drawArguments.baseInstance), 0.0));\n"
+	"   }\n"
+	"}\n";
+
+// Whether the survivors read back are exactly the objects inside the frustum, each once
+static bool CheckSurvivors(const float *texels, const char *boundsName)
+{
+	unsigned int expectedCount = kLastVisible - kFirstVisible + 1;
+	unsigned int drawCount = static_cast<unsigned int>(texels[0]);
+	if(drawCount != expectedCount)
+	{
+		printf("%s: %u visible, expected %u\n", boundsName, drawCount, expectedCount);
+		return false;
+	}
+
+	std::vector<bool> seen(kObjectCount, false);
+	for(unsigned int i = 0; i < kObjectCount; i++)
+	{
+		const float *record = texels + (i + 1) * 4;
+		unsigned int indexCount = static_cast<unsigned int>(record[0]);
+		unsigned int instanceCount = static_cast<unsigned int>(record[1]);
+		unsigned int objectIndex = static_cast<unsigned int>(record[2]);
+		if(i >= drawCount)
+		{
+			if(instanceCount != 0)
+			{
+				printf("%s: record %u past the draw count was not cleared\n", boundsName, i);
+				return false;
+			}
+			continue;
+		}
+
+		// each object's arguments carry its index plus one as the index count
+		if(objectIndex < kFirstVisible || objectIndex > kLastVisible || seen[objectIndex] || indexCount != objectIndex + 1 || instanceCount != 1)
+		{
+			printf("%s: record %u holds object %u (%u indices, %u instances)\n", boundsName, i, objectIndex, indexCount, instanceCount);
+			return false;
+		}
+		seen[objectIndex] = true;
+	}
+
+	printf("%s: %u of %u visible\n", boundsName, drawCount, kObjectCount);
+	return true;
+}
+
+int main()
+{
+	platform::InitPlatform(platform::PLATFORMTYPE_HEADLESS);
+	if(platform::GetPlatformType() != platform::PLATFORMTYPE_HEADLESS)
+	{
+		printf("The GPU culling check needs the headless platform\n");
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(16, 16, "GPU Culling Check");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+
+	render::Library *readbackLibrary = renderDevice->CreateLibrary(readbackShaderSource);
+	render::Function *readbackFunction = readbackLibrary->CreateFunction(render::FUNCTIONTYPE_COMPUTE, "main");
+	render::ComputePipelineState *readbackPipelineState = renderDevice->CreateComputePipelineState(readbackFunction);
+
+	std::vector<glm::vec4> spheres(kObjectCount), boxes(kObjectCount * 2);
+	std::vector<render::DrawIndexedIndirectArguments> arguments(kObjectCount);
+	for(unsigned int i = 0; i < kObjectCount; i++)
+	{
+		glm::vec3 center((static_cast<float>(i) - static_cast<float>(kObjectCount / 2)) * kSpacing, 0.0f, 0.0f);
+		spheres[i] = glm::vec4(center, kHalfSize);
+		boxes[i * 2] = glm::vec4(center - glm::vec3(kHalfSize), 0.0f);
+		boxes[i * 2 + 1] = glm::vec4(center + glm::vec3(kHalfSize), 0.0f);
+
+		arguments[i].indexCount = i + 1;
+		arguments[i].instanceCount = 1;
+		arguments[i].indexStart = 0;
+		arguments[i].baseVertex = 0;
+		arguments[i].baseInstance = 0;
+	}
+
+	render::Buffer *sphereBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_STORAGE, spheres.size() * sizeof(glm::vec4), spheres.data());
+	render::Buffer *boxBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_STORAGE, boxes.size() * sizeof(glm::vec4), boxes.data());
+	render::Buffer *argumentBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_STORAGE, arguments.size() * sizeof(render::DrawIndexedIndirectArguments), arguments.data());
+	render::Texture2D *result = renderDevice->CreateTexture2D(kObjectCount + 1, 1, render::PIXELFORMAT_RGBA32_FLOAT);
+
+	render::GpuCullingPass *cullingPass = new render::GpuCullingPass(renderDevice, kObjectCount);
+	glm::mat4 viewProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, -10.0f, 10.0f);
+
+	// boxes run second, so their survivors also show the first run's were cleared
+	bool passed = true;
+	for(int type = 0; type < 2; type++)
+	{
+		render::CullBoundsType boundsType = type == 0 ? render::CULLBOUNDS_SPHERE : render::CULLBOUNDS_AABB;
+
+		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+		render::ComputeCommandEncoder *encoder = commandBuffer->CreateComputeCommandEncoder();
+		cullingPass->Encode(encoder, viewProjection, boundsType, type == 0 ? sphereBuffer : boxBuffer, argumentBuffer, kObjectCount);
+		encoder->SetComputePipelineState(readbackPipelineState);
+		encoder->SetBuffer(cullingPass->GetIndirectBuffer(), 0, 0);
+		encoder->SetBuffer(cullingPass->GetDrawCountBuffer(), 0, 1);
+		encoder->SetStorageTexture(result, 0);
+		encoder->DispatchThreadgroups((kObjectCount + 63) / 64, 1, 1);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+
+		render::PixelReadback *readback = renderDevice->ReadPixelsAsync(result, 0, 0, kObjectCount + 1, 1, render::PIXELFORMAT_RGBA32_FLOAT);
+		passed = CheckSurvivors(static_cast<const float *>(readback->GetData()), type == 0 ? "spheres" : "boxes") && passed;
+		renderDevice->DestroyPixelReadback(readback);
+
+		delete encoder;
+		delete commandBuffer;
+	}
+
+	delete cullingPass;
+	renderDevice->DestroyTexture2D(result);
+	renderDevice->DestroyBuffer(argumentBuffer);
+	renderDevice->DestroyBuffer(boxBuffer);
+	renderDevice->DestroyBuffer(sphereBuffer);
+	renderDevice->DestroyComputePipelineState(readbackPipelineState);
+	readbackLibrary->DestroyFunction(readbackFunction);
+	renderDevice->DestroyLibrary(readbackLibrary);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::TerminatePlatform();
+
+	printf("%s\n", passed ? "PASS" : "FAIL");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+#include <render_device/hiz_pyramid.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Builds a HiZPyramidPass pyramid from noisy depths on the headless platform, reads every
+// level back and compares it to the same farthest/nearest reduction done on the CPU.
+//
+// The 300x200 depth maps onto a 256x128 pyramid of nine levels, so the first level reduces
+// uneven footprints, the last threadgroup writes the levels past the sixth, and the ninth
+// level takes a second dispatch.
+
+static const int kDepthWidth = 300;
+static const int kDepthHeight = 200;
+
+// Copies one pyramid level into the lower left corner of an image the CPU can read back
+static const char *copyShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 8, local_size_y = 8) in;\n"
+	"layout(binding = 0) uniform sampler2D pyramid;\n"
+	"layout(rg32f, binding = 0) uniform writeonly image2D result;\n"
+	"layout(std140, binding = 0) uniform CopyParams {\n"
+	"   int level;\n"
+	"};\n"
+	"void main()\n"
+	"{\n"
+	"   ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+	"   if(all(lessThan(texel, textureSize(pyramid, level))))\n"
+	"      imageStore(result, texel, vec4(texelFetch(pyramid, texel, level).rg, 0.0, 0.0));\n"
+	"}\n";
+
+// Matches the std140 CopyParams block above
+struct CopyParams
+{
+	int level;
+	int padding[3];
+};
+
+// Farthest and nearest depth per texel, as the pyramid stores them
+struct DepthRange
+{
+	float farthest;
+	float nearest;
+};
+
+// The pyramid levels reduced on the CPU: level 0 covers every depth texel each pyramid
+// texel overlaps, and each further level the 2x2 texels below it, clamped at the edge
+static std::vector<std::vector<DepthRange>> ReducePyramid(const std::vector<float> &depths, int pyramidWidth, int pyramidHeight, int levelCount)
+{
+	std::vector<std::vector<DepthRange>> levels(levelCount);
+
+	levels[0].resize(pyramidWidth * pyramidHeight);
+	for(int y = 0; y < pyramidHeight; y++)
+		for(int x = 0; x < pyramidWidth; x++)
+		{
+			DepthRange range = { 0.0f, 1.0f };
+			for(int depthY = y * kDepthHeight / pyramidHeight; depthY < ((y + 1) * kDepthHeight + pyramidHeight - 1) / pyramidHeight; depthY++)
+				for(int depthX = x * kDepthWidth / pyramidWidth; depthX < ((x + 1) * kDepthWidth + pyramidWidth - 1) / pyramidWidth; depthX++)
+				{
+					float depth = depths[depthY * kDepthWidth + depthX];
+					range.farthest = std::max(range.farthest, depth);
+					range.nearest = std::min(range.nearest, depth);
+				}
+			levels[0][y * pyramidWidth + x] = range;
+		}
+
+	for(int level = 1; level < levelCount; level++)
+	{
+		int sourceWidth = std::max(pyramidWidth >> (level - 1), 1), sourceHeight = std::max(pyramidHeight >> (level - 1), 1);
+		int width = std::max(pyramidWidth >> level, 1), height = std::max(pyramidHeight >> level, 1);
+		levels[level].resize(width * height);
+		for(int y = 0; y < height; y++)
+			for(int x = 0; x < width; x++)
+			{
+				DepthRange range = { 0.0f, 1.0f };
+				for(int i = 0; i < 4; i++)
+				{
+					int sourceX = std::min(x * 2 + (i & 1), sourceWidth - 1), sourceY = std::min(y * 2 + (i >> 1), sourceHeight - 1);
+					const DepthRange &source = levels[level - 1][sourceY * sourceWidth + sourceX];
+					range.farthest = std::max(range.farthest, source.farthest);
+					range.nearest = std::min(range.nearest, source.nearest);
+				}
+				levels[level][y * width + x] = range;
+			}
+	}
+	return levels;
+}
+
+int main()
+{
+	platform::InitPlatform(platform::PLATFORMTYPE_HEADLESS);
+	if(platform::GetPlatformType() != platform::PLATFORMTYPE_HEADLESS)
+	{
+		printf("The Hi-Z pyramid check needs the headless platform\n");
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(16, 16, "Hi-Z Pyramid Check");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+
+	render::Library *copyLibrary = renderDevice->CreateLibrary(copyShaderSource);
+	render::Function *copyFunction = copyLibrary->CreateFunction(render::FUNCTIONTYPE_COMPUTE, "main");
+	render::ComputePipelineState *copyPipelineState = renderDevice->CreateComputePipelineState(copyFunction);
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	// a diagonal slope with some noise, so texels of every level cover different ranges
+	std::vector<float> depths(kDepthWidth * kDepthHeight);
+	for(int y = 0; y < kDepthHeight; y++)
+		for(int x = 0; x < kDepthWidth; x++)
+			depths[y * kDepthWidth + x] = 0.9f * static_cast<float>(x + 2 * y) / static_cast<float>(kDepthWidth + 2 * kDepthHeight) + 0.1f * distribution(generator);
+
+	render::Texture2D *depthTexture = renderDevice->CreateTexture2D(kDepthWidth, kDepthHeight, render::PIXELFORMAT_R32_FLOAT, 1, depths.data());
+	render::HiZPyramidPass *pyramidPass = new render::HiZPyramidPass(renderDevice, kDepthWidth, kDepthHeight);
+
+	render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+	render::ComputeCommandEncoder *encoder = commandBuffer->CreateComputeCommandEncoder();
+	pyramidPass->Encode(encoder, depthTexture);
+	encoder->EndEncoding();
+	commandBuffer->Commit();
+	delete encoder;
+	delete commandBuffer;
+
+	// the pyramid's level 0 is the largest power of two not above the depth size
+	int pyramidWidth = 1, pyramidHeight = 1;
+	while(pyramidWidth * 2 <= kDepthWidth)
+		pyramidWidth *= 2;
+	while(pyramidHeight * 2 <= kDepthHeight)
+		pyramidHeight *= 2;
+
+	int levelCount = pyramidPass->GetMipLevelCount();
+	std::vector<std::vector<DepthRange>> expected = ReducePyramid(depths, pyramidWidth, pyramidHeight, levelCount);
+	render::Texture2D *result = renderDevice->CreateTexture2D(pyramidWidth, pyramidHeight, render::PIXELFORMAT_RG32_FLOAT);
+
+	bool passed = true;
+	for(int level = 0; level < levelCount; level++)
+	{
+		int width = std::max(pyramidWidth >> level, 1), height = std::max(pyramidHeight >> level, 1);
+
+		CopyParams params = {};
+		params.level = level;
+
+		commandBuffer = commandQueue->CreateCommandBuffer();
+		encoder = commandBuffer->CreateComputeCommandEncoder();
+		encoder->SetComputePipelineState(copyPipelineState);
+		encoder->SetTexture(pyramidPass->GetPyramidTexture(), 0);
+		encoder->SetStorageTexture(result, 0);
+		encoder->SetBytes(&params, sizeof(params), 0);
+		encoder->DispatchThreadgroups((width + 7) / 8, (height + 7) / 8, 1);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+
+		render::PixelReadback *readback = renderDevice->ReadPixelsAsync(result, 0, 0, width, height, render::PIXELFORMAT_RG32_FLOAT);
+		const DepthRange *ranges = static_cast<const DepthRange *>(readback->GetData());
+		int mismatchCount = 0;
+		for(int i = 0; i < width * height; i++)
+		{
+			if(ranges[i].farthest != expected[level][i].farthest || ranges[i].nearest != expected[level][i].nearest)
+			{
+				if(mismatchCount == 0)
+					printf("level %d texel (%d, %d): %f %f, expected %f %f\n", level, i % width, i / width,
+						ranges[i].farthest, ranges[i].nearest, expected[level][i].farthest, expected[level][i].nearest);
+				mismatchCount++;
+			}
+		}
+		printf("level %d: %dx%d, %d mismatches\n", level, width, height, mismatchCount);
+		passed = passed && mismatchCount == 0;
+		renderDevice->DestroyPixelReadback(readback);
+
+		delete encoder;
+		delete commandBuffer;
+	}
+
+	renderDevice->DestroyTexture2D(result);
+	delete pyramidPass;
+	renderDevice->DestroyTexture2D(depthTexture);
+	renderDevice->DestroyComputePipelineState(copyPipelineState);
+	copyLibrary->DestroyFunction(copyFunction);
+	renderDevice->DestroyLibrary(copyLibrary);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::TerminatePlatform();
+
+	printf("%s\n", passed ? "PASS" : "FAIL");
+	return passed ? 0 : 1;
+}
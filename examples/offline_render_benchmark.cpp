@@ -0,0 +1,179 @@
+#include <render_device/frame_pipeline.h>
+#include <render_device/image_writer.h>
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Renders the same sequence of frames to image files twice: with the synchronous render,
+// read back, encode loop, and with a FramePipeline overlapping the three. Prints frames
+// per second and how busy each pipeline stage was.
+//
+// usage: offline_render_benchmark [frameCount] [png | qoi | raw] [outputDirectory]
+
+static const int kWidth = 1280;
+static const int kHeight = 720;
+
+static const char *vertexShaderSource = "#version 430 core\n"
+	"layout(std140, binding = 0) uniform FrameParams {\n"
+	"   mat4 uModelViewProjection;\n"
+	"};\n"
+	"layout (location = 0) in vec2 aPos;\n"
+	"out vec2 Position;\n"
+	"void main()\n"
+	"{\n"
+	"   gl_Position = uModelViewProjection * vec4(aPos, 0.0, 1.0);\n"
+	"   Position = aPos;\n"
+	"}\n";
+
+static const char *fragmentShaderSource = "#version 430 core\n"
+	"in vec2 Position;\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"   float rings = 0.5 + 0.5 * sin(length(Position) * 24.0);\n"
+	"   FragColor = vec4(rings, 0.5 + 0.5 * Position.x, 0.5 + 0.5 * Position.y, 1.0);\n"
+	"}\n";
+
+struct Scene
+{
+	render::RenderPipelineState *pipelineState;
+	render::Buffer *vertexBuffer;
+};
+
+// a spinning quad, different in every frame so no two files are alike
+static void DrawFrame(const Scene &scene, render::RenderCommandEncoder *encoder, uint64_t frameIndex)
+{
+	glm::mat4 modelViewProjection = glm::perspective(glm::radians(45.0f), static_cast<float>(kWidth) / kHeight, 0.1f, 10.0f);
+	modelViewProjection = glm::translate(modelViewProjection, glm::vec3(0.0f, 0.0f, -2.5f));
+	modelViewProjection = glm::rotate(modelViewProjection, glm::radians(3.0f * frameIndex), glm::vec3(0.3f, 0.4f, 1.0f));
+
+	encoder->SetRenderPipelineState(scene.pipelineState);
+	encoder->SetVertexBuffer(scene.vertexBuffer, 0, 0);
+	encoder->SetVertexBytes(glm::value_ptr(modelViewProjection), sizeof(modelViewProjection), 0);
+	encoder->Draw(render::PRIMITIVETYPE_TRIANGLESTRIP, 0, 4);
+}
+
+// What the example loop does today: every stage waits for the one before it
+static double RunSynchronous(render::RenderDevice *renderDevice, render::CommandQueue *commandQueue, const Scene &scene,
+	int frameCount, render::ImageFileFormat format, const std::string &pathFormat)
+{
+	render::Texture2D *colorTexture = renderDevice->CreateTexture2D(kWidth, kHeight, render::PIXELFORMAT_RGBA8_UNORM);
+	render::RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = colorTexture;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(int frameIndex = 0; frameIndex < frameCount; frameIndex++)
+	{
+		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+		render::RenderCommandEncoder *encoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+		DrawFrame(scene, encoder, frameIndex);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+		delete encoder;
+		delete commandBuffer;
+
+		render::PixelReadback *readback = renderDevice->ReadPixelsAsync(colorTexture, 0, 0, kWidth, kHeight);
+		const unsigned char *pixels = static_cast<const unsigned char *>(readback->GetData());
+
+		char path[1024];
+		snprintf(path, sizeof(path), pathFormat.c_str(), static_cast<unsigned long long>(frameIndex));
+		render::ImageStreamWriter *writer = render::ImageStreamWriter::Create(path, format, kWidth, kHeight);
+		if(writer)
+		{
+			writer->WriteRows(pixels + kWidth * 4 * (kHeight - 1), -kWidth * 4, kHeight);
+			writer->Finish();
+			delete writer;
+		}
+		renderDevice->DestroyPixelReadback(readback);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	renderDevice->DestroyTexture2D(colorTexture);
+	return frameCount / elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+	int frameCount = argc > 1 ? atoi(argv[1]) : 120;
+	const char *formatName = argc > 2 ? argv[2] : "png";
+	std::string directory = argc > 3 ? argv[3] : ".";
+
+	render::ImageFileFormat format = render::IMAGEFILEFORMAT_PNG;
+	if(strcmp(formatName, "qoi") == 0)
+		format = render::IMAGEFILEFORMAT_QOI;
+	else if(strcmp(formatName, "raw") == 0)
+		format = render::IMAGEFILEFORMAT_RAW;
+	std::string pathFormat = directory + "/frame_%05llu." + formatName;
+
+	platform::InitPlatform();
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(kWidth / 4, kHeight / 4, "Offline Render Benchmark");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+	render::Library *library = renderDevice->CreateLibrary(vertexShaderSource, fragmentShaderSource);
+	render::Function *vertexFunction = library->CreateFunction(render::FUNCTIONTYPE_VERTEX, "main");
+	render::Function *fragmentFunction = library->CreateFunction(render::FUNCTIONTYPE_FRAGMENT, "main");
+
+	render::VertexAttribute attributes[] = { { render::VERTEXATTRIBUTEFORMAT_FLOAT32X2, 0, 0 } };
+	render::VertexBufferLayout layout;
+	layout.arrayStride = sizeof(float) * 2;
+	layout.attributeCount = 1;
+	layout.attributes = attributes;
+	render::VertexDescriptor *vertexDescriptor = renderDevice->CreateVertexDescriptor(layout);
+
+	float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	Scene scene;
+	scene.pipelineState = renderDevice->CreateRenderPipelineState(vertexFunction, fragmentFunction, vertexDescriptor, false);
+	scene.vertexBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_VERTEX, sizeof(vertices), vertices);
+
+	printf("%d frames of %dx%d as %s into %s\n", frameCount, kWidth, kHeight, formatName, directory.c_str());
+
+	double synchronousFramesPerSecond = RunSynchronous(renderDevice, commandQueue, scene, frameCount, format, pathFormat);
+	printf("  synchronous loop: %7.1f frames/s\n", synchronousFramesPerSecond);
+
+	render::FramePipeline *framePipeline = new render::FramePipeline(renderDevice, kWidth, kHeight, format);
+	bool written = framePipeline->Run(commandQueue, frameCount, pathFormat.c_str(), [&](render::RenderCommandEncoder *encoder, uint64_t frameIndex)
+	{
+		DrawFrame(scene, encoder, frameIndex);
+	});
+
+	const render::FramePipelineStatistics &statistics = framePipeline->GetStatistics();
+	double pipelineFramesPerSecond = statistics.framesRendered / statistics.wallSeconds;
+	printf("  frame pipeline:   %7.1f frames/s (%.2fx), %u encode threads%s\n", pipelineFramesPerSecond,
+		pipelineFramesPerSecond / synchronousFramesPerSecond, statistics.encodeThreadCount, written ? "" : ", some frames failed to write");
+	printf("    render   %5.1f%% busy\n", 100.0 * statistics.GetRenderOccupancy());
+	printf("    readback %5.1f%% waiting\n", 100.0 * statistics.GetReadbackOccupancy());
+	printf("    encode   %5.1f%% busy per thread, %.1f frames queued on average, %u at most\n", 100.0 * statistics.GetEncodeOccupancy(),
+		statistics.averageQueuedFrames, statistics.maxQueuedFrames);
+	printf("    stalled  %5.1f%% waiting for the encoders\n", 100.0 * statistics.queueWaitSeconds / statistics.wallSeconds);
+
+	delete framePipeline;
+
+	renderDevice->DestroyBuffer(scene.vertexBuffer);
+	renderDevice->DestroyRenderPipelineState(scene.pipelineState);
+	renderDevice->DestroyVertexDescriptor(vertexDescriptor);
+	library->DestroyFunction(fragmentFunction);
+	library->DestroyFunction(vertexFunction);
+	renderDevice->DestroyLibrary(library);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::TerminatePlatform();
+
+	return 0;
+}
@@ -0,0 +1,234 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Measures headless render jobs per second with 1, 2, 4, ... threads, each driving its own
+// context and render device, up to one thread per core. A job draws overlapping shaded
+// quads into an offscreen target and reads the result back.
+//
+// Every context uses a single llvmpipe rasterizer thread (LP_NUM_THREADS=1 unless already
+// set), so the scaling comes from the contexts rather than from the driver.
+
+static const int kTargetSize = 512;
+static const int kQuadsPerJob = 64;
+static const double kSecondsPerRun = 2.0;
+
+static const char *vertexShaderSource = "#version 430 core\n"
+	"layout (location = 0) in vec2 aPos;\n"
+	"layout (std140, binding = 0) uniform JobParams {\n"
+	"   vec4 offset;\n"
+	"};\n"
+	"void main()\n"
+	"{\n"
+	"   gl_Position = vec4(aPos * 0.75 + offset.xy, 0.0, 1.0);\n"
+	"}\n";
+
+// enough shading per fragment that the jobs are bound by rasterization, not submission
+static const char *fragmentShaderSource = "#version 430 core\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"   float value = 0.0;\n"
+	"   for(int i = 1; i <= 8; i++)\n"
+	"      value += sin(dot(gl_FragCoord.xy, vec2(0.011, 0.017) * float(i)));\n"
+	"   FragColor = vec4(fract(value), gl_FragCoord.xy / 512.0, 1.0);\n"
+	"}\n";
+
+struct Worker
+{
+	platform::PLATFORM_WINDOW_REF window = nullptr;
+	render::RenderDevice *renderDevice = nullptr;
+	render::CommandQueue *commandQueue = nullptr;
+	render::Library *library = nullptr;
+	render::Function *vertexFunction = nullptr;
+	render::Function *fragmentFunction = nullptr;
+	render::VertexDescriptor *vertexDescriptor = nullptr;
+	render::RenderPipelineState *pipelineState = nullptr;
+	render::Buffer *vertexBuffer = nullptr;
+	render::Texture2D *target = nullptr;
+};
+
+// Everything a job needs, created once per thread so only rendering is timed
+static bool CreateWorker(Worker &worker)
+{
+	worker.window = platform::CreatePlatformWindow(kTargetSize, kTargetSize, "Parallel Render Benchmark");
+	if(!worker.window)
+		return false;
+
+	worker.renderDevice = render::CreateRenderDevice();
+	worker.commandQueue = worker.renderDevice->CreateCommandQueue();
+	worker.library = worker.renderDevice->CreateLibrary(vertexShaderSource, fragmentShaderSource);
+	worker.vertexFunction = worker.library->CreateFunction(render::FUNCTIONTYPE_VERTEX, "main");
+	worker.fragmentFunction = worker.library->CreateFunction(render::FUNCTIONTYPE_FRAGMENT, "main");
+
+	render::VertexAttribute attributes[] = { { render::VERTEXATTRIBUTEFORMAT_FLOAT32X2, 0, 0 } };
+	render::VertexBufferLayout layout;
+	layout.arrayStride = sizeof(float) * 2;
+	layout.attributeCount = 1;
+	layout.attributes = attributes;
+	worker.vertexDescriptor = worker.renderDevice->CreateVertexDescriptor(layout);
+	worker.pipelineState = worker.renderDevice->CreateRenderPipelineState(worker.vertexFunction, worker.fragmentFunction, worker.vertexDescriptor, false);
+
+	float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	worker.vertexBuffer = worker.renderDevice->CreateBuffer(render::BUFFERTYPE_VERTEX, sizeof(vertices), vertices);
+	worker.target = worker.renderDevice->CreateTexture2D(kTargetSize, kTargetSize, render::PIXELFORMAT_RGBA8_UNORM);
+	return true;
+}
+
+static void RunJob(Worker &worker, int jobIndex)
+{
+	render::CommandBuffer *commandBuffer = worker.commandQueue->CreateCommandBuffer();
+
+	render::RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = worker.target;
+	render::RenderCommandEncoder *encoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+	encoder->SetRenderPipelineState(worker.pipelineState);
+	encoder->SetVertexBuffer(worker.vertexBuffer, 0, 0);
+	for(int i = 0; i < kQuadsPerJob; i++)
+	{
+		float angle = static_cast<float>(jobIndex * kQuadsPerJob + i) * 0.1f;
+		float offset[4] = { std::sin(angle) * 0.25f, std::cos(angle) * 0.25f, 0.0f, 0.0f };
+		encoder->SetVertexBytes(offset, sizeof(offset), 0);
+		encoder->Draw(render::PRIMITIVETYPE_TRIANGLESTRIP, 0, 4);
+	}
+	encoder->EndEncoding();
+	commandBuffer->Commit();
+
+	render::PixelReadback *readback = worker.renderDevice->ReadPixelsAsync(worker.target, 0, 0, kTargetSize, kTargetSize);
+	readback->GetData();
+	worker.renderDevice->DestroyPixelReadback(readback);
+
+	delete encoder;
+	delete commandBuffer;
+}
+
+static void DestroyWorker(Worker &worker)
+{
+	worker.renderDevice->DestroyTexture2D(worker.target);
+	worker.renderDevice->DestroyBuffer(worker.vertexBuffer);
+	worker.renderDevice->DestroyRenderPipelineState(worker.pipelineState);
+	worker.renderDevice->DestroyVertexDescriptor(worker.vertexDescriptor);
+	worker.library->DestroyFunction(worker.fragmentFunction);
+	worker.library->DestroyFunction(worker.vertexFunction);
+	worker.renderDevice->DestroyLibrary(worker.library);
+	worker.renderDevice->DestroyCommandQueue(worker.commandQueue);
+	render::DestroyRenderDevice(worker.renderDevice);
+
+	platform::MakePlatformWindowCurrent(nullptr);
+}
+
+// A device has a drawable to hand out only while one of its windows is current
+static bool CheckDrawableNeedsWindow()
+{
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(kTargetSize, kTargetSize, "Parallel Render Benchmark");
+	if(!window)
+		return false;
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::Drawable *drawable = renderDevice->GetNextDrawable();
+	bool passed = drawable != nullptr;
+	renderDevice->DestroyDrawable(drawable);
+
+	platform::MakePlatformWindowCurrent(nullptr);
+	drawable = renderDevice->GetNextDrawable();
+	passed = passed && drawable == nullptr;
+	renderDevice->DestroyDrawable(drawable);
+
+	platform::MakePlatformWindowCurrent(window);
+	render::DestroyRenderDevice(renderDevice);
+	platform::MakePlatformWindowCurrent(nullptr);
+	return passed;
+}
+
+// Jobs per second with threadCount threads rendering at once
+static double MeasureJobsPerSecond(unsigned int threadCount)
+{
+	std::atomic<unsigned int> readyCount(0);
+	std::atomic<bool> start(false), stop(false);
+	std::atomic<unsigned long long> jobCount(0);
+
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			Worker worker;
+			bool created = CreateWorker(worker);
+			readyCount++;
+			while(!start)
+				std::this_thread::yield();
+
+			unsigned long long jobs = 0;
+			while(created && !stop)
+				RunJob(worker, static_cast<int>(jobs++));
+			jobCount += jobs;
+
+			if(created)
+				DestroyWorker(worker);
+		}));
+	}
+
+	while(readyCount < threadCount)
+		std::this_thread::yield();
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	start = true;
+	std::this_thread::sleep_for(std::chrono::duration<double>(kSecondsPerRun));
+	stop = true;
+	for(std::thread &thread : threads)
+		thread.join();
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+
+	return static_cast<double>(jobCount) / elapsed.count();
+}
+
+int main()
+{
+#if !defined(_WIN32)
+	setenv("LP_NUM_THREADS", "1", 0);
+#endif
+
+	platform::InitPlatform(platform::PLATFORMTYPE_HEADLESS);
+	if(platform::GetPlatformType() != platform::PLATFORMTYPE_HEADLESS)
+	{
+		printf("Parallel rendering needs the headless platform\n");
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	if(!CheckDrawableNeedsWindow())
+	{
+		printf("Drawable check failed\n");
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	unsigned int coreCount = std::thread::hardware_concurrency();
+	if(coreCount == 0)
+		coreCount = 1;
+
+	printf("%dx%d target, %d quads per job, %u cores\n", kTargetSize, kTargetSize, kQuadsPerJob, coreCount);
+
+	double singleThreaded = 0.0;
+	for(unsigned int threadCount = 1; ; threadCount = threadCount * 2 < coreCount ? threadCount * 2 : coreCount)
+	{
+		double jobsPerSecond = MeasureJobsPerSecond(threadCount);
+		if(threadCount == 1)
+			singleThreaded = jobsPerSecond;
+		printf("  %2u threads: %8.1f jobs/s (%.2fx)\n", threadCount, jobsPerSecond, jobsPerSecond / singleThreaded);
+
+		if(threadCount == coreCount)
+			break;
+	}
+
+	platform::TerminatePlatform();
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Times creating a set of distinct render pipelines through the pipeline cache: the first
+// run compiles and stores them, later runs load them. Then builds them again with the cache
+// off and checks that the cached pipelines render what the compiled ones do.
+//
+// Drivers keep shader caches of their own, which also speed up a second run. Mesa builds
+// program binaries on its cache, so rather than disabling it point MESA_SHADER_CACHE_DIR
+// at an empty directory for each run.
+//
+// usage: pipeline_cache_benchmark [pipelineCount] [cacheDirectory]
+
+static const int kSize = 16;
+
+static const char *vertexShaderSource = "#version 410 core\n"
+	"layout (location = 0) in vec2 aPos;\n"
+	"out vec2 Position;\n"
+	"void main()\n"
+	"{\n"
+	"   gl_Position = vec4(aPos, 0.0, 1.0);\n"
+	"   Position = aPos;\n"
+	"}\n";
+
+// a fragment shader with enough arithmetic to take the compiler a while, different per variant
+static std::string MakeFragmentShaderSource(int variant)
+{
+	char header[128];
+	snprintf(header, sizeof(header), "#version 410 core\n#define VARIANT %d\n", variant);
+	return std::string(header) +
+		"in vec2 Position;\n"
+		"out vec4 FragColor;\n"
+		"void main()\n"
+		"{\n"
+		"   vec3 color = vec3(0.0);\n"
+		"   vec2 p = Position * (1.0 + 0.1 * float(VARIANT));\n"
+		"   for(int i = 0; i < 8; i++)\n"
+		"   {\n"
+		"      p = vec2(p.x * p.x - p.y * p.y, 2.0 * p.x * p.y) + vec2(0.25, 0.1 * float(VARIANT % 7));\n"
+		"      color += 0.1 * vec3(sin(p.x * 3.0), cos(p.y * 5.0), sin(length(p) * 7.0));\n"
+		"   }\n"
+		"   FragColor = vec4(clamp(abs(color), 0.0, 1.0), 1.0);\n"
+		"}\n";
+}
+
+// Create every pipeline, draw a frame with each and return the seconds creation took
+static double CreateAndDraw(render::RenderDevice *renderDevice, render::CommandQueue *commandQueue, int pipelineCount,
+	render::Texture2D *colorTexture, std::vector<unsigned int> &pixels)
+{
+	render::VertexAttribute attributes[] = { { render::VERTEXATTRIBUTEFORMAT_FLOAT32X2, 0, 0 } };
+	render::VertexBufferLayout layout;
+	layout.arrayStride = sizeof(float) * 2;
+	layout.attributeCount = 1;
+	layout.attributes = attributes;
+	render::VertexDescriptor *vertexDescriptor = renderDevice->CreateVertexDescriptor(layout);
+
+	float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	render::Buffer *vertexBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_VERTEX, sizeof(vertices), vertices);
+
+	std::vector<render::Library *> libraries;
+	std::vector<render::Function *> functions;
+	std::vector<render::RenderPipelineState *> pipelineStates;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < pipelineCount; i++)
+	{
+		std::string fragmentShaderSource = MakeFragmentShaderSource(i);
+		render::Library *library = renderDevice->CreateLibrary(vertexShaderSource, fragmentShaderSource.c_str());
+		render::Function *vertexFunction = library->CreateFunction(render::FUNCTIONTYPE_VERTEX, "main");
+		render::Function *fragmentFunction = library->CreateFunction(render::FUNCTIONTYPE_FRAGMENT, "main");
+		pipelineStates.push_back(renderDevice->CreateRenderPipelineState(vertexFunction, fragmentFunction, vertexDescriptor, false));
+
+		libraries.push_back(library);
+		functions.push_back(vertexFunction);
+		functions.push_back(fragmentFunction);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	// the center pixel of every pipeline's frame
+	render::RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = colorTexture;
+	pixels.clear();
+	for(render::RenderPipelineState *pipelineState : pipelineStates)
+	{
+		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+		render::RenderCommandEncoder *encoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+		encoder->SetRenderPipelineState(pipelineState);
+		encoder->SetVertexBuffer(vertexBuffer, 0, 0);
+		encoder->Draw(render::PRIMITIVETYPE_TRIANGLESTRIP, 0, 4);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+		delete encoder;
+		delete commandBuffer;
+
+		render::PixelReadback *readback = renderDevice->ReadPixelsAsync(colorTexture, kSize / 2, kSize / 2, 1, 1);
+		pixels.push_back(*static_cast<const unsigned int *>(readback->GetData()));
+		renderDevice->DestroyPixelReadback(readback);
+	}
+
+	for(render::RenderPipelineState *pipelineState : pipelineStates)
+		renderDevice->DestroyRenderPipelineState(pipelineState);
+	for(size_t i = 0; i < libraries.size(); i++)
+	{
+		libraries[i]->DestroyFunction(functions[2 * i + 1]);
+		libraries[i]->DestroyFunction(functions[2 * i]);
+		renderDevice->DestroyLibrary(libraries[i]);
+	}
+	renderDevice->DestroyBuffer(vertexBuffer);
+	renderDevice->DestroyVertexDescriptor(vertexDescriptor);
+
+	return elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+	int pipelineCount = argc > 1 ? atoi(argv[1]) : 64;
+	const char *cacheDirectory = argc > 2 ? argv[2] : "pipeline_cache";
+
+	platform::InitPlatform();
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(kSize, kSize, "Pipeline Cache Benchmark");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+	render::Texture2D *colorTexture = renderDevice->CreateTexture2D(kSize, kSize, render::PIXELFORMAT_RGBA8_UNORM);
+
+	printf("%d pipelines, cached in %s\n", pipelineCount, cacheDirectory);
+
+	std::vector<unsigned int> cachedPixels, compiledPixels;
+
+	renderDevice->SetPipelineCacheDirectory(cacheDirectory);
+	double cachedSeconds = CreateAndDraw(renderDevice, commandQueue, pipelineCount, colorTexture, cachedPixels);
+	printf("  created in %.2f ms; a second run loads them from the cache\n", 1000.0 * cachedSeconds);
+
+	renderDevice->SetPipelineCacheDirectory(nullptr);
+	CreateAndDraw(renderDevice, commandQueue, pipelineCount, colorTexture, compiledPixels);
+
+	bool identical = cachedPixels == compiledPixels;
+	printf("  %s\n", identical ? "cached pipelines render the same as compiled ones" : "cached pipelines render differently");
+
+	renderDevice->DestroyTexture2D(colorTexture);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::TerminatePlatform();
+
+	return identical ? 0 : -1;
+}
@@ -0,0 +1,161 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+#include <render_device/tiled_renderer.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Renders a field of cubes into an image far larger than a texture, a tile at a time,
+// streaming it to disk as it goes.
+//
+// usage: poster [width] [height] [output.png | output.raw]
+
+static const int kCubesPerSide = 12;
+
+static const char *vertexShaderSource = "#version 430 core\n"
+	"layout(std140, binding = 0) uniform CubeParams {\n"
+	"   mat4 uModelViewProjection;\n"
+	"};\n"
+	"layout (location = 0) in vec3 aPos;\n"
+	"layout (location = 1) in vec3 aColor;\n"
+	"out vec3 FragColor3;\n"
+	"void main()\n"
+	"{\n"
+	"   gl_Position = uModelViewProjection * vec4(aPos, 1.0);\n"
+	"   FragColor3 = aColor;\n"
+	"}\n";
+
+static const char *fragmentShaderSource = "#version 430 core\n"
+	"in vec3 FragColor3;\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"   FragColor = vec4(FragColor3, 1.0);\n"
+	"}\n";
+
+struct Vertex
+{
+	float x, y, z;
+	float r, g, b;
+};
+
+// two counter-clockwise triangles per face, shaded by which way the face points
+static std::vector<Vertex> MakeCubeVertices()
+{
+	std::vector<Vertex> vertices;
+	for(int face = 0; face < 6; face++)
+	{
+		int axis = face / 2;
+		float side = face % 2 ? -0.5f : 0.5f;
+		float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+		int order[6] = { 0, 1, 2, 0, 2, 3 };
+		float shade = 0.55f + 0.15f * face / 2.0f;
+		for(int i = 0; i < 6; i++)
+		{
+			const float *corner = corners[side > 0.0f ? order[i] : order[5 - i]];
+			float position[3];
+			position[axis] = side;
+			position[(axis + 1) % 3] = corner[0];
+			position[(axis + 2) % 3] = corner[1];
+			Vertex vertex = { position[0], position[1], position[2], shade, shade * 0.8f, 1.0f - shade * 0.5f };
+			vertices.push_back(vertex);
+		}
+	}
+	return vertices;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t width = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 16384;
+	uint32_t height = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 16384;
+	const char *path = argc > 3 ? argv[3] : "poster.png";
+	size_t pathLength = strlen(path);
+	render::ImageFileFormat format = pathLength > 4 && strcmp(path + pathLength - 4, ".raw") == 0 ? render::IMAGEFILEFORMAT_RAW : render::IMAGEFILEFORMAT_PNG;
+
+	platform::InitPlatform();
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(256, 256, "Poster");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+	render::Library *library = renderDevice->CreateLibrary(vertexShaderSource, fragmentShaderSource);
+	render::Function *vertexFunction = library->CreateFunction(render::FUNCTIONTYPE_VERTEX, "main");
+	render::Function *fragmentFunction = library->CreateFunction(render::FUNCTIONTYPE_FRAGMENT, "main");
+
+	render::VertexAttribute vertexAttributes[] = {
+		{ render::VERTEXATTRIBUTEFORMAT_FLOAT32X3, 0, 0 },
+		{ render::VERTEXATTRIBUTEFORMAT_FLOAT32X3, 12, 1 },
+	};
+	render::VertexBufferLayout vertexBufferLayout;
+	vertexBufferLayout.arrayStride = sizeof(Vertex);
+	vertexBufferLayout.attributeCount = 2;
+	vertexBufferLayout.attributes = vertexAttributes;
+	render::VertexDescriptor *vertexDescriptor = renderDevice->CreateVertexDescriptor(vertexBufferLayout);
+	render::RenderPipelineState *pipelineState = renderDevice->CreateRenderPipelineState(vertexFunction, fragmentFunction, vertexDescriptor);
+	render::DepthStencilState *depthStencilState = renderDevice->CreateDepthStencilState(true, true);
+
+	std::vector<Vertex> cubeVertices = MakeCubeVertices();
+	render::Buffer *vertexBuffer = renderDevice->CreateBuffer(render::BUFFERTYPE_VERTEX, sizeof(Vertex) * cubeVertices.size(), cubeVertices.data());
+
+	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -kCubesPerSide * 1.6f));
+	view = glm::rotate(view, glm::radians(35.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(width) / height, 1.0f, 100.0f);
+
+	render::TiledRenderer *tiledRenderer = new render::TiledRenderer(renderDevice);
+	tiledRenderer->SetClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+
+	printf("Rendering %ux%u in %dx%d tiles to %s\n", width, height, tiledRenderer->GetTileWidth(), tiledRenderer->GetTileHeight(), path);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	bool rendered = tiledRenderer->Render(commandQueue, path, format, width, height, projection,
+		[&](render::RenderCommandEncoder *encoder, const glm::mat4 &tileProjection)
+	{
+		encoder->SetRenderPipelineState(pipelineState);
+		encoder->SetDepthStencilState(depthStencilState);
+		encoder->SetVertexBuffer(vertexBuffer, 0, 0);
+		for(int z = 0; z < kCubesPerSide; z++)
+		{
+			for(int x = 0; x < kCubesPerSide; x++)
+			{
+				glm::vec3 position((x - (kCubesPerSide - 1) * 0.5f) * 1.8f, 0.0f, (z - (kCubesPerSide - 1) * 0.5f) * 1.8f);
+				glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), position), glm::radians(7.5f * (x + z)), glm::vec3(0.0f, 1.0f, 0.0f));
+				glm::mat4 modelViewProjection = tileProjection * view * model;
+				encoder->SetVertexBytes(glm::value_ptr(modelViewProjection), sizeof(modelViewProjection), 0);
+				encoder->Draw(render::PRIMITIVETYPE_TRIANGLE, 0, static_cast<unsigned int>(cubeVertices.size()));
+			}
+		}
+	});
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	if(rendered)
+		printf("Done in %.1f s\n", elapsed.count());
+	else
+		printf("Failed to write %s\n", path);
+
+	delete tiledRenderer;
+	renderDevice->DestroyBuffer(vertexBuffer);
+	renderDevice->DestroyDepthStencilState(depthStencilState);
+	renderDevice->DestroyRenderPipelineState(pipelineState);
+	renderDevice->DestroyVertexDescriptor(vertexDescriptor);
+	library->DestroyFunction(fragmentFunction);
+	library->DestroyFunction(vertexFunction);
+	renderDevice->DestroyLibrary(library);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::TerminatePlatform();
+
+	return rendered ? 0 : -1;
+}
@@ -88,6 +88,8 @@ int main()
 	{
 		// Get next drawable
 		render::Drawable *drawable = renderDevice->GetNextDrawable();
+		if(!drawable)
+			continue;
 
 		// Create command buffer
 		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
@@ -0,0 +1,156 @@
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+#include <render_device/thread_pool.h>
+#include <render_device/yuv_conversion.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Times getting a 1080p frame to the CPU as NV12: converted on the GPU before readback,
+// against an RGBA8 readback converted by ConvertRgbaToYuv and by a plain scalar loop
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+static const int kIterationCount = 50;
+
+// The straightforward per pixel conversion the SIMD path is measured against
+static void ConvertScalar(const unsigned char *rgba, int width, int height, unsigned char *yuv)
+{
+	unsigned char *uv = yuv + width * height;
+	for(int y = 0; y < height; y++)
+	{
+		// bottom-up source, top-down frame
+		const unsigned char *row = rgba + (height - 1 - y) * width * 4;
+		for(int x = 0; x < width; x++)
+		{
+			const unsigned char *p = row + x * 4;
+			yuv[y * width + x] = static_cast<unsigned char>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+		}
+	}
+	for(int y = 0; y < height; y += 2)
+	{
+		const unsigned char *row0 = rgba + (height - 1 - y) * width * 4;
+		const unsigned char *row1 = row0 - width * 4;
+		for(int x = 0; x < width; x += 2)
+		{
+			int r = (row0[x * 4] + row0[x * 4 + 4] + row1[x * 4] + row1[x * 4 + 4] + 2) >> 2;
+			int g = (row0[x * 4 + 1] + row0[x * 4 + 5] + row1[x * 4 + 1] + row1[x * 4 + 5] + 2) >> 2;
+			int b = (row0[x * 4 + 2] + row0[x * 4 + 6] + row1[x * 4 + 2] + row1[x * 4 + 6] + 2) >> 2;
+			uv[(y / 2) * width + x] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			uv[(y / 2) * width + x + 1] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+}
+
+template<typename Function>
+static double TimeMilliseconds(Function function)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < kIterationCount; i++)
+		function();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / kIterationCount;
+}
+
+static size_t CountMismatches(const std::vector<unsigned char> &a, const unsigned char *b)
+{
+	size_t count = 0;
+	for(size_t i = 0; i < a.size(); i++)
+		count += a[i] != b[i];
+	return count;
+}
+
+int main()
+{
+	platform::InitPlatform();
+
+	platform::PLATFORM_WINDOW_REF window = platform::CreatePlatformWindow(kWidth / 4, kHeight / 4, "YUV Benchmark");
+	if(!window)
+	{
+		platform::TerminatePlatform();
+		return -1;
+	}
+
+	render::RenderDevice *renderDevice = render::CreateRenderDevice();
+	render::CommandQueue *commandQueue = renderDevice->CreateCommandQueue();
+
+	// noise over a gradient, so neither the chroma averaging nor the rounding sees a flat image
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<int> noise(0, 63);
+	std::vector<unsigned char> pixels(kWidth * kHeight * 4);
+	for(int y = 0; y < kHeight; y++)
+	{
+		for(int x = 0; x < kWidth; x++)
+		{
+			unsigned char *p = &pixels[(y * kWidth + x) * 4];
+			p[0] = static_cast<unsigned char>(x * 192 / kWidth + noise(generator));
+			p[1] = static_cast<unsigned char>(y * 192 / kHeight + noise(generator));
+			p[2] = static_cast<unsigned char>(noise(generator) * 4);
+			p[3] = 255;
+		}
+	}
+	render::Texture2D *colorTexture = renderDevice->CreateTexture2D(kWidth, kHeight, render::PIXELFORMAT_RGBA8_UNORM, 1, pixels.data());
+
+	render::YuvConversionPass *yuvConversionPass = new render::YuvConversionPass(renderDevice, kWidth, kHeight, render::YUVLAYOUT_NV12);
+	render::ThreadPool threadPool;
+
+	std::vector<unsigned char> referenceFrame(render::GetYuvFrameSize(kWidth, kHeight));
+	std::vector<unsigned char> frame(referenceFrame.size());
+	ConvertScalar(pixels.data(), kWidth, kHeight, referenceFrame.data());
+
+	// returns the mismatched bytes against the scalar reference when asked to compare
+	std::function<size_t(bool)> convertOnGpu = [&](bool compare)
+	{
+		render::CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+		render::ComputeCommandEncoder *encoder = commandBuffer->CreateComputeCommandEncoder();
+		yuvConversionPass->Encode(encoder, colorTexture);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+
+		render::PixelReadback *readback = yuvConversionPass->ReadAsync();
+		const unsigned char *data = static_cast<const unsigned char *>(readback->GetData());
+		size_t mismatches = compare ? CountMismatches(referenceFrame, data) : 0;
+		renderDevice->DestroyPixelReadback(readback);
+
+		delete encoder;
+		delete commandBuffer;
+		return mismatches;
+	};
+	size_t gpuMismatches = convertOnGpu(true);
+	double gpuTime = TimeMilliseconds([&]() { convertOnGpu(false); });
+
+	// readback alone, then the CPU conversions on top of it
+	double readbackTime = TimeMilliseconds([&]()
+	{
+		render::PixelReadback *readback = renderDevice->ReadPixelsAsync(colorTexture, 0, 0, kWidth, kHeight);
+		readback->GetData();
+		renderDevice->DestroyPixelReadback(readback);
+	});
+
+	const unsigned char *lastRow = pixels.data() + (kHeight - 1) * kWidth * 4;
+	double scalarTime = TimeMilliseconds([&]() { ConvertScalar(pixels.data(), kWidth, kHeight, frame.data()); });
+	double simdTime = TimeMilliseconds([&]() { render::ConvertRgbaToYuv(lastRow, -kWidth * 4, kWidth, kHeight, render::YUVLAYOUT_NV12, frame.data()); });
+	size_t simdMismatches = CountMismatches(referenceFrame, frame.data());
+	double threadedTime = TimeMilliseconds([&]() { render::ConvertRgbaToYuv(lastRow, -kWidth * 4, kWidth, kHeight, render::YUVLAYOUT_NV12, frame.data(), &threadPool); });
+
+	printf("%dx%d NV12, %d iterations, %u worker threads\n", kWidth, kHeight, kIterationCount, threadPool.GetThreadCount());
+	printf("  readback bytes: RGBA8 %zu, NV12 %zu\n", pixels.size(), referenceFrame.size());
+	printf("  GPU convert + NV12 readback: %8.3f ms (%zu mismatched bytes)\n", gpuTime, gpuMismatches);
+	printf("  RGBA8 readback + scalar:     %8.3f ms\n", readbackTime + scalarTime);
+	printf("  RGBA8 readback + SIMD:       %8.3f ms (%zu mismatched bytes)\n", readbackTime + simdTime, simdMismatches);
+	printf("  RGBA8 readback + SIMD x%u:    %8.3f ms\n", threadPool.GetThreadCount() + 1, readbackTime + threadedTime);
+	printf("  conversion only: scalar %.3f ms, SIMD %.3f ms (%.1fx)\n", scalarTime, simdTime, scalarTime / simdTime);
+
+	delete yuvConversionPass;
+	renderDevice->DestroyTexture2D(colorTexture);
+	renderDevice->DestroyCommandQueue(commandQueue);
+	render::DestroyRenderDevice(renderDevice);
+
+	platform::ClosePlatformWindow(window);
+	platform::TerminatePlatform();
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "render_device/culling.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace render
+{
+
+class ThreadPool;
+
+// Culls objects on the CPU against the view frustum, for deployments without a GPU
+// culling pass. Bounds are transposed into structure-of-arrays form and tested eight
+// objects at a time with AVX2 or four with SSE2 or NEON, whichever the build targets,
+// in chunks spread across an optional ThreadPool.
+//
+// The result is a list of visible object indices in ascending order, ready to drive
+// per-object draws or to fill DrawIndexedIndirectArguments for an indirect draw.
+class CpuCullingPass
+{
+public:
+
+	// threadPool may be null to cull on the calling thread only
+	CpuCullingPass(CullBoundsType boundsType, ThreadPool *threadPool = nullptr);
+
+	// Replace the bounds with objectCount objects laid out per CullBoundsType, the same
+	// layout GpuCullingPass reads from its bounds buffer
+	void SetBounds(const glm::vec4 *bounds, unsigned int objectCount);
+
+	// Update the bounds of a single object
+	void SetObjectBounds(unsigned int objectIndex, const glm::vec4 *bounds);
+
+	unsigned int GetObjectCount() const { return m_ObjectCount; }
+
+	// Fill visibleIndices with the objects inside the frustum of projection * view, as
+	// returned by platform::GetPlatformViewport; returns the visible count
+	unsigned int Cull(const glm::mat4 &projection, const glm::mat4 &view, std::vector<unsigned int> &visibleIndices);
+
+private:
+
+	void CullChunk(unsigned int chunkIndex, const glm::vec4 planes[6]);
+
+	CullBoundsType m_BoundsType;
+	ThreadPool *m_ThreadPool = nullptr;
+	unsigned int m_ObjectCount = 0;
+
+	// sphere: center x, y, z and radius; AABB: min x, y, z and max x, y, z.
+	// Padded to a whole batch so the last one loads in bounds.
+	std::vector<float> m_Components[6];
+
+	// per chunk visible indices, concatenated in order once every chunk is done
+	std::vector<std::vector<unsigned int>> m_ChunkVisibleIndices;
+	std::vector<unsigned int> m_ChunkVisibleCounts;
+};
+
+} // end namespace render
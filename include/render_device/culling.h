@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace render
+{
+
+// Bounding volume layout of the objects handed to a GpuCullingPass or CpuCullingPass
+enum CullBoundsType
+{
+	CULLBOUNDS_SPHERE = 0, // one vec4 per object: center.xyz, radius
+	CULLBOUNDS_AABB = 1 // two vec4 per object: min.xyz, max.xyz (w unused)
+};
+
+// Extract the normalized frustum planes (left, right, bottom, top, near, far) of a view-projection
+// matrix; a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+void ExtractFrustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]);
+
+} // end namespace render
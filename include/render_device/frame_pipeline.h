@@ -0,0 +1,98 @@
+#pragma once
+
+#include "render_device/image_writer.h"
+#include "render_device/render_device.h"
+#include "render_device/thread_pool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace render
+{
+
+// Where the time of a FramePipeline::Run went. Occupancy is a stage's busy time over the
+// run's wall time, per thread for encoding; the queue depths count frames handed to the
+// encoders and not yet written.
+struct FramePipelineStatistics
+{
+	uint64_t framesRendered = 0;
+	uint64_t framesWritten = 0;
+	uint64_t framesFailed = 0;
+
+	double wallSeconds = 0.0;
+	double renderSeconds = 0.0; // recording and submitting draws
+	double readbackWaitSeconds = 0.0; // waiting for the previous frame's pixels
+	double queueWaitSeconds = 0.0; // waiting for the encoders to free a slot
+	double encodeSeconds = 0.0; // encoding and writing, summed over the encode threads
+
+	unsigned int encodeThreadCount = 0;
+	unsigned int maxQueuedFrames = 0;
+	double averageQueuedFrames = 0.0; // sampled once per rendered frame
+
+	double GetRenderOccupancy() const { return wallSeconds > 0.0 ? renderSeconds / wallSeconds : 0.0; }
+
+	double GetReadbackOccupancy() const { return wallSeconds > 0.0 ? readbackWaitSeconds / wallSeconds : 0.0; }
+
+	double GetEncodeOccupancy() const { return wallSeconds > 0.0 && encodeThreadCount > 0 ? encodeSeconds / (wallSeconds * encodeThreadCount) : 0.0; }
+};
+
+// Renders a sequence of frames offline and writes each to its own image file, keeping
+// the GPU, the readback and the encoders busy at once.
+//
+// While frame N renders, frame N-1 is read back and frames N-2 and earlier are encoded on
+// a thread pool. Frames go from the readback to the encoders without a copy: an encoder
+// reads the readback's mapped pixels, and the readback is only released, on the render
+// thread, once the frame is written. At most maxQueuedFrames frames wait for or are being
+// encoded; when the encoders fall that far behind, rendering waits for them.
+class FramePipeline
+{
+public:
+
+	// Record frame frameIndex's draws into an encoder on the frame's target
+	typedef std::function<void(RenderCommandEncoder *encoder, uint64_t frameIndex)> DrawFunction;
+
+	// encodeThreadCount of 0 uses one thread per hardware thread, less the render thread
+	FramePipeline(RenderDevice *renderDevice, int width, int height, ImageFileFormat format, unsigned int encodeThreadCount = 0, unsigned int maxQueuedFrames = 8);
+
+	~FramePipeline();
+
+	void SetClearColor(float red, float green, float blue, float alpha);
+
+	// Render frames [0, frameCount) and write frame i to the path pathFormat makes of i as
+	// an unsigned long long, e.g. "frame_%05llu.png"; false if any frame failed to write
+	bool Run(CommandQueue *commandQueue, uint64_t frameCount, const char *pathFormat, const DrawFunction &draw);
+
+	// Statistics of the last Run
+	const FramePipelineStatistics &GetStatistics() const { return m_Statistics; }
+
+private:
+
+	// Wait until fewer than maxQueuedFrames frames are queued for encoding, then release the
+	// readbacks of the frames written so far
+	void ReleaseWrittenFrames(unsigned int maxQueuedFrames);
+
+	RenderDevice *m_RenderDevice = nullptr;
+
+	int m_Width = 0;
+	int m_Height = 0;
+	ImageFileFormat m_Format;
+	unsigned int m_MaxQueuedFrames = 0;
+	float m_ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	Texture2D *m_ColorTexture = nullptr;
+	Texture2D *m_DepthTexture = nullptr;
+
+	ThreadPool m_EncodeThreadPool;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_FrameWritten;
+	std::deque<PixelReadback *> m_WrittenFrames; // encoded, waiting to be released
+	unsigned int m_QueuedFrameCount = 0;
+
+	FramePipelineStatistics m_Statistics;
+};
+
+} // end namespace render
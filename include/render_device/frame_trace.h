@@ -0,0 +1,74 @@
+#pragma once
+
+// CPU zones of every thread and the GPU timings of each render device, kept for the last
+// frames and written as Chrome Trace Event JSON, which chrome://tracing and the Perfetto UI
+// open as a timeline.
+//
+// Zones are recorded with the macros below, which compile to nothing unless the library and
+// the application are built with RENDER_DEVICE_TRACE (the RENDERDEVICE_TRACE CMake option).
+// Each thread records into a ring of its own, written without locks or allocation, so a zone
+// costs two clock reads; only a thread's first zone takes a lock, to register its ring. The
+// ring holds the thread's last kTraceEventCapacity zones, older ones being overwritten.
+//
+// Zone names are kept by pointer and must outlive the trace, as string literals do.
+
+#ifdef RENDER_DEVICE_TRACE
+#define RENDER_TRACE_CONCAT_(a, b) a##b
+#define RENDER_TRACE_CONCAT(a, b) RENDER_TRACE_CONCAT_(a, b)
+// A zone from here to the end of the scope
+#define RENDER_TRACE_ZONE(name) render::TraceZone RENDER_TRACE_CONCAT(traceZone, __LINE__)(name)
+// A zone ended by RENDER_TRACE_END on the same thread, for spans wider than a scope
+#define RENDER_TRACE_BEGIN(name) render::BeginTraceZone(name)
+#define RENDER_TRACE_END() render::EndTraceZone()
+// The end of a frame on this thread, bounding the frames WriteFrameTrace writes
+#define RENDER_TRACE_FRAME() render::MarkTraceFrame()
+// The name of this thread's track in the timeline
+#define RENDER_TRACE_THREAD_NAME(name) render::SetTraceThreadName(name)
+#else
+#define RENDER_TRACE_ZONE(name) ((void)0)
+#define RENDER_TRACE_BEGIN(name) ((void)0)
+#define RENDER_TRACE_END() ((void)0)
+#define RENDER_TRACE_FRAME() ((void)0)
+#define RENDER_TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+namespace render
+{
+
+// Zones kept per thread at most
+static const unsigned int kTraceEventCapacity = 65536;
+
+// Nanoseconds of the clock zones are timed with, from the first time it is read
+unsigned long long GetTraceTime();
+
+void BeginTraceZone(const char *name);
+
+void EndTraceZone();
+
+void MarkTraceFrame();
+
+void SetTraceThreadName(const char *name);
+
+// Record a zone of GPU work, timed already and converted to the trace's clock, on the GPU
+// track of this thread; the name is copied
+void AddGpuTraceZone(const char *name, unsigned int depth, unsigned long long beginNanoseconds, unsigned long long endNanoseconds);
+
+// Write the zones of the last frameCount frames to a JSON file, or every zone kept when no
+// frame has been marked. Frames are those of the thread that marked one last. Returns false
+// when the file cannot be written.
+bool WriteFrameTrace(const char *path, unsigned int frameCount);
+
+// Times its scope as a zone
+class TraceZone
+{
+public:
+
+	explicit TraceZone(const char *name) { BeginTraceZone(name); }
+
+	~TraceZone() { EndTraceZone(); }
+
+	TraceZone(const TraceZone &) = delete;
+	TraceZone &operator=(const TraceZone &) = delete;
+};
+
+} // end namespace render
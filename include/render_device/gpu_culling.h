@@ -0,0 +1,60 @@
+#pragma once
+
+#include "render_device/render_device.h"
+#include "render_device/culling.h"
+
+#include <glm/glm.hpp>
+
+namespace render
+{
+
+// Culls objects on the GPU against the view frustum and, optionally, a hierarchical-Z
+// depth pyramid, then compacts the draw arguments of the survivors into an indirect
+// buffer for RenderCommandEncoder::DrawIndexedIndirect.
+//
+// Each object supplies a DrawIndexedIndirectArguments record; surviving records are
+// copied in no particular order with baseInstance overwritten by the object index, so
+// shaders can fetch per-object data through an instanced attribute or gl_BaseInstance.
+class GpuCullingPass
+{
+public:
+
+	GpuCullingPass(RenderDevice *renderDevice, unsigned int maxObjectCount);
+
+	~GpuCullingPass();
+
+	// Record the culling dispatches for objectCount objects (at most maxObjectCount).
+	//
+	// bounds and drawArguments are storage buffers laid out per CullBoundsType and as
+	// DrawIndexedIndirectArguments respectively. hiZ, when set, is a depth pyramid whose
+	// red channel holds the farthest depth of the texels each mip covers, rendered with
+	// viewProjection; objects entirely behind it are culled as occluded.
+	void Encode(ComputeCommandEncoder *encoder, const glm::mat4 &viewProjection, CullBoundsType boundsType,
+		Buffer *bounds, Buffer *drawArguments, unsigned int objectCount, Texture2D *hiZ = nullptr);
+
+	// Survivors' DrawIndexedIndirectArguments, packed first; the remaining records have an instanceCount of 0
+	Buffer *GetIndirectBuffer() const { return m_IndirectBuffer; }
+
+	// A single unsigned int holding the number of survivors, usable as a GPU-sourced draw count
+	Buffer *GetDrawCountBuffer() const { return m_DrawCountBuffer; }
+
+	unsigned int GetMaxDrawCount() const { return m_MaxObjectCount; }
+
+private:
+
+	RenderDevice *m_RenderDevice = nullptr;
+	unsigned int m_MaxObjectCount = 0;
+
+	Library *m_ClearLibrary = nullptr;
+	Function *m_ClearFunction = nullptr;
+	ComputePipelineState *m_ClearPipelineState = nullptr;
+
+	Library *m_CullLibrary = nullptr;
+	Function *m_CullFunction = nullptr;
+	ComputePipelineState *m_CullPipelineState = nullptr;
+
+	Buffer *m_IndirectBuffer = nullptr;
+	Buffer *m_DrawCountBuffer = nullptr;
+};
+
+} // end namespace render
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+namespace render
+{
+
+// Builds a hierarchical-Z pyramid from a depth texture with a compute downsample.
+//
+// The pyramid is a PIXELFORMAT_RG32_FLOAT texture with a full mip chain whose level 0
+// is the largest power of two not above the depth size on each axis. Every texel holds
+// the farthest (red) and nearest (green) depth of the depth texels it covers, so it can
+// be sampled directly by occlusion tests such as GpuCullingPass.
+//
+// Each dispatch reduces a 32x32 tile per threadgroup through six levels in shared
+// memory, and the last threadgroup to finish writes the remaining levels. A dispatch
+// binds at most 8 levels (the image unit count OpenGL 4.3 guarantees), so pyramids
+// up to 128x128 take a single pass and larger ones one more pass per 8 levels.
+class HiZPyramidPass
+{
+public:
+
+	HiZPyramidPass(RenderDevice *renderDevice, int depthWidth, int depthHeight);
+
+	~HiZPyramidPass();
+
+	// Record the downsample of depthTexture, which must match the size given at creation
+	void Encode(ComputeCommandEncoder *encoder, Texture2D *depthTexture);
+
+	Texture2D *GetPyramidTexture() const { return m_PyramidTexture; }
+
+	int GetMipLevelCount() const { return m_MipLevelCount; }
+
+private:
+
+	RenderDevice *m_RenderDevice = nullptr;
+
+	int m_DepthWidth = 0;
+	int m_DepthHeight = 0;
+	int m_PyramidWidth = 0;
+	int m_PyramidHeight = 0;
+	int m_MipLevelCount = 0;
+
+	Library *m_Library = nullptr;
+	Function *m_Function = nullptr;
+	ComputePipelineState *m_PipelineState = nullptr;
+
+	Texture2D *m_PyramidTexture = nullptr;
+	Buffer *m_CounterBuffer = nullptr;
+};
+
+} // end namespace render
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace render
+{
+
+enum ImageFileFormat
+{
+	IMAGEFILEFORMAT_PNG, // 8 bit RGBA PNG
+	IMAGEFILEFORMAT_RAW, // headerless RGBA8 rows, top row first
+	IMAGEFILEFORMAT_QOI, // "Quite OK Image" RGBA, several times faster to encode than PNG
+};
+
+// Writes an RGBA8 image to disk a band of rows at a time, top row first, so an image far
+// larger than memory can be produced as it is rendered. Only the rows of the current call
+// are held; PNG rows are filtered and deflated as they arrive and leave as IDAT chunks,
+// QOI pixels are encoded as they arrive.
+// PNGs are compressed with zlib when the build found it (RENDER_DEVICE_HAS_ZLIB), and
+// written as stored deflate blocks otherwise.
+class ImageStreamWriter
+{
+public:
+
+	// Open path and write the format's header; returns null on failure
+	static ImageStreamWriter *Create(const char *path, ImageFileFormat format, uint32_t width, uint32_t height);
+
+	// Finishes the file if Finish was not called
+	~ImageStreamWriter();
+
+	// Append rowCount rows; rows points at the top one and stride is the byte offset to the
+	// next, negative for bottom-up data such as a PixelReadback. False on a write error.
+	bool WriteRows(const unsigned char *rows, ptrdiff_t stride, uint32_t rowCount);
+
+	// Write the trailer and close the file; false if any write failed or rows are missing
+	bool Finish();
+
+	uint32_t GetWidth() const { return m_Width; }
+
+	uint32_t GetHeight() const { return m_Height; }
+
+	uint32_t GetRowsWritten() const { return m_RowsWritten; }
+
+private:
+
+	ImageStreamWriter() {}
+
+	bool WriteChunk(const char type[4], const unsigned char *data, size_t size);
+
+	// Compress PNG scanline bytes into the IDAT stream; last ends the stream
+	void Deflate(const unsigned char *data, size_t size, bool last);
+
+	// Encode QOI pixels, carrying runs and the color index across calls
+	void EncodeQoi(const unsigned char *pixels, uint32_t pixelCount);
+
+	// Append encoded bytes, writing them out (as an IDAT chunk for PNG) each time the buffer fills
+	void Emit(const unsigned char *data, size_t size);
+
+	void FlushOutput();
+
+	FILE *m_File = nullptr;
+	ImageFileFormat m_Format = IMAGEFILEFORMAT_PNG;
+	uint32_t m_Width = 0;
+	uint32_t m_Height = 0;
+	uint32_t m_RowsWritten = 0;
+	bool m_Failed = false;
+
+	unsigned char *m_FilteredRow = nullptr;
+	unsigned char *m_OutputBuffer = nullptr;
+	size_t m_OutputBufferUsed = 0;
+
+	void *m_DeflateStream = nullptr; // z_stream, with zlib
+
+	unsigned char *m_StoredBlock = nullptr; // without zlib
+	size_t m_StoredBlockUsed = 0;
+	uint32_t m_Adler = 1;
+
+	unsigned char m_QoiIndex[64][4] = {};
+	unsigned char m_QoiPrevious[4] = { 0, 0, 0, 255 };
+	unsigned int m_QoiRun = 0;
+};
+
+} // end namespace render
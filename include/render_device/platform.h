@@ -9,16 +9,57 @@ namespace platform
 
 typedef void *PLATFORM_WINDOW_REF;
 
-void InitPlatform();
+// Where windows and their OpenGL contexts come from
+enum PlatformType
+{
+	PLATFORMTYPE_AUTO = 0, // RENDER_DEVICE_PLATFORM=windowed|headless if set, else headless when no display is available
+	PLATFORMTYPE_WINDOWED = 1, // GLFW windows presented on a display
+	PLATFORMTYPE_HEADLESS = 2, // EGL contexts without a display (EGL_MESA_platform_surfaceless or a pbuffer); drawables are offscreen textures
+};
+
+void InitPlatform(PlatformType platformType = PLATFORMTYPE_AUTO);
+
+// The platform InitPlatform settled on
+PlatformType GetPlatformType();
 
+// Create a window and make its OpenGL context current on the calling thread. Headless
+// windows are independent contexts that may be created and driven from any thread, one
+// render device per thread, so jobs can render in parallel; windowed ones belong to the
+// main thread.
 PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title);
 
+// Create an OpenGL context sharing objects with the window's, with no drawable of its own
+// and current on no thread, for a worker thread to make current. Like windows, it lives
+// until the platform is terminated. Null when the platform cannot share contexts.
+PLATFORM_WINDOW_REF CreatePlatformSharedContext(PLATFORM_WINDOW_REF window);
+
 bool PollPlatformWindow(PLATFORM_WINDOW_REF window);
 
+// Make the next PollPlatformWindow return false
+void ClosePlatformWindow(PLATFORM_WINDOW_REF window);
+
+// The window whose OpenGL context is current on the calling thread
+PLATFORM_WINDOW_REF GetCurrentPlatformWindow();
+
+// Make the window's OpenGL context current on the calling thread, or release the current
+// one when window is null. A context is current on at most one thread, and a thread should
+// release its context before it exits.
+void MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window);
+
+// Size in pixels of the window's drawable
+void GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height);
+
+// Camera of the window: its trackball rotation and zoom, and a projection matching its aspect ratio
+void GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection);
+
+// Camera of the window current on the calling thread
 void GetPlatformViewport(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection);
 
 void PresentPlatformWindow(PLATFORM_WINDOW_REF window);
 
+// Address of an OpenGL entry point in the current context
+void *GetPlatformProcAddress(const char *name);
+
 void TerminatePlatform();
 
 } // end namespace platform
@@ -9,7 +9,8 @@ namespace render
 enum FunctionType
 {
 	FUNCTIONTYPE_VERTEX,
-	FUNCTIONTYPE_FRAGMENT
+	FUNCTIONTYPE_FRAGMENT,
+	FUNCTIONTYPE_COMPUTE
 };
 
 // Encapsulates a function
@@ -26,6 +27,13 @@ protected:
 	Function(const FunctionType& functionType, const char *code) {}
 };
 
+// A specialization constant of a function, by its constant_id
+struct FunctionConstant
+{
+	unsigned int constantId;
+	unsigned int value; // the bits of the constant, whatever its type
+};
+
 // Encapsulates a library
 class Library
 {
@@ -34,15 +42,42 @@ public:
 	// virtual destructor to ensure subclasses have a virtual destructor
 	virtual ~Library() {}
 
-	// Create a shader from the supplied code; code is assumed to be GLSL for now.
+	// Create a shader from the supplied code; code is assumed to be GLSL for now. For a library
+	// of entry points, look up the one of this type named code; null if there is none.
 	virtual Function *CreateFunction(const FunctionType& functionType, const char *code) = 0;
 
+	// Create a function specialized with the constants. SPIR-V entry points take them as
+	// specialization constants; GLSL sees each as RENDER_DEVICE_CONSTANT_<id> defined to its value.
+	virtual Function *CreateFunction(const FunctionType& functionType, const char *name, const FunctionConstant *constants, unsigned int constantCount) = 0;
+
+	// Name the feature keywords variants are made of, at most 64; bit i of a variant mask
+	// stands for keywords[i]
+	virtual void SetVariantKeywords(const char *const *keywords, unsigned int keywordCount) = 0;
+
+	// Create the function of a variant: GLSL sees the keywords of the mask's set bits defined
+	// to 1, a SPIR-V entry point each keyword's bit as the specialization constant of id i.
+	// A variant's source is made once; it is compiled when first used and shared while used.
+	virtual Function *CreateFunctionVariant(const FunctionType& functionType, const char *name, unsigned long long variantMask) = 0;
+
 	// Destroy a shader
 	virtual void DestroyFunction(Function *function) = 0;
 
 protected:
 	// protected default constructor to ensure these are never created directly
 	Library(const char *vertexShaderSource, const char *fragmentShaderSource) {}
+
+	// protected default constructor to ensure these are never created directly
+	Library(const char *computeShaderSource) {}
+
+	// protected default constructor to ensure these are never created directly
+	Library() {}
+};
+
+// Names a function in the shared source of a library of entry points
+struct LibraryEntryPoint
+{
+	FunctionType functionType;
+	const char *name;
 };
 
 // Encapsulates a vertex buffer semantic description
@@ -59,6 +94,24 @@ protected:
 	VertexDescriptor() {}
 };
 
+// The kinds of resource a linked program is reflected into
+enum BindingType
+{
+	BINDINGTYPE_UNIFORM_BLOCK = 0, // index for Set*Bytes
+	BINDINGTYPE_SAMPLER, // texture unit for SetTexture2D and SetSamplerState
+	BINDINGTYPE_STORAGE_BUFFER, // index for SetBuffer
+	BINDINGTYPE_VERTEX_INPUT, // shaderLocation of a VertexAttribute
+};
+
+// A resource of a linked program and the slot it is bound at
+struct ShaderBinding
+{
+	const char *name;
+	BindingType bindingType;
+	unsigned int index;
+	unsigned int size; // bytes of a block, elements of a sampler array, components of a vertex input
+};
+
 // Encapsulates the render pipeline state (shaders + vertex descriptor + raster state)
 class RenderPipelineState
 {
@@ -67,6 +120,22 @@ public:
 	// virtual destructor to ensure subclasses have a virtual destructor
 	virtual ~RenderPipelineState() {}
 
+	// False while a pipeline state created with CreateRenderPipelineStateAsync is still
+	// compiling; poll it on the device's thread
+	virtual bool IsReady() = 0;
+
+	// Block until the pipeline state is ready
+	virtual void Wait() = 0;
+
+	// The resources of the program, read once it is linked; waits for it if it is compiling.
+	// Resources the shaders leave sharing a slot, such as blocks and samplers without a
+	// binding, are each given a free one; the first in the program keeps it.
+	virtual const ShaderBinding *GetBindings(unsigned int &bindingCount) = 0;
+
+	// The slot of a named resource, or -1 if the program has none; look it up when the
+	// pipeline state is created and keep it rather than per frame
+	virtual int GetBindingIndex(BindingType bindingType, const char *name) = 0;
+
 protected:
 
 	// protected default constructor to ensure these are never created
@@ -74,11 +143,41 @@ protected:
 	RenderPipelineState() {}
 };
 
+// What a draw does when its render pipeline state is still compiling
+enum PendingPipelinePolicy
+{
+	PENDINGPIPELINEPOLICY_WAIT = 0, // wait for the pipeline state, stalling the command buffer
+	PENDINGPIPELINEPOLICY_SKIP, // leave the draw out
+	PENDINGPIPELINEPOLICY_FALLBACK, // draw with a fallback pipeline state, which takes the same vertex layout and bindings
+};
+
+// Encapsulates the compute pipeline state (compute shader)
+class ComputePipelineState
+{
+public:
+
+	// virtual destructor to ensure subclasses have a virtual destructor
+	virtual ~ComputePipelineState() {}
+
+	// The resources of the program, as for a render pipeline state
+	virtual const ShaderBinding *GetBindings(unsigned int &bindingCount) = 0;
+
+	// The slot of a named resource, or -1 if the program has none
+	virtual int GetBindingIndex(BindingType bindingType, const char *name) = 0;
+
+protected:
+
+	// protected default constructor to ensure these are never created
+	// directly
+	ComputePipelineState() {}
+};
+
 // Buffer Type
 enum BufferType
 {
 	BUFFERTYPE_VERTEX,
-	BUFFERTYPE_INDEX
+	BUFFERTYPE_INDEX,
+	BUFFERTYPE_STORAGE // shader storage; may be written by compute functions and read back as vertex, index, or indirect data
 };
 
 // Encapsulates a buffer
@@ -95,6 +194,19 @@ protected:
 	Buffer(const BufferType& bufferType, long long size, const void *data) {}
  };
 
+// Describes the format of a texture's texels
+enum PixelFormat
+{
+	PIXELFORMAT_RGBA8_UNORM = 0,
+	PIXELFORMAT_R32_FLOAT,
+	PIXELFORMAT_RG32_FLOAT,
+	PIXELFORMAT_RGBA16_FLOAT,
+	PIXELFORMAT_RGBA32_FLOAT,
+	PIXELFORMAT_DEPTH32_FLOAT,
+	PIXELFORMAT_DEPTH24_STENCIL8,
+	PIXELFORMAT_MAX
+};
+
 // Encapsulates a 2D texture
 class Texture2D
 {
@@ -262,6 +374,16 @@ enum IndexType {
 	INDEXTYPE_UINT32 = 1,
 };
 
+// Arguments of one indexed draw read from an indirect buffer; laid out as OpenGL's DrawElementsIndirectCommand
+struct DrawIndexedIndirectArguments
+{
+	unsigned int indexCount;
+	unsigned int instanceCount;
+	unsigned int indexStart;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
 enum Filter {
 	FILTER_NEAREST = 0,
 	FILTER_LINEAR = 1
@@ -305,9 +427,44 @@ public:
 	virtual void GetSize(int& width, int& height) = 0;
 };
 
+// Pixels being copied back to the CPU by RenderDevice::ReadPixelsAsync. The copy runs
+// behind the GPU work submitted before it, so the caller can keep rendering and collect
+// the pixels later.
+class PixelReadback
+{
+public:
+
+	// virtual destructor to ensure subclasses have a virtual destructor
+	virtual ~PixelReadback() {}
+
+	// Whether the pixels have arrived, without blocking
+	virtual bool IsReady() = 0;
+
+	// Block until the pixels have arrived
+	virtual void Wait() = 0;
+
+	// The pixels, tightly packed rows of width * GetPixelSize() bytes starting at the bottom row;
+	// waits if they have not arrived and stays valid until the readback is destroyed
+	virtual const void *GetData() = 0;
+
+	virtual int GetWidth() const = 0;
+
+	virtual int GetHeight() const = 0;
+
+	virtual PixelFormat GetPixelFormat() const = 0;
+
+	virtual int GetPixelSize() const = 0;
+
+protected:
+
+	// protected default constructor to ensure these are never created directly
+	PixelReadback() {}
+};
+
 // Forward declarations
 class CommandBuffer;
 class RenderCommandEncoder;
+class ComputeCommandEncoder;
 struct RenderPassDescriptor;
 
 class CommandQueue
@@ -324,17 +481,23 @@ class CommandBuffer
 public:
 	virtual ~CommandBuffer() {}
 	virtual RenderCommandEncoder* CreateRenderCommandEncoder(const RenderPassDescriptor& desc) = 0;
+	virtual ComputeCommandEncoder* CreateComputeCommandEncoder() = 0;
 	virtual void Present(Drawable* drawable) = 0;
 	virtual void Commit() = 0;
 protected:
 	CommandBuffer() {}
 };
 
+// Where a render pass draws. Leaving every texture null targets the window; otherwise the
+// pass renders into the given textures, which must share a size at the chosen mip levels.
+// Color textures need a color pixel format and the depth texture PIXELFORMAT_DEPTH32_FLOAT
+// or PIXELFORMAT_DEPTH24_STENCIL8.
 struct RenderPassDescriptor
 {
 	struct ColorAttachment
 	{
 		Texture2D* texture = nullptr;
+		int level = 0; // mip level rendered to
 		enum LoadAction { LoadAction_Clear, LoadAction_Load, LoadAction_DontCare };
 		LoadAction loadAction = LoadAction_Clear;
 		float clearColor[4] = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -343,6 +506,7 @@ struct RenderPassDescriptor
 	struct DepthAttachment
 	{
 		Texture2D* texture = nullptr;
+		int level = 0; // mip level rendered to
 		enum LoadAction { LoadAction_Clear, LoadAction_Load, LoadAction_DontCare };
 		LoadAction loadAction = LoadAction_Clear;
 		float clearDepth = 1.0f;
@@ -362,6 +526,10 @@ public:
 	virtual void SetRenderPipelineState(RenderPipelineState* renderPipelineState) = 0;
 	virtual void SetDepthStencilState(DepthStencilState* depthStencilState) = 0;
 
+	// How draws treat a render pipeline state that is not ready when the command buffer
+	// executes; waits by default. A fallback that is not ready either is waited for.
+	virtual void SetPendingPipelinePolicy(PendingPipelinePolicy policy, RenderPipelineState* fallbackPipelineState = nullptr) = 0;
+
 	// Resource binding
 	virtual void SetVertexBuffer(Buffer* buffer, unsigned int offset, unsigned int index) = 0;
 	virtual void SetTexture2D(Texture2D* texture, unsigned int index) = 0;
@@ -375,6 +543,16 @@ public:
 	virtual void Draw(PrimitiveType primitiveType, unsigned int vertexStart, unsigned int vertexCount) = 0;
 	virtual void DrawIndexed(PrimitiveType primitiveType, unsigned int indexCount, IndexType indexType, unsigned int indexOffset, unsigned int vertexOffset, Buffer* indexBuffer) = 0;
 
+	// Issues up to maxDrawCount draws whose DrawIndexedIndirectArguments are packed in indirectBuffer starting at indirectBufferOffset.
+	// When drawCountBuffer is set, the actual number of draws is the unsigned int it holds at drawCountBufferOffset; implementations
+	// without GPU-sourced draw counts issue maxDrawCount draws, so unused arguments must have an instanceCount of 0.
+	virtual void DrawIndexedIndirect(PrimitiveType primitiveType, IndexType indexType, Buffer* indexBuffer, Buffer* indirectBuffer, unsigned int indirectBufferOffset, unsigned int maxDrawCount, Buffer* drawCountBuffer = nullptr, unsigned int drawCountBufferOffset = 0) = 0;
+
+	// Time the commands in between on the GPU under name, nested in the pass; groups still
+	// open when encoding ends are closed with it
+	virtual void PushDebugGroup(const char* name) = 0;
+	virtual void PopDebugGroup() = 0;
+
 	// End the encoder
 	virtual void EndEncoding() = 0;
 
@@ -384,6 +562,122 @@ protected:
 	RenderCommandEncoder() {}
 };
 
+// Records compute dispatches. Memory barriers are inserted automatically when a
+// resource bound to a dispatch is subsequently read by a dispatch or a draw.
+class ComputeCommandEncoder
+{
+public:
+	virtual ~ComputeCommandEncoder() {}
+
+	// Pipeline state
+	virtual void SetComputePipelineState(ComputePipelineState* computePipelineState) = 0;
+
+	// Resource binding; buffers bind as shader storage blocks, textures bind for sampling, and
+	// storage textures bind one mip level as a read/write image
+	virtual void SetBuffer(Buffer* buffer, unsigned int offset, unsigned int index) = 0;
+	virtual void SetTexture(Texture2D* texture, unsigned int index) = 0;
+	virtual void SetStorageTexture(Texture2D* texture, unsigned int index, unsigned int mipLevel = 0) = 0;
+
+	// Metal-style parameter setting; the data is copied into a uniform block bound at index
+	virtual void SetBytes(const void* data, size_t size, unsigned int index) = 0;
+
+	// Dispatching; the threadgroup size is declared by the compute function's local_size layout
+	virtual void DispatchThreadgroups(unsigned int threadgroupsX, unsigned int threadgroupsY, unsigned int threadgroupsZ) = 0;
+	virtual void DispatchIndirect(Buffer* indirectBuffer, unsigned int indirectBufferOffset) = 0;
+
+	// Time the commands in between on the GPU under name, as on a render command encoder
+	virtual void PushDebugGroup(const char* name) = 0;
+	virtual void PopDebugGroup() = 0;
+
+	// End the encoder
+	virtual void EndEncoding() = 0;
+
+protected:
+	ComputeCommandEncoder() {}
+};
+
+// How often creating functions and pipeline states found their shader or program already
+// built (hits) rather than building it (misses), and how many are alive
+struct ShaderCacheStatistics
+{
+	unsigned int shaderHitCount;
+	unsigned int shaderMissCount;
+	unsigned int shaderCount;
+	unsigned int programHitCount;
+	unsigned int programMissCount;
+	unsigned int programCount;
+};
+
+// The GPU time of a pass or debug group, from timestamps taken around it
+struct GpuTiming
+{
+	const char *name; // "Render Pass", "Compute Pass" or a debug group's
+	unsigned int depth; // 0 for a pass, one more for each debug group it is nested in
+	double startMilliseconds; // since the frame's first pass began
+	double durationMilliseconds;
+};
+
+// The GPU timings of a finished frame, in the order the passes and groups began
+struct FrameGpuTimings
+{
+	unsigned long long frameIndex; // counted by EndFrame from 0
+	double frameMilliseconds; // from the first pass's start to the last one's end
+	const GpuTiming *timings;
+	unsigned int timingCount;
+};
+
+// Work counted on the CPU over a frame, as command buffers execute; plain counters kept on the
+// device's thread, cheap enough to leave on
+struct FrameCounters
+{
+	unsigned long long commandBufferCount; // committed
+	unsigned long long commandCount; // recorded into the command buffers committed
+	unsigned long long commandBytes; // the recorded commands and the data copied into them
+	unsigned long long largestCommandBufferBytes;
+	unsigned long long renderPassCount;
+	unsigned long long computePassCount;
+	unsigned long long drawCount; // an indirect draw counts its maxDrawCount
+	unsigned long long instanceCount; // of direct draws; indirect ones are only known to the GPU
+	unsigned long long triangleCount; // of direct draws
+	unsigned long long dispatchCount;
+	unsigned long long renderPipelineStateChangeCount;
+	unsigned long long computePipelineStateChangeCount;
+	unsigned long long depthStencilStateChangeCount;
+	unsigned long long vertexBufferChangeCount;
+	unsigned long long textureChangeCount; // sampled textures, and storage textures of dispatches
+	unsigned long long samplerChangeCount;
+	unsigned long long storageBufferChangeCount;
+	unsigned long long viewportChangeCount;
+	unsigned long long glCallCount; // issued by command buffers and immediate draws, but for GPU timer queries
+	unsigned long long bufferBytesUploaded;
+	unsigned long long textureBytesUploaded;
+	unsigned long long uniformBufferCount; // transient uniform buffers holding Set*Bytes data
+	unsigned long long uniformBytesUploaded;
+
+	// Hardware counters of the device's thread around Commit, encoding and uploads; 0 unless
+	// enabled with SetPerfCountersEnabled
+	unsigned long long cpuCycles;
+	unsigned long long cpuInstructions;
+	unsigned long long l1DataCacheMisses;
+	unsigned long long lastLevelCacheMisses;
+	unsigned long long branchMisses;
+};
+
+// The counters of the last frame ended and their mean over the frames before it
+struct FrameStatistics
+{
+	unsigned long long frameIndex; // of the last frame ended, counted by EndFrame from 0
+	FrameCounters frame;
+	FrameCounters average; // over the last averageFrameCount frames, rounded down
+	unsigned int averageFrameCount; // up to 60
+
+	// Of the hardware counters over the same frames; 0 without them
+	double instructionsPerCycle;
+	double l1DataCacheMissesPerDraw;
+	double lastLevelCacheMissesPerDraw;
+	double branchMissesPerDraw;
+};
+
 // Encapsulates the render device API.
 class RenderDevice
 {
@@ -395,15 +689,80 @@ public:
 	// Create a library from the supplied code; code is assumed to be GLSL for now.
 	virtual Library *CreateLibrary(const char *vertexShaderSource, const char *fragmentShaderSource) = 0;
 
+	// Create a library holding a compute function; code is assumed to be GLSL for now.
+	virtual Library *CreateLibrary(const char *computeShaderSource) = 0;
+
+	// Create a library of many functions from one GLSL source, compiling them all at once, in
+	// parallel where the driver can. Each entry point is a function of the source compiled as
+	// its stage's main; the source sees RENDER_DEVICE_VERTEX, RENDER_DEVICE_FRAGMENT or
+	// RENDER_DEVICE_COMPUTE defined to keep other stages' declarations out.
+	virtual Library *CreateLibrary(const char *source, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount) = 0;
+
+	// Create a library of the entry points of a SPIR-V module compiled offline, size bytes of
+	// words. Where the driver cannot take SPIR-V, the entry points are compiled from
+	// fallbackSource as by CreateLibrary with entry points; null when there is none.
+	virtual Library *CreateLibraryFromSPIRV(const void *words, size_t size, const char *fallbackSource = nullptr) = 0;
+
 	// Destroy a library
 	virtual void DestroyLibrary(Library *library) = 0;
 
+	// Keep linked pipelines in directory and load them from there when created again, in this
+	// and later runs; entries of another driver or other shader sources are never used. Null
+	// turns the cache off. Defaults to the RENDER_DEVICE_PIPELINE_CACHE environment variable.
+	virtual void SetPipelineCacheDirectory(const char *directory) = 0;
+
 	// Create a render pipeline state (Metal-style: combines shaders, vertex descriptor, and raster state)
 	virtual RenderPipelineState *CreateRenderPipelineState(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL) = 0;
 
+	// Create a render pipeline state that compiles in the background, returning at once. It
+	// may be used before it is ready; draws follow the encoder's PendingPipelinePolicy, or
+	// use fallbackPipelineState when one is given, such as the generic variant of a
+	// specialized one. The fallback must outlive the pipeline state.
+	virtual RenderPipelineState *CreateRenderPipelineStateAsync(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL, RenderPipelineState *fallbackPipelineState = nullptr) = 0;
+
 	// Destroy a render pipeline state
 	virtual void DestroyRenderPipelineState(RenderPipelineState *renderPipelineState) = 0;
 
+	// Create a compute pipeline state from a compute function
+	virtual ComputePipelineState *CreateComputePipelineState(Function *computeShader) = 0;
+
+	// Destroy a compute pipeline state
+	virtual void DestroyComputePipelineState(ComputePipelineState *computePipelineState) = 0;
+
+	// Functions of the same stage and source share one compiled shader, and pipeline states of
+	// the same functions share one linked program, each freed with its last user
+	virtual void GetShaderCacheStatistics(ShaderCacheStatistics &statistics) = 0;
+
+	// Write every pipeline created so far, with its shaders, vertex layout and raster state, to
+	// a manifest at path for PrewarmPipelines in a later run; false if it cannot be written
+	virtual bool SavePipelineManifest(const char *path) = 0;
+
+	// Start building the pipelines of a saved manifest in parallel, so creating them later
+	// finds them built. With wait, return once all are built, before the first frame; else
+	// return at once and poll GetPrewarmProgress, e.g. while a loading screen renders. Returns
+	// the number of programs being built, or -1 if the manifest cannot be read.
+	virtual int PrewarmPipelines(const char *path, bool wait = false) = 0;
+
+	// How many of the programs PrewarmPipelines started are built
+	virtual void GetPrewarmProgress(unsigned int &readyCount, unsigned int &totalCount) = 0;
+
+	// Close the frame after its last Commit; its GPU timings are collected once the GPU is done
+	// with it, a few frames later, without waiting
+	virtual void EndFrame() = 0;
+
+	// The timings of the latest frame whose results have arrived; timingCount is 0 before the
+	// first. They stay valid until the next EndFrame.
+	virtual void GetFrameGpuTimings(FrameGpuTimings &timings) = 0;
+
+	// Counters of the frames closed by EndFrame; all zero before the first
+	virtual void GetFrameStatistics(FrameStatistics &statistics) = 0;
+
+	// Sample the CPU's hardware counters of the calling thread around Commit, encoding and
+	// uploads into the frame statistics, through perf_event_open on Linux. Returns whether they
+	// could be opened, which perf_event_paranoid may refuse. Defaults to on when the
+	// RENDER_DEVICE_PERF_COUNTERS environment variable is set.
+	virtual bool SetPerfCountersEnabled(bool enabled) = 0;
+
 	// Create a buffer
 	virtual Buffer *CreateBuffer(const render::BufferType& bufferType, long long size, const void *data = nullptr) = 0;
 
@@ -427,6 +786,12 @@ public:
 	// most significant byte is ignored.
 	virtual Texture2D *CreateTexture2D(int width, int height, const void *data = nullptr) = 0;
 
+	// Create a 2D texture with the given pixel format and number of mip levels (0 for a full chain).
+	//
+	// data, if any, holds tightly packed texels of mip level 0 in that format; the other
+	// levels are then generated from it. Depth formats can be used as depth attachments.
+	virtual Texture2D *CreateTexture2D(int width, int height, PixelFormat pixelFormat, int mipLevelCount = 1, const void *data = nullptr) = 0;
+
 	// Destroy a 2D texture
 	virtual void DestroyTexture2D(Texture2D *texture2D) = 0;
 
@@ -482,9 +847,20 @@ public:
 	virtual CommandQueue* CreateCommandQueue() = 0;
 	virtual void DestroyCommandQueue(CommandQueue* queue) = 0;
 
-	// Drawable creation (for presentation)
+	// Drawable creation (for presentation); null when no window is current or it has no pixels
 	virtual Drawable* GetNextDrawable() = 0;
 	virtual void DestroyDrawable(Drawable* drawable) = 0;
+
+	// Start copying a region of a texture to the CPU, converted to pixelFormat, after the work
+	// committed so far. Depth textures read back in their own format whatever pixelFormat is;
+	// a depth pixelFormat for a color texture returns null.
+	virtual PixelReadback *ReadPixelsAsync(Texture2D *texture, int x, int y, int width, int height, PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM) = 0;
+
+	// Start copying a region of a drawable to the CPU; a window drawable must be read before it is presented
+	virtual PixelReadback *ReadPixelsAsync(Drawable *drawable, int x, int y, int width, int height, PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM) = 0;
+
+	// Release a readback, returning its staging memory to the device for reuse
+	virtual void DestroyPixelReadback(PixelReadback *pixelReadback) = 0;
 };
 
 // Creates a RenderDevice
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace render
+{
+
+enum SharedFrameFormat
+{
+	SHAREDFRAMEFORMAT_RGBA8,
+	SHAREDFRAMEFORMAT_I420,
+	SHAREDFRAMEFORMAT_NV12,
+};
+
+// Descriptor published with every frame
+struct SharedFrameInfo
+{
+	uint64_t frameNumber = 0;
+	uint64_t timestamp = 0; // CLOCK_MONOTONIC nanoseconds; filled in on publish when left 0
+	uint32_t format = SHAREDFRAMEFORMAT_RGBA8;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0; // bytes between rows of the first plane
+	uint64_t size = 0; // bytes of frame data in the slot
+};
+
+// Publishes frames into a ring of slots in a memfd shared memory region, so another
+// process on the same host can consume them where they were written.
+//
+// The region starts with a header holding the ring's write and read positions and a
+// descriptor per slot, followed by the page aligned slots. The ring has one producer and
+// one consumer and is lock-free: positions are atomics in the shared header, and a
+// futex on each lets the other side sleep instead of spinning. When every slot still
+// holds an unconsumed frame, BeginFrame waits up to its timeout for the consumer and
+// then drops the frame, so a slow consumer throttles or thins the stream but never
+// stalls it indefinitely.
+//
+// Frames are written in place: convert into the pointer BeginFrame returns, or copy a
+// PixelReadback's mapped data into it with WriteFrame. Hand GetFileDescriptor to the
+// consumer (over a Unix socket or by inheritance) and open it with SharedFrameSource.
+// Linux only.
+class SharedFrameSink
+{
+public:
+
+	// Create a ring of slotCount slots of slotSize bytes each; returns null on failure
+	static SharedFrameSink *Create(const char *name, unsigned int slotCount, size_t slotSize);
+
+	~SharedFrameSink();
+
+	int GetFileDescriptor() const { return m_FileDescriptor; }
+
+	size_t GetSlotSize() const { return m_SlotSize; }
+
+	// Reserve the next slot, waiting up to timeoutMilliseconds (negative waits forever) for
+	// the consumer to free one; returns null and counts a dropped frame when none frees up
+	void *BeginFrame(int timeoutMilliseconds = 0);
+
+	// Publish the slot returned by the last BeginFrame; a size beyond the slot is cut to it
+	void EndFrame(const SharedFrameInfo &info);
+
+	// Copy info.size bytes of data into the next slot and publish it; false if dropped
+	bool WriteFrame(const void *data, const SharedFrameInfo &info, int timeoutMilliseconds = 0);
+
+	uint64_t GetPublishedFrameCount() const { return m_WriteIndex; }
+
+	uint64_t GetDroppedFrameCount() const { return m_DroppedFrameCount; }
+
+private:
+
+	SharedFrameSink() {}
+
+	int m_FileDescriptor = -1;
+	void *m_Mapping = nullptr;
+	size_t m_MappingSize = 0;
+	size_t m_SlotSize = 0;
+
+	uint64_t m_WriteIndex = 0;
+	uint64_t m_DroppedFrameCount = 0;
+	bool m_FrameBegun = false;
+};
+
+// Consumes the frames of a SharedFrameSink, possibly in another process
+class SharedFrameSource
+{
+public:
+
+	// Map the region behind a sink's file descriptor, which may be closed afterwards;
+	// returns null if it is not a sink's region
+	static SharedFrameSource *Open(int fileDescriptor);
+
+	~SharedFrameSource();
+
+	// Wait up to timeoutMilliseconds (negative waits forever) for the next frame; returns
+	// its data, valid until ReleaseFrame, or null on timeout. info.size never exceeds the slot.
+	const void *AcquireFrame(SharedFrameInfo &info, int timeoutMilliseconds = -1);
+
+	// Hand the acquired slot back to the producer
+	void ReleaseFrame();
+
+private:
+
+	SharedFrameSource() {}
+
+	void *m_Mapping = nullptr;
+	size_t m_MappingSize = 0;
+	uint64_t m_SlotSize = 0;
+
+	uint64_t m_ReadIndex = 0;
+	bool m_FrameAcquired = false;
+};
+
+} // end namespace render
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+// A fixed set of worker threads fed from a single task queue
+class ThreadPool
+{
+public:
+
+	// threadCount of 0 uses one worker per hardware thread, less the calling thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+
+	// Finishes the queued tasks, then joins the workers
+	~ThreadPool();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Threads.size()); }
+
+	// Queue a task to run on a worker
+	void Submit(std::function<void()> task);
+
+	// Block until every submitted task has finished
+	void Wait();
+
+	// Run task(i) for every i in [0, taskCount) on the workers and the calling thread,
+	// returning once all of them have finished
+	void ParallelFor(unsigned int taskCount, const std::function<void(unsigned int)> &task);
+
+private:
+
+	void WorkerMain();
+
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskAvailable;
+	std::condition_variable m_Idle;
+	std::deque<std::function<void()>> m_Tasks;
+	unsigned int m_RunningTaskCount = 0;
+	bool m_Stopping = false;
+};
+
+} // end namespace render
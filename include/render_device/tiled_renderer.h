@@ -0,0 +1,66 @@
+#pragma once
+
+#include "render_device/image_writer.h"
+#include "render_device/render_device.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+
+namespace render
+{
+
+// Renders images larger than any texture, or than memory, as a grid of tiles streamed to
+// disk, such as 16k to 64k pixel posters.
+//
+// The image is cut into bands one tile high. Each tile is drawn into a single tile sized
+// target with the projection narrowed to its part of the image, an off-center frustum,
+// and read back asynchronously while the next tile renders. A finished band goes to a
+// writer thread that encodes and writes it while the following band renders, so the GPU
+// never waits on encoding. Two bands, 2 * width * tileHeight * 4 bytes, are all that is
+// ever held in memory.
+//
+// Anything computed from window coordinates rather than the projection (gl_FragCoord,
+// screen space derivatives across tile edges) sees the tile, not the image.
+class TiledRenderer
+{
+public:
+
+	// Record a tile's draws into an encoder on the tile target, using tileProjection in
+	// place of the image's projection
+	typedef std::function<void(RenderCommandEncoder *encoder, const glm::mat4 &tileProjection)> DrawFunction;
+
+	// Tiles must fit the device's maximum texture size, which is at least 16384 under GL 4
+	TiledRenderer(RenderDevice *renderDevice, int tileWidth = 2048, int tileHeight = 256);
+
+	~TiledRenderer();
+
+	void SetClearColor(float red, float green, float blue, float alpha);
+
+	// Render a width x height image seen through projection and write it to path, returning
+	// false if the file could not be written
+	bool Render(CommandQueue *commandQueue, const char *path, ImageFileFormat format, uint32_t width, uint32_t height,
+		const glm::mat4 &projection, const DrawFunction &draw);
+
+	// The projection that maps the pixels [x, x + tileWidth) x [y, y + tileHeight) of a
+	// width x height image, y counted up from the bottom row, onto a whole tile viewport
+	static glm::mat4 GetTileProjection(const glm::mat4 &projection, uint32_t width, uint32_t height, int x, int y, int tileWidth, int tileHeight);
+
+	int GetTileWidth() const { return m_TileWidth; }
+
+	int GetTileHeight() const { return m_TileHeight; }
+
+private:
+
+	RenderDevice *m_RenderDevice = nullptr;
+
+	int m_TileWidth = 0;
+	int m_TileHeight = 0;
+	float m_ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	Texture2D *m_ColorTexture = nullptr;
+	Texture2D *m_DepthTexture = nullptr;
+};
+
+} // end namespace render
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+#include <cstddef>
+
+namespace render
+{
+
+class ThreadPool;
+
+// Byte layouts of an 8 bit 4:2:0 frame. Both start with the full resolution luma plane;
+// I420 follows it with the quarter resolution U plane and then the V plane, NV12 with a
+// single half height plane of interleaved U and V samples.
+enum YuvLayout
+{
+	YUVLAYOUT_I420,
+	YUVLAYOUT_NV12,
+};
+
+// Bytes of one frame in either layout, 37.5% of the same frame in RGBA8
+inline size_t GetYuvFrameSize(int width, int height)
+{
+	return static_cast<size_t>(width) * height * 3 / 2;
+}
+
+// Convert RGBA8 pixels to 4:2:0 YUV on the CPU, for when the GPU pass is unavailable.
+//
+// Colors use BT.601 limited range coefficients and chroma is the average of each 2x2
+// block, with the same integer arithmetic as YuvConversionPass so both produce identical
+// bytes. Width and height must be even. rgba points at the top row of the image and
+// rgbaStride is the byte offset to the row below it; pass the last row and a negative
+// stride for bottom-up images such as a PixelReadback. Rows are converted sixteen pixels
+// at a time with SSE2 where the build targets it, spread across an optional ThreadPool.
+void ConvertRgbaToYuv(const unsigned char *rgba, ptrdiff_t rgbaStride, int width, int height, YuvLayout layout, unsigned char *yuv, ThreadPool *threadPool = nullptr);
+
+// Converts a rendered color texture to 4:2:0 YUV with a compute shader, so a frame can be
+// read back at GetYuvFrameSize bytes and handed straight to a video encoder.
+//
+// The frame is written into an RGBA8 output texture a quarter of the width and one and a
+// half times the height of the source, each texel holding four consecutive bytes of the
+// frame. Reading that texture back therefore yields the frame in order, top row first.
+// The width must be a multiple of 8 and the height even.
+class YuvConversionPass
+{
+public:
+
+	YuvConversionPass(RenderDevice *renderDevice, int width, int height, YuvLayout layout);
+
+	~YuvConversionPass();
+
+	// Record the conversion of colorTexture, which must match the size given at creation
+	void Encode(ComputeCommandEncoder *encoder, Texture2D *colorTexture);
+
+	// Queue the readback of the last committed conversion; GetData returns the whole frame
+	PixelReadback *ReadAsync();
+
+	Texture2D *GetOutputTexture() const { return m_OutputTexture; }
+
+	YuvLayout GetLayout() const { return m_Layout; }
+
+private:
+
+	RenderDevice *m_RenderDevice = nullptr;
+
+	int m_Width = 0;
+	int m_Height = 0;
+	YuvLayout m_Layout;
+
+	Library *m_Library = nullptr;
+	Function *m_Function = nullptr;
+	ComputePipelineState *m_PipelineState = nullptr;
+
+	Texture2D *m_OutputTexture = nullptr;
+};
+
+} // end namespace render
@@ -0,0 +1,150 @@
+#include "render_job.h"
+
+#include <render_device/shared_frame_sink.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Submits render jobs to render_server and writes the last frame to a file: a PPM for
+// rgba, raw planes for i420 and nv12. Prints the round trip latency of every job.
+//
+// usage: render_client [--socket PATH] [--scene NAME] [--width W] [--height H]
+//                      [--format rgba|i420|nv12] [--yaw DEGREES] [--count N] [--output FILE]
+
+static const char *kStatusNames[] = { "ok", "invalid request", "unknown scene", "worker failed" };
+
+static bool WriteFrame(const char *path, const void *data, const render::SharedFrameInfo &info)
+{
+	FILE *file = fopen(path, "wb");
+	if(!file)
+		return false;
+
+	if(info.format == render::SHAREDFRAMEFORMAT_RGBA8)
+	{
+		fprintf(file, "P6\n%u %u\n255\n", info.width, info.height);
+		const unsigned char *pixel = static_cast<const unsigned char *>(data);
+		for(uint64_t i = 0; i < static_cast<uint64_t>(info.width) * info.height; i++, pixel += 4)
+			fwrite(pixel, 1, 3, file);
+	}
+	else
+		fwrite(data, 1, info.size, file);
+
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *socketPath = "/tmp/render_server.sock";
+	const char *outputPath = nullptr;
+	std::string scene = "cube";
+	uint32_t width = 640, height = 480, format = render::SHAREDFRAMEFORMAT_RGBA8;
+	float yaw = 30.0f;
+	int count = 1;
+	for(int i = 1; i + 1 < argc; i += 2)
+	{
+		if(strcmp(argv[i], "--socket") == 0)
+			socketPath = argv[i + 1];
+		else if(strcmp(argv[i], "--scene") == 0)
+			scene = argv[i + 1];
+		else if(strcmp(argv[i], "--width") == 0)
+			width = static_cast<uint32_t>(atoi(argv[i + 1]));
+		else if(strcmp(argv[i], "--height") == 0)
+			height = static_cast<uint32_t>(atoi(argv[i + 1]));
+		else if(strcmp(argv[i], "--format") == 0)
+			format = strcmp(argv[i + 1], "i420") == 0 ? render::SHAREDFRAMEFORMAT_I420 : strcmp(argv[i + 1], "nv12") == 0 ? render::SHAREDFRAMEFORMAT_NV12 : render::SHAREDFRAMEFORMAT_RGBA8;
+		else if(strcmp(argv[i], "--yaw") == 0)
+			yaw = static_cast<float>(atof(argv[i + 1]));
+		else if(strcmp(argv[i], "--count") == 0)
+			count = atoi(argv[i + 1]);
+		else if(strcmp(argv[i], "--output") == 0)
+			outputPath = argv[i + 1];
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+	int server = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if(server < 0 || connect(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+	{
+		printf("ERROR::RENDERCLIENT::CONNECT_FAILED %s: %s\n", socketPath, strerror(errno));
+		return 1;
+	}
+
+	double totalMilliseconds = 0.0;
+	int completed = 0;
+	for(int job = 0; job < count; job++)
+	{
+		render::RenderJobRequest request;
+		request.format = format;
+		request.jobId = static_cast<uint64_t>(job);
+		strncpy(request.scene, scene.c_str(), sizeof(request.scene) - 1);
+		request.width = width;
+		request.height = height;
+
+		glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.5f));
+		view = glm::rotate(view, glm::radians(25.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+		view = glm::rotate(view, glm::radians(yaw + 10.0f * job), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(width) / height, 0.1f, 100.0f);
+		memcpy(request.view, glm::value_ptr(view), sizeof(request.view));
+		memcpy(request.projection, glm::value_ptr(projection), sizeof(request.projection));
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		render::RenderJobResponse response;
+		int frameDescriptor = -1;
+		if(!render::SendRenderMessage(server, &request, sizeof(request)) ||
+			!render::ReceiveRenderMessage(server, &response, sizeof(response), &frameDescriptor))
+		{
+			printf("ERROR::RENDERCLIENT::SERVER_CLOSED\n");
+			break;
+		}
+
+		if(response.status != render::RENDERJOBSTATUS_OK || frameDescriptor < 0)
+		{
+			printf("job %llu: %s\n", static_cast<unsigned long long>(response.jobId), response.status < 4 ? kStatusNames[response.status] : "unknown status");
+			if(frameDescriptor >= 0)
+				close(frameDescriptor);
+			continue;
+		}
+
+		render::SharedFrameSource *source = render::SharedFrameSource::Open(frameDescriptor);
+		close(frameDescriptor);
+		render::SharedFrameInfo info;
+		const void *frame = source ? source->AcquireFrame(info, 0) : nullptr;
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("job %llu: worker %u, %.2f ms round trip, %.2f ms in worker\n", static_cast<unsigned long long>(response.jobId),
+			response.worker, milliseconds, response.renderNanoseconds / 1.0e6);
+		totalMilliseconds += milliseconds;
+		completed++;
+
+		if(frame && outputPath && job == count - 1)
+		{
+			if(WriteFrame(outputPath, frame, info))
+				printf("wrote %ux%u frame to %s\n", info.width, info.height, outputPath);
+		}
+
+		if(frame)
+			source->ReleaseFrame();
+		delete source;
+	}
+
+	if(completed > 0)
+		printf("%d jobs, %.2f ms average round trip\n", completed, totalMilliseconds / completed);
+
+	close(server);
+	return 0;
+}
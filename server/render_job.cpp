@@ -0,0 +1,101 @@
+#include "render_job.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace render
+{
+
+bool SendRenderMessage(int socket, const void *message, size_t size, int fileDescriptor)
+{
+	iovec vector;
+	vector.iov_base = const_cast<void *>(message);
+	vector.iov_len = size;
+
+	msghdr header;
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = &vector;
+	header.msg_iovlen = 1;
+
+	// the descriptor travels as SCM_RIGHTS ancillary data and arrives as a new descriptor
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+	if(fileDescriptor >= 0)
+	{
+		memset(control, 0, sizeof(control));
+		header.msg_control = control;
+		header.msg_controllen = sizeof(control);
+		cmsghdr *controlHeader = CMSG_FIRSTHDR(&header);
+		controlHeader->cmsg_level = SOL_SOCKET;
+		controlHeader->cmsg_type = SCM_RIGHTS;
+		controlHeader->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(controlHeader), &fileDescriptor, sizeof(int));
+	}
+
+	ssize_t sent;
+	do
+	{
+		sent = sendmsg(socket, &header, MSG_NOSIGNAL);
+	} while(sent < 0 && errno == EINTR);
+	return sent == static_cast<ssize_t>(size);
+}
+
+bool ReceiveRenderMessage(int socket, void *message, size_t size, int *fileDescriptor)
+{
+	iovec vector;
+	vector.iov_base = message;
+	vector.iov_len = size;
+
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+	msghdr header;
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = &vector;
+	header.msg_iovlen = 1;
+	header.msg_control = control;
+	header.msg_controllen = sizeof(control);
+
+	ssize_t received;
+	do
+	{
+		received = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+	} while(received < 0 && errno == EINTR);
+
+	if(fileDescriptor)
+		*fileDescriptor = -1;
+
+	// nothing was received, so the control buffer holds nothing to parse
+	if(received <= 0)
+		return false;
+
+	int passedDescriptor = -1;
+	for(cmsghdr *controlHeader = CMSG_FIRSTHDR(&header); controlHeader; controlHeader = CMSG_NXTHDR(&header, controlHeader))
+	{
+		if(controlHeader->cmsg_level == SOL_SOCKET && controlHeader->cmsg_type == SCM_RIGHTS && controlHeader->cmsg_len >= CMSG_LEN(sizeof(int)))
+		{
+			if(passedDescriptor >= 0)
+				close(passedDescriptor);
+			memcpy(&passedDescriptor, CMSG_DATA(controlHeader), sizeof(int));
+		}
+	}
+
+	if(fileDescriptor)
+		*fileDescriptor = passedDescriptor;
+	else if(passedDescriptor >= 0)
+		close(passedDescriptor);
+
+	// a short or truncated packet is not one of ours, nor is one whose descriptors did not fit
+	if(received != static_cast<ssize_t>(size) || (header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+	{
+		if(fileDescriptor && passedDescriptor >= 0)
+		{
+			close(passedDescriptor);
+			*fileDescriptor = -1;
+		}
+		return false;
+	}
+	return true;
+}
+
+} // end namespace render
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <render_device/shared_frame_sink.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace render
+{
+
+// Messages exchanged by render_server, its workers and its clients over SOCK_SEQPACKET
+// Unix sockets, one fixed size message per packet.
+
+static const uint32_t kRenderJobMagic = 0x524a4f42; // "RJOB"
+static const uint32_t kMaxRenderJobSize = 8192; // pixels on either side
+
+enum RenderJobStatus
+{
+	RENDERJOBSTATUS_OK = 0,
+	RENDERJOBSTATUS_INVALID_REQUEST = 1,
+	RENDERJOBSTATUS_UNKNOWN_SCENE = 2,
+	RENDERJOBSTATUS_WORKER_FAILED = 3,
+};
+
+struct RenderJobRequest
+{
+	uint32_t magic = kRenderJobMagic;
+	uint32_t format = SHAREDFRAMEFORMAT_RGBA8; // SharedFrameFormat of the output
+	uint64_t jobId = 0; // chosen by the client and echoed in the response
+	char scene[64] = {}; // name of a scene the workers have loaded
+	float view[16] = {}; // column-major camera matrices
+	float projection[16] = {};
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+struct RenderJobResponse
+{
+	uint32_t magic = kRenderJobMagic;
+	uint32_t status = RENDERJOBSTATUS_OK;
+	uint64_t jobId = 0;
+	uint32_t worker = 0; // index of the worker that rendered the job
+	uint32_t reserved = 0;
+	uint64_t renderNanoseconds = 0; // time the worker spent, from request to published frame
+};
+
+// Send one message, optionally passing a file descriptor along with it; false on failure
+bool SendRenderMessage(int socket, const void *message, size_t size, int fileDescriptor = -1);
+
+// Receive one message of exactly size bytes and the file descriptor sent with it, if any
+// (-1 otherwise); false on failure or when the peer has closed the socket
+bool ReceiveRenderMessage(int socket, void *message, size_t size, int *fileDescriptor = nullptr);
+
+} // end namespace render
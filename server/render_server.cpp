@@ -0,0 +1,626 @@
+#include "render_job.h"
+
+#include <render_device/platform.h>
+#include <render_device/render_device.h>
+#include <render_device/shared_frame_sink.h>
+#include <render_device/yuv_conversion.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Serves render jobs from a pool of pre-spawned headless worker processes.
+//
+// Each worker keeps a warm context with every scene's pipelines compiled, so a job costs
+// only its rendering and readback. Clients connect to a SOCK_SEQPACKET Unix socket and
+// send RenderJobRequests; the server hands each job to the worker with the fewest jobs in
+// flight. The worker publishes the frame into a one slot SharedFrameSink and the server
+// passes that memfd on to the client with the RenderJobResponse, so pixels never pass
+// through the server.
+//
+// usage: render_server [--socket PATH] [--workers N]
+
+static const char *vertexShaderSource = "#version 430 core\n"
+	"layout(std140, binding = 0) uniform SceneParams {\n"
+	"   mat4 uModelViewProjection;\n"
+	"};\n"
+	"layout (location = 0) in vec3 aPos;\n"
+	"layout (location = 1) in vec3 aColor;\n"
+	"out vec3 FragColor3;\n"
+	"void main()\n"
+	"{\n"
+	"   gl_Position = uModelViewProjection * vec4(aPos, 1.0);\n"
+	"   FragColor3 = aColor;\n"
+	"}\n";
+
+static const char *fragmentShaderSource = "#version 430 core\n"
+	"in vec3 FragColor3;\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"   FragColor = vec4(FragColor3, 1.0);\n"
+	"}\n";
+
+struct Vertex
+{
+	float x, y, z;
+	float r, g, b;
+};
+
+#define COUNT_OF(arr)	(sizeof(arr) / sizeof(*arr))
+
+static const Vertex triangleVertices[] = {
+	{ -0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f },
+	{  0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f },
+	{  0.0f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f },
+};
+
+// two triangles per face, a color per face
+static std::vector<Vertex> MakeCubeVertices()
+{
+	static const float faceColors[6][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 1, 0 }, { 0, 1, 1 }, { 1, 0, 1 } };
+	std::vector<Vertex> vertices;
+	for(int face = 0; face < 6; face++)
+	{
+		int axis = face / 2;
+		float side = face % 2 ? -0.5f : 0.5f;
+		float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+		int order[6] = { 0, 1, 2, 0, 2, 3 };
+		for(int i = 0; i < 6; i++)
+		{
+			// flip the winding on the negative faces so every face is counter-clockwise from outside
+			const float *corner = corners[side > 0.0f ? order[i] : order[5 - i]];
+			float position[3];
+			position[axis] = side;
+			position[(axis + 1) % 3] = corner[0];
+			position[(axis + 2) % 3] = corner[1];
+			Vertex vertex = { position[0], position[1], position[2], faceColors[face][0], faceColors[face][1], faceColors[face][2] };
+			vertices.push_back(vertex);
+		}
+	}
+	return vertices;
+}
+
+// A scene's geometry and compiled pipeline, loaded once per worker
+struct Scene
+{
+	render::RenderPipelineState *pipelineState = nullptr;
+	render::Buffer *vertexBuffer = nullptr;
+	unsigned int vertexCount = 0;
+};
+
+// Render targets of one output size, kept across jobs
+struct RenderTargets
+{
+	render::Texture2D *color = nullptr;
+	render::Texture2D *depth = nullptr;
+	render::YuvConversionPass *yuvConversionPasses[2] = {};
+};
+
+class RenderWorker
+{
+public:
+
+	explicit RenderWorker(unsigned int index) : m_Index(index) {}
+
+	bool Initialize();
+
+	// Serve jobs from socket until the server closes it
+	void Run(int socket);
+
+	void Shutdown();
+
+private:
+
+	void AddScene(const char *name, const Vertex *vertices, unsigned int vertexCount, bool cullEnabled);
+
+	RenderTargets &GetRenderTargets(uint32_t width, uint32_t height);
+
+	// Render a job into a new single slot sink; returns the sink, or null with status set
+	render::SharedFrameSink *RenderJob(const render::RenderJobRequest &request, uint32_t &status);
+
+	unsigned int m_Index;
+	platform::PLATFORM_WINDOW_REF m_Window = nullptr;
+	render::RenderDevice *m_RenderDevice = nullptr;
+	render::CommandQueue *m_CommandQueue = nullptr;
+	render::Library *m_Library = nullptr;
+	render::Function *m_VertexFunction = nullptr;
+	render::Function *m_FragmentFunction = nullptr;
+	render::VertexDescriptor *m_VertexDescriptor = nullptr;
+	render::DepthStencilState *m_DepthStencilState = nullptr;
+
+	std::map<std::string, Scene> m_Scenes;
+	std::map<std::pair<uint32_t, uint32_t>, RenderTargets> m_RenderTargets;
+};
+
+bool RenderWorker::Initialize()
+{
+	platform::InitPlatform(platform::PLATFORMTYPE_HEADLESS);
+	if(platform::GetPlatformType() != platform::PLATFORMTYPE_HEADLESS)
+	{
+		printf("ERROR::RENDERSERVER::HEADLESS_PLATFORM_UNAVAILABLE\n");
+		return false;
+	}
+
+	m_Window = platform::CreatePlatformWindow(64, 64, "render_server worker");
+	if(!m_Window)
+		return false;
+
+	m_RenderDevice = render::CreateRenderDevice();
+	m_CommandQueue = m_RenderDevice->CreateCommandQueue();
+	m_Library = m_RenderDevice->CreateLibrary(vertexShaderSource, fragmentShaderSource);
+	m_VertexFunction = m_Library->CreateFunction(render::FUNCTIONTYPE_VERTEX, "main");
+	m_FragmentFunction = m_Library->CreateFunction(render::FUNCTIONTYPE_FRAGMENT, "main");
+
+	render::VertexAttribute vertexAttributes[] = {
+		{ render::VERTEXATTRIBUTEFORMAT_FLOAT32X3, 0, 0 },
+		{ render::VERTEXATTRIBUTEFORMAT_FLOAT32X3, 12, 1 },
+	};
+	render::VertexBufferLayout vertexBufferLayout;
+	vertexBufferLayout.arrayStride = sizeof(Vertex);
+	vertexBufferLayout.attributeCount = COUNT_OF(vertexAttributes);
+	vertexBufferLayout.attributes = vertexAttributes;
+	m_VertexDescriptor = m_RenderDevice->CreateVertexDescriptor(vertexBufferLayout);
+	m_DepthStencilState = m_RenderDevice->CreateDepthStencilState(true, true);
+
+	AddScene("triangle", triangleVertices, COUNT_OF(triangleVertices), false);
+	std::vector<Vertex> cubeVertices = MakeCubeVertices();
+	AddScene("cube", cubeVertices.data(), static_cast<unsigned int>(cubeVertices.size()), true);
+
+	printf("render_server: worker %u ready\n", m_Index);
+	fflush(stdout);
+	return true;
+}
+
+void RenderWorker::AddScene(const char *name, const Vertex *vertices, unsigned int vertexCount, bool cullEnabled)
+{
+	Scene &scene = m_Scenes[name];
+	scene.pipelineState = m_RenderDevice->CreateRenderPipelineState(m_VertexFunction, m_FragmentFunction, m_VertexDescriptor, cullEnabled);
+	scene.vertexBuffer = m_RenderDevice->CreateBuffer(render::BUFFERTYPE_VERTEX, sizeof(Vertex) * vertexCount, vertices);
+	scene.vertexCount = vertexCount;
+}
+
+RenderTargets &RenderWorker::GetRenderTargets(uint32_t width, uint32_t height)
+{
+	RenderTargets &targets = m_RenderTargets[std::make_pair(width, height)];
+	if(!targets.color)
+	{
+		targets.color = m_RenderDevice->CreateTexture2D(width, height, render::PIXELFORMAT_RGBA8_UNORM);
+		targets.depth = m_RenderDevice->CreateTexture2D(width, height, render::PIXELFORMAT_DEPTH32_FLOAT);
+	}
+	return targets;
+}
+
+render::SharedFrameSink *RenderWorker::RenderJob(const render::RenderJobRequest &request, uint32_t &status)
+{
+	bool isYuv = request.format == render::SHAREDFRAMEFORMAT_I420 || request.format == render::SHAREDFRAMEFORMAT_NV12;
+	if(request.magic != render::kRenderJobMagic || request.width == 0 || request.height == 0 ||
+		request.width > render::kMaxRenderJobSize || request.height > render::kMaxRenderJobSize ||
+		(request.format != render::SHAREDFRAMEFORMAT_RGBA8 && !isYuv) || (isYuv && (request.width % 8 != 0 || request.height % 2 != 0)))
+	{
+		status = render::RENDERJOBSTATUS_INVALID_REQUEST;
+		return nullptr;
+	}
+
+	std::string sceneName(request.scene, strnlen(request.scene, sizeof(request.scene)));
+	std::map<std::string, Scene>::iterator sceneIt = m_Scenes.find(sceneName);
+	if(sceneIt == m_Scenes.end())
+	{
+		status = render::RENDERJOBSTATUS_UNKNOWN_SCENE;
+		return nullptr;
+	}
+	const Scene &scene = sceneIt->second;
+	RenderTargets &targets = GetRenderTargets(request.width, request.height);
+
+	glm::mat4 modelViewProjection = glm::make_mat4(request.projection) * glm::make_mat4(request.view);
+
+	render::CommandBuffer *commandBuffer = m_CommandQueue->CreateCommandBuffer();
+
+	render::RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = targets.color;
+	renderPassDescriptor.colorAttachments[0].clearColor[0] = 0.2f;
+	renderPassDescriptor.colorAttachments[0].clearColor[1] = 0.3f;
+	renderPassDescriptor.colorAttachments[0].clearColor[2] = 0.3f;
+	renderPassDescriptor.colorAttachments[0].clearColor[3] = 1.0f;
+	renderPassDescriptor.depthAttachment.texture = targets.depth;
+	render::RenderCommandEncoder *renderEncoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+	renderEncoder->SetRenderPipelineState(scene.pipelineState);
+	renderEncoder->SetDepthStencilState(m_DepthStencilState);
+	renderEncoder->SetVertexBuffer(scene.vertexBuffer, 0, 0);
+	renderEncoder->SetVertexBytes(glm::value_ptr(modelViewProjection), sizeof(modelViewProjection), 0);
+	renderEncoder->Draw(render::PRIMITIVETYPE_TRIANGLE, 0, scene.vertexCount);
+	renderEncoder->EndEncoding();
+
+	render::ComputeCommandEncoder *computeEncoder = nullptr;
+	render::YuvConversionPass *yuvConversionPass = nullptr;
+	if(isYuv)
+	{
+		render::YuvLayout layout = request.format == render::SHAREDFRAMEFORMAT_NV12 ? render::YUVLAYOUT_NV12 : render::YUVLAYOUT_I420;
+		yuvConversionPass = targets.yuvConversionPasses[layout];
+		if(!yuvConversionPass)
+			yuvConversionPass = targets.yuvConversionPasses[layout] = new render::YuvConversionPass(m_RenderDevice, request.width, request.height, layout);
+
+		computeEncoder = commandBuffer->CreateComputeCommandEncoder();
+		yuvConversionPass->Encode(computeEncoder, targets.color);
+		computeEncoder->EndEncoding();
+	}
+	commandBuffer->Commit();
+
+	render::PixelReadback *readback = isYuv ? yuvConversionPass->ReadAsync() : m_RenderDevice->ReadPixelsAsync(targets.color, 0, 0, request.width, request.height);
+
+	render::SharedFrameInfo info;
+	info.frameNumber = request.jobId;
+	info.format = request.format;
+	info.width = request.width;
+	info.height = request.height;
+	info.stride = isYuv ? request.width : request.width * 4;
+	info.size = isYuv ? render::GetYuvFrameSize(request.width, request.height) : static_cast<uint64_t>(request.width) * request.height * 4;
+
+	render::SharedFrameSink *sink = render::SharedFrameSink::Create("render_job", 1, info.size);
+	unsigned char *slot = sink ? static_cast<unsigned char *>(sink->BeginFrame()) : nullptr;
+	if(slot)
+	{
+		const unsigned char *data = static_cast<const unsigned char *>(readback->GetData());
+		if(isYuv)
+			memcpy(slot, data, info.size);
+		else
+		{
+			// readbacks are bottom-up, frames top-down
+			for(uint32_t row = 0; row < request.height; row++)
+				memcpy(slot + static_cast<size_t>(row) * info.stride, data + static_cast<size_t>(request.height - 1 - row) * info.stride, info.stride);
+		}
+		sink->EndFrame(info);
+	}
+	else
+	{
+		delete sink;
+		sink = nullptr;
+		status = render::RENDERJOBSTATUS_WORKER_FAILED;
+	}
+
+	m_RenderDevice->DestroyPixelReadback(readback);
+	delete computeEncoder;
+	delete renderEncoder;
+	delete commandBuffer;
+	return sink;
+}
+
+void RenderWorker::Run(int socket)
+{
+	render::RenderJobRequest request;
+	while(render::ReceiveRenderMessage(socket, &request, sizeof(request)))
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		render::RenderJobResponse response;
+		response.jobId = request.jobId;
+		response.worker = m_Index;
+		render::SharedFrameSink *sink = RenderJob(request, response.status);
+		response.renderNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		// the client's copy of the descriptor keeps the memory alive once ours is closed
+		render::SendRenderMessage(socket, &response, sizeof(response), sink ? sink->GetFileDescriptor() : -1);
+		delete sink;
+	}
+}
+
+void RenderWorker::Shutdown()
+{
+	if(!m_RenderDevice)
+	{
+		platform::TerminatePlatform();
+		return;
+	}
+
+	for(std::map<std::pair<uint32_t, uint32_t>, RenderTargets>::iterator it = m_RenderTargets.begin(); it != m_RenderTargets.end(); ++it)
+	{
+		delete it->second.yuvConversionPasses[0];
+		delete it->second.yuvConversionPasses[1];
+		m_RenderDevice->DestroyTexture2D(it->second.depth);
+		m_RenderDevice->DestroyTexture2D(it->second.color);
+	}
+	for(std::map<std::string, Scene>::iterator it = m_Scenes.begin(); it != m_Scenes.end(); ++it)
+	{
+		m_RenderDevice->DestroyBuffer(it->second.vertexBuffer);
+		m_RenderDevice->DestroyRenderPipelineState(it->second.pipelineState);
+	}
+	m_RenderDevice->DestroyDepthStencilState(m_DepthStencilState);
+	m_RenderDevice->DestroyVertexDescriptor(m_VertexDescriptor);
+	m_Library->DestroyFunction(m_FragmentFunction);
+	m_Library->DestroyFunction(m_VertexFunction);
+	m_RenderDevice->DestroyLibrary(m_Library);
+	m_RenderDevice->DestroyCommandQueue(m_CommandQueue);
+	render::DestroyRenderDevice(m_RenderDevice);
+
+	platform::TerminatePlatform();
+}
+
+// Server side view of a worker process
+struct WorkerProcess
+{
+	pid_t pid = -1;
+	int socket = -1;
+	unsigned int jobsInFlight = 0;
+};
+
+// A job forwarded to a worker, waiting for its response
+struct PendingJob
+{
+	int client = -1; // -1 once the client has disconnected
+	uint64_t clientJobId = 0;
+	unsigned int worker = 0;
+};
+
+static volatile sig_atomic_t s_Stopping = 0;
+
+static void HandleStopSignal(int)
+{
+	s_Stopping = 1;
+}
+
+static bool SpawnWorker(unsigned int index, std::vector<WorkerProcess> &workers)
+{
+	int sockets[2];
+	if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0)
+		return false;
+
+	pid_t pid = fork();
+	if(pid < 0)
+	{
+		close(sockets[0]);
+		close(sockets[1]);
+		return false;
+	}
+
+	if(pid == 0)
+	{
+		// the worker keeps only its own end of its own socket
+		for(WorkerProcess &worker : workers)
+			close(worker.socket);
+		close(sockets[0]);
+		signal(SIGINT, SIG_IGN);
+
+		RenderWorker renderWorker(index);
+		bool initialized = renderWorker.Initialize();
+		if(initialized)
+			renderWorker.Run(sockets[1]);
+		renderWorker.Shutdown();
+		_exit(initialized ? 0 : 1);
+	}
+
+	close(sockets[1]);
+	WorkerProcess worker;
+	worker.pid = pid;
+	worker.socket = sockets[0];
+	workers.push_back(worker);
+	return true;
+}
+
+static int CreateListeningSocket(const char *path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(address.sun_path))
+	{
+		printf("ERROR::RENDERSERVER::SOCKET_PATH_TOO_LONG %s\n", path);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+
+	int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	unlink(path);
+	if(listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0)
+	{
+		printf("ERROR::RENDERSERVER::LISTEN_FAILED %s: %s\n", path, strerror(errno));
+		if(listener >= 0)
+			close(listener);
+		return -1;
+	}
+	return listener;
+}
+
+static void SendFailure(int client, uint64_t clientJobId, uint32_t status)
+{
+	render::RenderJobResponse response;
+	response.status = status;
+	response.jobId = clientJobId;
+	render::SendRenderMessage(client, &response, sizeof(response));
+}
+
+int main(int argc, char **argv)
+{
+	const char *socketPath = "/tmp/render_server.sock";
+	unsigned int workerCount = std::thread::hardware_concurrency();
+	for(int i = 1; i + 1 < argc; i += 2)
+	{
+		if(strcmp(argv[i], "--socket") == 0)
+			socketPath = argv[i + 1];
+		else if(strcmp(argv[i], "--workers") == 0)
+			workerCount = static_cast<unsigned int>(atoi(argv[i + 1]));
+	}
+	if(workerCount == 0)
+		workerCount = 1;
+
+	// one rasterizer thread per worker; the pool provides the parallelism
+	setenv("LP_NUM_THREADS", "1", 0);
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, HandleStopSignal);
+	signal(SIGTERM, HandleStopSignal);
+
+	// workers are forked before the listener exists, so they hold nothing but their socket
+	std::vector<WorkerProcess> workers;
+	for(unsigned int i = 0; i < workerCount; i++)
+	{
+		if(!SpawnWorker(i, workers))
+			printf("ERROR::RENDERSERVER::SPAWN_FAILED %s\n", strerror(errno));
+	}
+
+	int listener = CreateListeningSocket(socketPath);
+	if(listener < 0 || workers.empty())
+		return 1;
+	printf("render_server: %zu workers listening on %s\n", workers.size(), socketPath);
+	fflush(stdout);
+
+	std::vector<int> clients;
+	std::map<uint64_t, PendingJob> pendingJobs;
+	uint64_t nextJobId = 1;
+
+	while(!s_Stopping)
+	{
+		std::vector<pollfd> pollFds;
+		pollfd listenerPoll = { listener, POLLIN, 0 };
+		pollFds.push_back(listenerPoll);
+		for(WorkerProcess &worker : workers)
+		{
+			pollfd workerPoll = { worker.socket, POLLIN, 0 };
+			pollFds.push_back(workerPoll);
+		}
+		for(int client : clients)
+		{
+			pollfd clientPoll = { client, POLLIN, 0 };
+			pollFds.push_back(clientPoll);
+		}
+
+		if(poll(pollFds.data(), pollFds.size(), -1) < 0)
+			continue; // interrupted by a signal
+
+		if(pollFds[0].revents & POLLIN)
+		{
+			int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if(client >= 0)
+				clients.push_back(client);
+		}
+
+		// responses go back to whoever asked, with the frame's memfd
+		for(size_t w = 0; w < workers.size(); w++)
+		{
+			WorkerProcess &worker = workers[w];
+			if(worker.socket < 0 || !(pollFds[1 + w].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			render::RenderJobResponse response;
+			int frameDescriptor = -1;
+			if(!render::ReceiveRenderMessage(worker.socket, &response, sizeof(response), &frameDescriptor))
+			{
+				printf("render_server: worker %zu exited\n", w);
+				close(worker.socket);
+				worker.socket = -1;
+				waitpid(worker.pid, nullptr, 0);
+				for(std::map<uint64_t, PendingJob>::iterator it = pendingJobs.begin(); it != pendingJobs.end(); )
+				{
+					if(it->second.worker == w)
+					{
+						if(it->second.client >= 0)
+							SendFailure(it->second.client, it->second.clientJobId, render::RENDERJOBSTATUS_WORKER_FAILED);
+						it = pendingJobs.erase(it);
+					}
+					else
+						++it;
+				}
+				continue;
+			}
+
+			std::map<uint64_t, PendingJob>::iterator pending = pendingJobs.find(response.jobId);
+			if(pending != pendingJobs.end())
+			{
+				worker.jobsInFlight--;
+				if(pending->second.client >= 0)
+				{
+					response.jobId = pending->second.clientJobId;
+					render::SendRenderMessage(pending->second.client, &response, sizeof(response), frameDescriptor);
+				}
+				pendingJobs.erase(pending);
+			}
+			if(frameDescriptor >= 0)
+				close(frameDescriptor);
+		}
+
+		// requests go to the least loaded worker
+		size_t clientPollBase = 1 + workers.size();
+		std::vector<int> remainingClients;
+		for(size_t c = 0; c < clients.size(); c++)
+		{
+			int client = clients[c];
+			short events = pollFds[clientPollBase + c].revents;
+			if(!(events & (POLLIN | POLLHUP | POLLERR)))
+			{
+				remainingClients.push_back(client);
+				continue;
+			}
+
+			render::RenderJobRequest request;
+			if(!render::ReceiveRenderMessage(client, &request, sizeof(request)))
+			{
+				for(std::map<uint64_t, PendingJob>::iterator it = pendingJobs.begin(); it != pendingJobs.end(); ++it)
+				{
+					if(it->second.client == client)
+						it->second.client = -1;
+				}
+				close(client);
+				continue;
+			}
+			remainingClients.push_back(client);
+
+			WorkerProcess *leastLoaded = nullptr;
+			unsigned int leastLoadedIndex = 0;
+			for(size_t w = 0; w < workers.size(); w++)
+			{
+				if(workers[w].socket >= 0 && (!leastLoaded || workers[w].jobsInFlight < leastLoaded->jobsInFlight))
+				{
+					leastLoaded = &workers[w];
+					leastLoadedIndex = static_cast<unsigned int>(w);
+				}
+			}
+
+			uint64_t clientJobId = request.jobId;
+			request.jobId = nextJobId++;
+			if(!leastLoaded || !render::SendRenderMessage(leastLoaded->socket, &request, sizeof(request)))
+			{
+				SendFailure(client, clientJobId, render::RENDERJOBSTATUS_WORKER_FAILED);
+				continue;
+			}
+
+			PendingJob pending;
+			pending.client = client;
+			pending.clientJobId = clientJobId;
+			pending.worker = leastLoadedIndex;
+			pendingJobs[request.jobId] = pending;
+			leastLoaded->jobsInFlight++;
+		}
+		clients.swap(remainingClients);
+	}
+
+	// closing the sockets ends each worker's job loop
+	printf("render_server: shutting down\n");
+	for(int client : clients)
+		close(client);
+	for(WorkerProcess &worker : workers)
+	{
+		if(worker.socket >= 0)
+		{
+			close(worker.socket);
+			waitpid(worker.pid, nullptr, 0);
+		}
+	}
+	close(listener);
+	unlink(socketPath);
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+#include "render_device/cpu_culling.h"
+#include "render_device/thread_pool.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CULL_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULL_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CULL_SIMD_NEON 1
+#endif
+
+namespace render
+{
+
+static const unsigned int kBatchSize = 8; // components are padded to a multiple of the widest batch
+static const unsigned int kChunkSize = 16384; // objects per thread pool task
+
+// Thin wrappers over the vector unit so the tests below are written once
+#if defined(CULL_SIMD_AVX2)
+
+static const unsigned int kLaneCount = 8;
+typedef __m256 FloatLanes;
+typedef __m256 MaskLanes;
+
+static inline FloatLanes Load(const float *p) { return _mm256_loadu_ps(p); }
+static inline FloatLanes Splat(float f) { return _mm256_set1_ps(f); }
+static inline FloatLanes MulAdd(FloatLanes a, FloatLanes b, FloatLanes c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+static inline MaskLanes GreaterEqual(FloatLanes a, FloatLanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline MaskLanes And(MaskLanes a, MaskLanes b) { return _mm256_and_ps(a, b); }
+static inline unsigned int MoveMask(MaskLanes m) { return static_cast<unsigned int>(_mm256_movemask_ps(m)); }
+
+#elif defined(CULL_SIMD_SSE2)
+
+static const unsigned int kLaneCount = 4;
+typedef __m128 FloatLanes;
+typedef __m128 MaskLanes;
+
+static inline FloatLanes Load(const float *p) { return _mm_loadu_ps(p); }
+static inline FloatLanes Splat(float f) { return _mm_set1_ps(f); }
+static inline FloatLanes MulAdd(FloatLanes a, FloatLanes b, FloatLanes c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline MaskLanes GreaterEqual(FloatLanes a, FloatLanes b) { return _mm_cmpge_ps(a, b); }
+static inline MaskLanes And(MaskLanes a, MaskLanes b) { return _mm_and_ps(a, b); }
+static inline unsigned int MoveMask(MaskLanes m) { return static_cast<unsigned int>(_mm_movemask_ps(m)); }
+
+#elif defined(CULL_SIMD_NEON)
+
+static const unsigned int kLaneCount = 4;
+typedef float32x4_t FloatLanes;
+typedef uint32x4_t MaskLanes;
+
+static inline FloatLanes Load(const float *p) { return vld1q_f32(p); }
+static inline FloatLanes Splat(float f) { return vdupq_n_f32(f); }
+static inline FloatLanes MulAdd(FloatLanes a, FloatLanes b, FloatLanes c) { return vmlaq_f32(c, a, b); }
+static inline MaskLanes GreaterEqual(FloatLanes a, FloatLanes b) { return vcgeq_f32(a, b); }
+static inline MaskLanes And(MaskLanes a, MaskLanes b) { return vandq_u32(a, b); }
+static inline unsigned int MoveMask(MaskLanes m)
+{
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t bits = vandq_u32(m, vld1q_u32(laneBits));
+	uint32x2_t sum = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+	sum = vpadd_u32(sum, sum);
+	return vget_lane_u32(sum, 0);
+}
+
+#else
+
+static const unsigned int kLaneCount = 1;
+typedef float FloatLanes;
+typedef bool MaskLanes;
+
+static inline FloatLanes Load(const float *p) { return *p; }
+static inline FloatLanes Splat(float f) { return f; }
+static inline FloatLanes MulAdd(FloatLanes a, FloatLanes b, FloatLanes c) { return a * b + c; }
+static inline MaskLanes GreaterEqual(FloatLanes a, FloatLanes b) { return a >= b; }
+static inline MaskLanes And(MaskLanes a, MaskLanes b) { return a && b; }
+static inline unsigned int MoveMask(MaskLanes m) { return m ? 1 : 0; }
+
+#endif
+
+static inline MaskLanes AllLanes()
+{
+	return GreaterEqual(Splat(0.0f), Splat(0.0f));
+}
+
+CpuCullingPass::CpuCullingPass(CullBoundsType boundsType, ThreadPool *threadPool)
+: m_BoundsType(boundsType), m_ThreadPool(threadPool)
+{
+}
+
+void CpuCullingPass::SetBounds(const glm::vec4 *bounds, unsigned int objectCount)
+{
+	m_ObjectCount = objectCount;
+
+	unsigned int paddedCount = (objectCount + kBatchSize - 1) / kBatchSize * kBatchSize;
+	for(std::vector<float> &component : m_Components)
+		component.assign(paddedCount, 0.0f);
+
+	unsigned int stride = m_BoundsType == CULLBOUNDS_SPHERE ? 1 : 2;
+	for(unsigned int i = 0; i < objectCount; i++)
+		SetObjectBounds(i, bounds + i * stride);
+
+	unsigned int chunkCount = (objectCount + kChunkSize - 1) / kChunkSize;
+	m_ChunkVisibleIndices.resize(chunkCount);
+	m_ChunkVisibleCounts.resize(chunkCount);
+}
+
+void CpuCullingPass::SetObjectBounds(unsigned int objectIndex, const glm::vec4 *bounds)
+{
+	if(m_BoundsType == CULLBOUNDS_SPHERE)
+	{
+		for(int i = 0; i < 4; i++)
+			m_Components[i][objectIndex] = bounds[0][i];
+	}
+	else
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			m_Components[i][objectIndex] = bounds[0][i];
+			m_Components[3 + i][objectIndex] = bounds[1][i];
+		}
+	}
+}
+
+unsigned int CpuCullingPass::Cull(const glm::mat4 &projection, const glm::mat4 &view, std::vector<unsigned int> &visibleIndices)
+{
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(projection * view, planes);
+
+	unsigned int chunkCount = static_cast<unsigned int>(m_ChunkVisibleIndices.size());
+	if(m_ThreadPool && chunkCount > 1)
+		m_ThreadPool->ParallelFor(chunkCount, [this, &planes](unsigned int chunkIndex) { CullChunk(chunkIndex, planes); });
+	else
+	{
+		for(unsigned int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+			CullChunk(chunkIndex, planes);
+	}
+
+	unsigned int visibleCount = 0;
+	for(unsigned int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		visibleCount += m_ChunkVisibleCounts[chunkIndex];
+
+	visibleIndices.resize(visibleCount);
+	unsigned int *output = visibleIndices.data();
+	for(unsigned int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		const std::vector<unsigned int> &chunkIndices = m_ChunkVisibleIndices[chunkIndex];
+		std::copy(chunkIndices.begin(), chunkIndices.begin() + m_ChunkVisibleCounts[chunkIndex], output);
+		output += m_ChunkVisibleCounts[chunkIndex];
+	}
+
+	return visibleCount;
+}
+
+void CpuCullingPass::CullChunk(unsigned int chunkIndex, const glm::vec4 planes[6])
+{
+	unsigned int begin = chunkIndex * kChunkSize;
+	unsigned int end = begin + kChunkSize < m_ObjectCount ? begin + kChunkSize : m_ObjectCount;
+
+	// room for a whole batch past the last visible object, so indices are written without branching
+	std::vector<unsigned int> &chunkIndices = m_ChunkVisibleIndices[chunkIndex];
+	if(chunkIndices.size() < kChunkSize + kBatchSize)
+		chunkIndices.resize(kChunkSize + kBatchSize);
+	unsigned int *output = chunkIndices.data();
+	unsigned int visibleCount = 0;
+
+	FloatLanes planeX[6], planeY[6], planeZ[6], planeW[6];
+	for(int p = 0; p < 6; p++)
+	{
+		planeX[p] = Splat(planes[p].x);
+		planeY[p] = Splat(planes[p].y);
+		planeZ[p] = Splat(planes[p].z);
+		planeW[p] = Splat(planes[p].w);
+	}
+
+	for(unsigned int base = begin; base < end; base += kLaneCount)
+	{
+		MaskLanes inside = AllLanes();
+		if(m_BoundsType == CULLBOUNDS_SPHERE)
+		{
+			// distance from the center to each plane must not fall below -radius
+			FloatLanes x = Load(&m_Components[0][base]);
+			FloatLanes y = Load(&m_Components[1][base]);
+			FloatLanes z = Load(&m_Components[2][base]);
+			FloatLanes negativeRadius = MulAdd(Load(&m_Components[3][base]), Splat(-1.0f), Splat(0.0f));
+			for(int p = 0; p < 6; p++)
+			{
+				FloatLanes distance = MulAdd(planeX[p], x, MulAdd(planeY[p], y, MulAdd(planeZ[p], z, planeW[p])));
+				inside = And(inside, GreaterEqual(distance, negativeRadius));
+			}
+		}
+		else
+		{
+			// the corner furthest along each plane normal must be in front of it; the normal
+			// is shared by every lane, so the corner is picked per plane rather than per lane
+			FloatLanes minX = Load(&m_Components[0][base]);
+			FloatLanes minY = Load(&m_Components[1][base]);
+			FloatLanes minZ = Load(&m_Components[2][base]);
+			FloatLanes maxX = Load(&m_Components[3][base]);
+			FloatLanes maxY = Load(&m_Components[4][base]);
+			FloatLanes maxZ = Load(&m_Components[5][base]);
+			for(int p = 0; p < 6; p++)
+			{
+				FloatLanes x = planes[p].x >= 0.0f ? maxX : minX;
+				FloatLanes y = planes[p].y >= 0.0f ? maxY : minY;
+				FloatLanes z = planes[p].z >= 0.0f ? maxZ : minZ;
+				FloatLanes distance = MulAdd(planeX[p], x, MulAdd(planeY[p], y, MulAdd(planeZ[p], z, planeW[p])));
+				inside = And(inside, GreaterEqual(distance, Splat(0.0f)));
+			}
+		}
+		unsigned int mask = MoveMask(inside);
+		if(end - base < kLaneCount)
+			mask &= (1u << (end - base)) - 1; // drop the padding past the last object
+
+		for(unsigned int lane = 0; lane < kLaneCount; lane++)
+		{
+			output[visibleCount] = base + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	m_ChunkVisibleCounts[chunkIndex] = visibleCount;
+}
+
+} // end namespace render
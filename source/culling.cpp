@@ -0,0 +1,27 @@
+#include "render_device/culling.h"
+
+#include <cmath>
+
+namespace render
+{
+
+void ExtractFrustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+{
+	// each plane is the last row of the matrix plus or minus one of the others
+	for(int i = 0; i < 3; i++)
+	{
+		for(int side = 0; side < 2; side++)
+		{
+			float sign = side == 0 ? 1.0f : -1.0f;
+			glm::vec4 &plane = planes[i * 2 + side];
+			for(int column = 0; column < 4; column++)
+				plane[column] = viewProjection[column][3] + sign * viewProjection[column][i];
+
+			float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			for(int component = 0; component < 4; component++)
+				plane[component] /= length;
+		}
+	}
+}
+
+} // end namespace render
@@ -0,0 +1,151 @@
+#include "render_device/frame_pipeline.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace render
+{
+
+typedef std::chrono::high_resolution_clock PipelineClock;
+
+static double SecondsSince(PipelineClock::time_point start)
+{
+	return std::chrono::duration<double>(PipelineClock::now() - start).count();
+}
+
+FramePipeline::FramePipeline(RenderDevice *renderDevice, int width, int height, ImageFileFormat format, unsigned int encodeThreadCount, unsigned int maxQueuedFrames)
+: m_RenderDevice(renderDevice), m_Width(width), m_Height(height), m_Format(format), m_MaxQueuedFrames(maxQueuedFrames > 0 ? maxQueuedFrames : 1),
+  m_EncodeThreadPool(encodeThreadCount)
+{
+	m_ColorTexture = m_RenderDevice->CreateTexture2D(m_Width, m_Height, PIXELFORMAT_RGBA8_UNORM);
+	m_DepthTexture = m_RenderDevice->CreateTexture2D(m_Width, m_Height, PIXELFORMAT_DEPTH32_FLOAT);
+}
+
+FramePipeline::~FramePipeline()
+{
+	ReleaseWrittenFrames(1);
+
+	m_RenderDevice->DestroyTexture2D(m_DepthTexture);
+	m_RenderDevice->DestroyTexture2D(m_ColorTexture);
+}
+
+void FramePipeline::SetClearColor(float red, float green, float blue, float alpha)
+{
+	m_ClearColor[0] = red;
+	m_ClearColor[1] = green;
+	m_ClearColor[2] = blue;
+	m_ClearColor[3] = alpha;
+}
+
+void FramePipeline::ReleaseWrittenFrames(unsigned int maxQueuedFrames)
+{
+	std::deque<PixelReadback *> writtenFrames;
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_FrameWritten.wait(lock, [&]() { return m_QueuedFrameCount < maxQueuedFrames; });
+		writtenFrames.swap(m_WrittenFrames);
+	}
+
+	// readbacks belong to the render thread's context
+	for(PixelReadback *readback : writtenFrames)
+		m_RenderDevice->DestroyPixelReadback(readback);
+}
+
+bool FramePipeline::Run(CommandQueue *commandQueue, uint64_t frameCount, const char *pathFormat, const DrawFunction &draw)
+{
+	m_Statistics = FramePipelineStatistics();
+	m_Statistics.encodeThreadCount = m_EncodeThreadPool.GetThreadCount();
+	uint64_t queuedFrameSum = 0;
+
+	PipelineClock::time_point runStart = PipelineClock::now();
+
+	// hand a frame whose readback has been queued to the encoders
+	auto encodeFrame = [&](PixelReadback *readback, uint64_t frameIndex)
+	{
+		PipelineClock::time_point waitStart = PipelineClock::now();
+		const unsigned char *pixels = static_cast<const unsigned char *>(readback->GetData());
+		m_Statistics.readbackWaitSeconds += SecondsSince(waitStart);
+
+		waitStart = PipelineClock::now();
+		ReleaseWrittenFrames(m_MaxQueuedFrames);
+		m_Statistics.queueWaitSeconds += SecondsSince(waitStart);
+
+		unsigned int queuedFrameCount;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			queuedFrameCount = ++m_QueuedFrameCount;
+		}
+		if(queuedFrameCount > m_Statistics.maxQueuedFrames)
+			m_Statistics.maxQueuedFrames = queuedFrameCount;
+		queuedFrameSum += queuedFrameCount;
+
+		char path[1024];
+		snprintf(path, sizeof(path), pathFormat, static_cast<unsigned long long>(frameIndex));
+		std::string framePath(path);
+
+		m_EncodeThreadPool.Submit([this, readback, pixels, framePath]()
+		{
+			PipelineClock::time_point encodeStart = PipelineClock::now();
+
+			// readbacks are bottom-up, image files top-down
+			ptrdiff_t rowSize = static_cast<ptrdiff_t>(m_Width) * 4;
+			ImageStreamWriter *writer = ImageStreamWriter::Create(framePath.c_str(), m_Format, m_Width, m_Height);
+			bool written = writer && writer->WriteRows(pixels + rowSize * (m_Height - 1), -rowSize, m_Height) && writer->Finish();
+			delete writer;
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Statistics.encodeSeconds += SecondsSince(encodeStart);
+				if(written)
+					m_Statistics.framesWritten++;
+				else
+					m_Statistics.framesFailed++;
+				m_WrittenFrames.push_back(readback);
+				m_QueuedFrameCount--;
+			}
+			m_FrameWritten.notify_all();
+		});
+	};
+
+	RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = m_ColorTexture;
+	memcpy(renderPassDescriptor.colorAttachments[0].clearColor, m_ClearColor, sizeof(m_ClearColor));
+	renderPassDescriptor.depthAttachment.texture = m_DepthTexture;
+
+	PixelReadback *previousReadback = nullptr;
+	for(uint64_t frameIndex = 0; frameIndex < frameCount; frameIndex++)
+	{
+		PipelineClock::time_point renderStart = PipelineClock::now();
+
+		CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+		RenderCommandEncoder *encoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+		draw(encoder, frameIndex);
+		encoder->EndEncoding();
+		commandBuffer->Commit();
+		delete encoder;
+		delete commandBuffer;
+
+		// queued behind the frame on the GPU; collected after the next frame is submitted
+		PixelReadback *readback = m_RenderDevice->ReadPixelsAsync(m_ColorTexture, 0, 0, m_Width, m_Height);
+
+		m_Statistics.renderSeconds += SecondsSince(renderStart);
+		m_Statistics.framesRendered++;
+
+		if(previousReadback)
+			encodeFrame(previousReadback, frameIndex - 1);
+		previousReadback = readback;
+	}
+	if(previousReadback)
+		encodeFrame(previousReadback, frameCount - 1);
+
+	ReleaseWrittenFrames(1);
+
+	m_Statistics.wallSeconds = SecondsSince(runStart);
+	m_Statistics.averageQueuedFrames = frameCount > 0 ? static_cast<double>(queuedFrameSum) / frameCount : 0.0;
+
+	return m_Statistics.framesFailed == 0;
+}
+
+} // end namespace render
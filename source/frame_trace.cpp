@@ -0,0 +1,279 @@
+#include "render_device/frame_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace render
+{
+
+// Zones open at once per thread at most; deeper ones are left out
+static const unsigned int kMaxTraceDepth = 64;
+
+enum TraceEventKind
+{
+	TRACEEVENTKIND_ZONE,
+	TRACEEVENTKIND_GPU_ZONE,
+	TRACEEVENTKIND_FRAME,
+};
+
+struct TraceEvent
+{
+	const char *name;
+	unsigned long long begin;
+	unsigned long long end;
+	unsigned int depth;
+	unsigned int kind;
+};
+
+// A thread's ring of events. Only the thread writes it; WriteFrameTrace reads it from any
+// thread, copying the events and then dropping those the writer may have overwritten meanwhile.
+struct TraceBuffer
+{
+	TraceEvent events[kTraceEventCapacity];
+	std::atomic<unsigned long long> written { 0 };
+
+	const char *openNames[kMaxTraceDepth];
+	unsigned long long openBegins[kMaxTraceDepth];
+	unsigned int depth = 0;
+	unsigned int skippedDepth = 0;
+
+	// copies of names given as strings, never erased so events may keep pointing at them
+	std::unordered_set<std::string> names;
+	std::atomic<const char *> threadName { nullptr };
+
+	unsigned int threadIndex = 0;
+};
+
+struct TraceRegistry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+static TraceRegistry &GetTraceRegistry()
+{
+	static TraceRegistry registry;
+	return registry;
+}
+
+// The ring of the calling thread, registered on its first use and kept after the thread exits
+static TraceBuffer &GetTraceBuffer()
+{
+	static thread_local TraceBuffer *s_Buffer = nullptr;
+	if(!s_Buffer)
+	{
+		TraceRegistry &registry = GetTraceRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.buffers.emplace_back(new TraceBuffer);
+		s_Buffer = registry.buffers.back().get();
+		s_Buffer->threadIndex = static_cast<unsigned int>(registry.buffers.size());
+	}
+	return *s_Buffer;
+}
+
+static void AddTraceEvent(TraceBuffer &buffer, const TraceEvent &event)
+{
+	unsigned long long index = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[index % kTraceEventCapacity] = event;
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+unsigned long long GetTraceTime()
+{
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BeginTraceZone(const char *name)
+{
+	TraceBuffer &buffer = GetTraceBuffer();
+	if(buffer.skippedDepth > 0 || buffer.depth >= kMaxTraceDepth)
+	{
+		buffer.skippedDepth++;
+		return;
+	}
+	buffer.openNames[buffer.depth] = name;
+	buffer.openBegins[buffer.depth] = GetTraceTime();
+	buffer.depth++;
+}
+
+void EndTraceZone()
+{
+	TraceBuffer &buffer = GetTraceBuffer();
+	if(buffer.skippedDepth > 0)
+	{
+		buffer.skippedDepth--;
+		return;
+	}
+	if(buffer.depth == 0)
+		return;
+
+	buffer.depth--;
+	TraceEvent event = { buffer.openNames[buffer.depth], buffer.openBegins[buffer.depth], GetTraceTime(), buffer.depth, TRACEEVENTKIND_ZONE };
+	AddTraceEvent(buffer, event);
+}
+
+void MarkTraceFrame()
+{
+	TraceBuffer &buffer = GetTraceBuffer();
+	unsigned long long time = GetTraceTime();
+	TraceEvent event = { "Frame", time, time, 0, TRACEEVENTKIND_FRAME };
+	AddTraceEvent(buffer, event);
+}
+
+void SetTraceThreadName(const char *name)
+{
+	TraceBuffer &buffer = GetTraceBuffer();
+	buffer.threadName.store(buffer.names.insert(name).first->c_str(), std::memory_order_release);
+}
+
+void AddGpuTraceZone(const char *name, unsigned int depth, unsigned long long beginNanoseconds, unsigned long long endNanoseconds)
+{
+	TraceBuffer &buffer = GetTraceBuffer();
+	TraceEvent event = { buffer.names.insert(name).first->c_str(), beginNanoseconds, endNanoseconds, depth, TRACEEVENTKIND_GPU_ZONE };
+	AddTraceEvent(buffer, event);
+}
+
+// The events a ring holds, oldest first
+static std::vector<TraceEvent> CopyTraceEvents(const TraceBuffer &buffer)
+{
+	unsigned long long written = buffer.written.load(std::memory_order_acquire);
+	unsigned long long first = written > kTraceEventCapacity ? written - kTraceEventCapacity : 0;
+	std::vector<TraceEvent> events;
+	events.reserve(written - first);
+	for(unsigned long long i = first; i < written; i++)
+		events.push_back(buffer.events[i % kTraceEventCapacity]);
+
+	// events the writer reached while they were copied may be torn
+	std::atomic_thread_fence(std::memory_order_acquire);
+	unsigned long long rewritten = buffer.written.load(std::memory_order_relaxed);
+	if(rewritten >= first + kTraceEventCapacity)
+		events.erase(events.begin(), events.begin() + std::min<unsigned long long>(rewritten - kTraceEventCapacity + 1 - first, events.size()));
+	return events;
+}
+
+static void WriteJsonString(FILE *file, const char *text)
+{
+	fputc('"', file);
+	for(const char *c = text; *c; c++)
+	{
+		if(*c == '"' || *c == '\\')
+			fprintf(file, "\\%c", *c);
+		else if(static_cast<unsigned char>(*c) < 0x20)
+			fprintf(file, "\\u%04x", static_cast<unsigned int>(*c));
+		else
+			fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+// Trace Event timestamps are microseconds
+static void WriteMicroseconds(FILE *file, unsigned long long nanoseconds)
+{
+	fprintf(file, "%llu.%03llu", nanoseconds / 1000, nanoseconds % 1000);
+}
+
+bool WriteFrameTrace(const char *path, unsigned int frameCount)
+{
+	std::vector<TraceBuffer *> buffers;
+	{
+		TraceRegistry &registry = GetTraceRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for(const std::unique_ptr<TraceBuffer> &buffer : registry.buffers)
+			buffers.push_back(buffer.get());
+	}
+
+	std::vector<std::vector<TraceEvent>> threadEvents;
+	for(TraceBuffer *buffer : buffers)
+		threadEvents.push_back(CopyTraceEvents(*buffer));
+
+	// the window ends at the last frame marked and starts where the frame frameCount before it ended
+	std::vector<unsigned long long> frameEnds;
+	for(const std::vector<TraceEvent> &events : threadEvents)
+	{
+		std::vector<unsigned long long> ends;
+		for(const TraceEvent &event : events)
+		{
+			if(event.kind == TRACEEVENTKIND_FRAME)
+				ends.push_back(event.end);
+		}
+		if(!ends.empty() && (frameEnds.empty() || ends.back() > frameEnds.back()))
+			frameEnds.swap(ends);
+	}
+	unsigned long long windowBegin = 0, windowEnd = ~0ull;
+	if(!frameEnds.empty())
+	{
+		windowEnd = frameEnds.back();
+		if(frameEnds.size() > frameCount)
+			windowBegin = frameEnds[frameEnds.size() - 1 - frameCount];
+	}
+
+	FILE *file = fopen(path, "w");
+	if(!file)
+		return false;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"RenderDevice\"}}");
+	for(size_t i = 0; i < buffers.size(); i++)
+	{
+		unsigned int tid = buffers[i]->threadIndex;
+		unsigned int gpuTid = tid + static_cast<unsigned int>(buffers.size());
+		const char *threadName = buffers[i]->threadName.load(std::memory_order_acquire);
+		std::string name = threadName ? threadName : "Thread " + std::to_string(tid);
+		bool hasGpuZones = false;
+
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", tid);
+		WriteJsonString(file, name.c_str());
+		fprintf(file, "}}");
+
+		for(const TraceEvent &event : threadEvents[i])
+		{
+			if(event.end <= windowBegin || event.begin > windowEnd)
+				continue;
+
+			// GPU zones go on a track of their own next to the thread's, as they may overlap its zones
+			unsigned int eventTid = tid;
+			if(event.kind == TRACEEVENTKIND_GPU_ZONE)
+			{
+				eventTid = gpuTid;
+				hasGpuZones = true;
+			}
+
+			fprintf(file, ",\n{\"name\":");
+			WriteJsonString(file, event.name);
+			if(event.kind == TRACEEVENTKIND_FRAME)
+			{
+				fprintf(file, ",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%u,\"ts\":", eventTid);
+				WriteMicroseconds(file, event.begin);
+			}
+			else
+			{
+				fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":", event.kind == TRACEEVENTKIND_GPU_ZONE ? "gpu" : "cpu", eventTid);
+				WriteMicroseconds(file, event.begin);
+				fprintf(file, ",\"dur\":");
+				WriteMicroseconds(file, event.end > event.begin ? event.end - event.begin : 0);
+			}
+			fprintf(file, "}");
+		}
+
+		if(hasGpuZones)
+		{
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", gpuTid);
+			WriteJsonString(file, (name + " GPU").c_str());
+			fprintf(file, "}}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	bool written = !ferror(file);
+	return fclose(file) == 0 && written;
+}
+
+} // end namespace render
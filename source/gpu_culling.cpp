@@ -0,0 +1,214 @@
+#include "render_device/gpu_culling.h"
+
+namespace render
+{
+
+static const unsigned int kThreadgroupSize = 64;
+
+// Resets the draw count and every output record so stale survivors are never drawn
+static const char *clearShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 64) in;\n"
+	"struct DrawArguments {\n"
+	"   uint indexCount;\n"
+	"   uint instanceCount;\n"
+	"   uint indexStart;\n"
+	"   int baseVertex;\n"
+	"   uint baseInstance;\n"
+	"};\n"
+	"layout(std430, binding = 2) writeonly buffer VisibleBuffer {\n"
+	"   DrawArguments visibleArguments[];\n"
+	"};\n"
+	"layout(std430, binding = 3) writeonly buffer DrawCountBuffer {\n"
+	"   uint drawCount;\n"
+	"};\n"
+	"layout(std140, binding = 0) uniform ClearParams {\n"
+	"   uint maxObjectCount;\n"
+	"};\n"
+	"void main()\n"
+	"{\n"
+	"   uint index = gl_GlobalInvocationID.x;\n"
+	"   if(index == 0u)\n"
+	"      drawCount = 0u;\n"
+	"   if(index < maxObjectCount)\n"
+	"      visibleArguments[index] = DrawArguments(0u, 0u, 0u, 0, 0u);\n"
+	"}\n";
+
+// One thread per object: frustum test, optional Hi-Z occlusion test, then append the survivor
+static const char *cullShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 64) in;\n"
+	"struct DrawArguments {\n"
+	"   uint indexCount;\n"
+	"   uint instanceCount;\n"
+	"   uint indexStart;\n"
+	"   int baseVertex;\n"
+	"   uint baseInstance;\n"
+	"};\n"
+	"layout(std430, binding = 0) readonly buffer BoundsBuffer {\n"
+	"   vec4 bounds[];\n"
+	"};\n"
+	"layout(std430, binding = 1) readonly buffer ArgumentsBuffer {\n"
+	"   DrawArguments arguments[];\n"
+	"};\n"
+	"layout(std430, binding = 2) writeonly buffer VisibleBuffer {\n"
+	"   DrawArguments visibleArguments[];\n"
+	"};\n"
+	"layout(std430, binding = 3) buffer DrawCountBuffer {\n"
+	"   uint drawCount;\n"
+	"};\n"
+	"layout(std140, binding = 0) uniform CullParams {\n"
+	"   mat4 viewProjection;\n"
+	"   vec4 planes[6];\n"
+	"   uint objectCount;\n"
+	"   uint boundsType;\n"
+	"   uint useHiZ;\n"
+	"};\n"
+	"layout(binding = 0) uniform sampler2D hiZ;\n"
+	"bool IsOccluded(vec3 boundsMin, vec3 boundsMax)\n"
+	"{\n"
+	"   vec2 uvMin = vec2(1.0);\n"
+	"   vec2 uvMax = vec2(0.0);\n"
+	"   float nearestDepth = 1.0;\n"
+	"   for(int i = 0; i < 8; i++)\n"
+	"   {\n"
+	"      vec3 corner = vec3((i & 1) != 0 ? boundsMax.x : boundsMin.x, (i & 2) != 0 ? boundsMax.y : boundsMin.y, (i & 4) != 0 ? boundsMax.z : boundsMin.z);\n"
+	"      vec4 clip = viewProjection * vec4(corner, 1.0);\n"
+	"      if(clip.w <= 0.0)\n"
+	"         return false; // crosses the camera plane\n"
+	"      vec3 ndc = clip.xyz / clip.w;\n"
+	"      uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);\n"
+	"      uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);\n"
+	"      nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);\n"
+	"   }\n"
+	"   uvMin = clamp(uvMin, 0.0, 1.0);\n"
+	"   uvMax = clamp(uvMax, 0.0, 1.0);\n"
+	"   // pick the mip where the screen rectangle spans at most 2x2 texels\n"
+	"   vec2 extent = (uvMax - uvMin) * vec2(textureSize(hiZ, 0));\n"
+	"   int lod = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(hiZ) - 1);\n"
+	"   ivec2 size = textureSize(hiZ, lod);\n"
+	"   ivec2 texelMin = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);\n"
+	"   ivec2 texelMax = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);\n"
+	"   float farthestDepth = max(max(texelFetch(hiZ, texelMin, lod).r, texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), lod).r),\n"
+	"                             max(texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), lod).r, texelFetch(hiZ, texelMax, lod).r));\n"
+	"   return nearestDepth > farthestDepth;\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"   uint objectIndex = gl_GlobalInvocationID.x;\n"
+	"   if(objectIndex >= objectCount)\n"
+	"      return;\n"
+	"   bool visible = true;\n"
+	"   vec3 boundsMin, boundsMax;\n"
+	"   if(boundsType == 0u)\n"
+	"   {\n"
+	"      vec4 sphere = bounds[objectIndex];\n"
+	"      for(int i = 0; i < 6; i++)\n"
+	"         visible = visible && dot(planes[i].xyz, sphere.xyz) + planes[i].w >= -sphere.w;\n"
+	"      boundsMin = sphere.xyz - vec3(sphere.w);\n"
+	"      boundsMax = sphere.xyz + vec3(sphere.w);\n"
+	"   }\n"
+	"   else\n"
+	"   {\n"
+	"      boundsMin = bounds[objectIndex * 2u].xyz;\n"
+	"      boundsMax = bounds[objectIndex * 2u + 1u].xyz;\n"
+	"      for(int i = 0; i < 6; i++)\n"
+	"      {\n"
+	"         // test the corner furthest along the plane normal\n"
+	"         vec3 corner = mix(boundsMin, boundsMax, greaterThanEqual(planes[i].xyz, vec3(0.0)));\n"
+	"         visible = visible && dot(planes[i].xyz, corner) + planes[i].w >= 0.0;\n"
+	"      }\n"
+	"   }\n"
+	"   if(visible && useHiZ != 0u)\n"
+	"      visible = !IsOccluded(boundsMin, boundsMax);\n"
+	"   if(visible)\n"
+	"   {\n"
+	"      DrawArguments drawArguments = arguments[objectIndex];\n"
+	"      drawArguments.baseInstance = objectIndex;\n"
+	"      visibleArguments[atomicAdd(drawCount, 1u)] = drawArguments;\n"
+	"   }\n"
+	"}\n";
+
+// Matches the std140 ClearParams block above
+struct ClearParams
+{
+	unsigned int maxObjectCount;
+	unsigned int padding[3];
+};
+
+// Matches the std140 CullParams block above
+struct CullParams
+{
+	glm::mat4 viewProjection;
+	glm::vec4 planes[6];
+	unsigned int objectCount;
+	unsigned int boundsType;
+	unsigned int useHiZ;
+	unsigned int padding;
+};
+
+GpuCullingPass::GpuCullingPass(RenderDevice *renderDevice, unsigned int maxObjectCount)
+: m_RenderDevice(renderDevice), m_MaxObjectCount(maxObjectCount)
+{
+	m_ClearLibrary = m_RenderDevice->CreateLibrary(clearShaderSource);
+	m_ClearFunction = m_ClearLibrary->CreateFunction(FUNCTIONTYPE_COMPUTE, "main");
+	m_ClearPipelineState = m_RenderDevice->CreateComputePipelineState(m_ClearFunction);
+
+	m_CullLibrary = m_RenderDevice->CreateLibrary(cullShaderSource);
+	m_CullFunction = m_CullLibrary->CreateFunction(FUNCTIONTYPE_COMPUTE, "main");
+	m_CullPipelineState = m_RenderDevice->CreateComputePipelineState(m_CullFunction);
+
+	m_IndirectBuffer = m_RenderDevice->CreateBuffer(BUFFERTYPE_STORAGE, static_cast<long long>(maxObjectCount) * sizeof(DrawIndexedIndirectArguments));
+	m_DrawCountBuffer = m_RenderDevice->CreateBuffer(BUFFERTYPE_STORAGE, sizeof(unsigned int));
+}
+
+GpuCullingPass::~GpuCullingPass()
+{
+	m_RenderDevice->DestroyBuffer(m_DrawCountBuffer);
+	m_RenderDevice->DestroyBuffer(m_IndirectBuffer);
+
+	m_RenderDevice->DestroyComputePipelineState(m_CullPipelineState);
+	m_CullLibrary->DestroyFunction(m_CullFunction);
+	m_RenderDevice->DestroyLibrary(m_CullLibrary);
+
+	m_RenderDevice->DestroyComputePipelineState(m_ClearPipelineState);
+	m_ClearLibrary->DestroyFunction(m_ClearFunction);
+	m_RenderDevice->DestroyLibrary(m_ClearLibrary);
+}
+
+void GpuCullingPass::Encode(ComputeCommandEncoder *encoder, const glm::mat4 &viewProjection, CullBoundsType boundsType,
+	Buffer *bounds, Buffer *drawArguments, unsigned int objectCount, Texture2D *hiZ)
+{
+	if(objectCount > m_MaxObjectCount)
+		objectCount = m_MaxObjectCount;
+
+	// clear the previous survivors
+	ClearParams clearParams = {};
+	clearParams.maxObjectCount = m_MaxObjectCount;
+
+	encoder->SetComputePipelineState(m_ClearPipelineState);
+	encoder->SetBuffer(m_IndirectBuffer, 0, 2);
+	encoder->SetBuffer(m_DrawCountBuffer, 0, 3);
+	encoder->SetBytes(&clearParams, sizeof(clearParams), 0);
+	encoder->DispatchThreadgroups((m_MaxObjectCount + kThreadgroupSize - 1) / kThreadgroupSize, 1, 1);
+
+	if(objectCount == 0)
+		return;
+
+	CullParams params;
+	params.viewProjection = viewProjection;
+	params.objectCount = objectCount;
+	params.boundsType = static_cast<unsigned int>(boundsType);
+	params.useHiZ = hiZ ? 1 : 0;
+	params.padding = 0;
+
+	ExtractFrustumPlanes(viewProjection, params.planes);
+
+	encoder->SetComputePipelineState(m_CullPipelineState);
+	encoder->SetBuffer(bounds, 0, 0);
+	encoder->SetBuffer(drawArguments, 0, 1);
+	encoder->SetBytes(&params, sizeof(params), 0);
+	if(hiZ)
+		encoder->SetTexture(hiZ, 0);
+	encoder->DispatchThreadgroups((objectCount + kThreadgroupSize - 1) / kThreadgroupSize, 1, 1);
+}
+
+} // end namespace render
@@ -0,0 +1,226 @@
+#include "render_device/hiz_pyramid.h"
+
+namespace render
+{
+
+static const int kTileSize = 32; // texels of the first written level per threadgroup
+static const int kLevelsPerDispatch = 8;
+
+// Writes levelCount consecutive pyramid levels starting from a source level, or from the depth texture
+static const char *downsampleShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 16, local_size_y = 16) in;\n"
+	"layout(binding = 0) uniform sampler2D source;\n"
+	"layout(rg32f, binding = 0) uniform coherent image2D levels[8];\n"
+	"layout(std430, binding = 0) coherent buffer CounterBuffer {\n"
+	"   uint finishedThreadgroups;\n"
+	"};\n"
+	"layout(std140, binding = 0) uniform HiZParams {\n"
+	"   ivec2 sourceSize;\n"
+	"   ivec2 firstSize;\n"
+	"   int sourceLevel;\n"
+	"   int levelCount;\n"
+	"   uint threadgroupCount;\n"
+	"   uint fromDepth;\n"
+	"};\n"
+	"shared vec2 tile[32][32];\n"
+	"shared bool isLastThreadgroup;\n"
+	"// (farthest, nearest); the identity of the reduction fills texels outside the level\n"
+	"const vec2 emptyDepth = vec2(0.0, 1.0);\n"
+	"vec2 Reduce(vec2 a, vec2 b, vec2 c, vec2 d)\n"
+	"{\n"
+	"   return vec2(max(max(a.x, b.x), max(c.x, d.x)), min(min(a.y, b.y), min(c.y, d.y)));\n"
+	"}\n"
+	"vec2 ReduceSource(ivec2 texel)\n"
+	"{\n"
+	"   if(fromDepth != 0u)\n"
+	"   {\n"
+	"      // every depth texel the pyramid texel overlaps, so the bounds stay conservative\n"
+	"      ivec2 begin = (texel * sourceSize) / firstSize;\n"
+	"      ivec2 end = ((texel + 1) * sourceSize + firstSize - 1) / firstSize;\n"
+	"      vec2 result = emptyDepth;\n"
+	"      for(int y = begin.y; y < end.y; y++)\n"
+	"         for(int x = begin.x; x < end.x; x++)\n"
+	"         {\n"
+	"            float depth = texelFetch(source, ivec2(x, y), 0).r;\n"
+	"            result = vec2(max(result.x, depth), min(result.y, depth));\n"
+	"         }\n"
+	"      return result;\n"
+	"   }\n"
+	"   ivec2 base = texel * 2;\n"
+	"   ivec2 last = sourceSize - 1;\n"
+	"   return Reduce(texelFetch(source, min(base, last), sourceLevel).rg,\n"
+	"                 texelFetch(source, min(base + ivec2(1, 0), last), sourceLevel).rg,\n"
+	"                 texelFetch(source, min(base + ivec2(0, 1), last), sourceLevel).rg,\n"
+	"                 texelFetch(source, min(base + ivec2(1, 1), last), sourceLevel).rg);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"   ivec2 local = ivec2(gl_LocalInvocationID.xy);\n"
+	"   ivec2 group = ivec2(gl_WorkGroupID.xy);\n"
+	"   // first level: 2x2 texels per thread\n"
+	"   for(int i = 0; i < 4; i++)\n"
+	"   {\n"
+	"      ivec2 tileTexel = local * 2 + ivec2(i & 1, i >> 1);\n"
+	"      ivec2 texel = group * 32 + tileTexel;\n"
+	"      vec2 value = emptyDepth;\n"
+	"      if(all(lessThan(texel, firstSize)))\n"
+	"      {\n"
+	"         value = ReduceSource(texel);\n"
+	"         imageStore(levels[0], texel, vec4(value, 0.0, 0.0));\n"
+	"      }\n"
+	"      tile[tileTexel.y][tileTexel.x] = value;\n"
+	"   }\n"
+	"   barrier();\n"
+	"   // next five levels from shared memory\n"
+	"   int tileSize = 32;\n"
+	"   for(int level = 1; level < 6 && level < levelCount; level++)\n"
+	"   {\n"
+	"      tileSize /= 2;\n"
+	"      bool writesTexel = all(lessThan(local, ivec2(tileSize)));\n"
+	"      vec2 value = emptyDepth;\n"
+	"      if(writesTexel)\n"
+	"      {\n"
+	"         ivec2 base = local * 2;\n"
+	"         value = Reduce(tile[base.y][base.x], tile[base.y][base.x + 1], tile[base.y + 1][base.x], tile[base.y + 1][base.x + 1]);\n"
+	"      }\n"
+	"      barrier();\n"
+	"      if(writesTexel)\n"
+	"      {\n"
+	"         tile[local.y][local.x] = value;\n"
+	"         ivec2 texel = group * tileSize + local;\n"
+	"         if(all(lessThan(texel, max(firstSize >> level, ivec2(1)))))\n"
+	"            imageStore(levels[level], texel, vec4(value, 0.0, 0.0));\n"
+	"      }\n"
+	"      barrier();\n"
+	"   }\n"
+	"   if(levelCount <= 6)\n"
+	"      return;\n"
+	"   // the last threadgroup to finish reduces the remaining levels from every threadgroup's output\n"
+	"   memoryBarrierImage();\n"
+	"   barrier();\n"
+	"   if(gl_LocalInvocationIndex == 0u)\n"
+	"      isLastThreadgroup = atomicAdd(finishedThreadgroups, 1u) == threadgroupCount - 1u;\n"
+	"   barrier();\n"
+	"   if(!isLastThreadgroup)\n"
+	"      return;\n"
+	"   for(int level = 6; level < levelCount; level++)\n"
+	"   {\n"
+	"      ivec2 size = max(firstSize >> level, ivec2(1));\n"
+	"      ivec2 last = max(firstSize >> (level - 1), ivec2(1)) - 1;\n"
+	"      for(int i = int(gl_LocalInvocationIndex); i < size.x * size.y; i += 256)\n"
+	"      {\n"
+	"         ivec2 texel = ivec2(i % size.x, i / size.x);\n"
+	"         ivec2 base = texel * 2;\n"
+	"         vec2 value = Reduce(imageLoad(levels[level - 1], min(base, last)).rg,\n"
+	"                             imageLoad(levels[level - 1], min(base + ivec2(1, 0), last)).rg,\n"
+	"                             imageLoad(levels[level - 1], min(base + ivec2(0, 1), last)).rg,\n"
+	"                             imageLoad(levels[level - 1], min(base + ivec2(1, 1), last)).rg);\n"
+	"         imageStore(levels[level], texel, vec4(value, 0.0, 0.0));\n"
+	"      }\n"
+	"      memoryBarrierImage();\n"
+	"      barrier();\n"
+	"   }\n"
+	"   // ready for the next dispatch\n"
+	"   if(gl_LocalInvocationIndex == 0u)\n"
+	"      finishedThreadgroups = 0u;\n"
+	"}\n";
+
+// Matches the std140 HiZParams block above
+struct HiZParams
+{
+	int sourceSize[2];
+	int firstSize[2];
+	int sourceLevel;
+	int levelCount;
+	unsigned int threadgroupCount;
+	unsigned int fromDepth;
+};
+
+static int PreviousPowerOfTwo(int value)
+{
+	int result = 1;
+	while(result * 2 <= value)
+		result *= 2;
+	return result;
+}
+
+static int LevelSize(int size, int level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+HiZPyramidPass::HiZPyramidPass(RenderDevice *renderDevice, int depthWidth, int depthHeight)
+: m_RenderDevice(renderDevice), m_DepthWidth(depthWidth), m_DepthHeight(depthHeight)
+{
+	m_PyramidWidth = PreviousPowerOfTwo(depthWidth);
+	m_PyramidHeight = PreviousPowerOfTwo(depthHeight);
+
+	m_MipLevelCount = 1;
+	for(int size = m_PyramidWidth > m_PyramidHeight ? m_PyramidWidth : m_PyramidHeight; size > 1; size /= 2)
+		m_MipLevelCount++;
+
+	m_Library = m_RenderDevice->CreateLibrary(downsampleShaderSource);
+	m_Function = m_Library->CreateFunction(FUNCTIONTYPE_COMPUTE, "main");
+	m_PipelineState = m_RenderDevice->CreateComputePipelineState(m_Function);
+
+	m_PyramidTexture = m_RenderDevice->CreateTexture2D(m_PyramidWidth, m_PyramidHeight, PIXELFORMAT_RG32_FLOAT, m_MipLevelCount);
+
+	unsigned int zero = 0;
+	m_CounterBuffer = m_RenderDevice->CreateBuffer(BUFFERTYPE_STORAGE, sizeof(zero), &zero);
+}
+
+HiZPyramidPass::~HiZPyramidPass()
+{
+	m_RenderDevice->DestroyBuffer(m_CounterBuffer);
+	m_RenderDevice->DestroyTexture2D(m_PyramidTexture);
+
+	m_RenderDevice->DestroyComputePipelineState(m_PipelineState);
+	m_Library->DestroyFunction(m_Function);
+	m_RenderDevice->DestroyLibrary(m_Library);
+}
+
+void HiZPyramidPass::Encode(ComputeCommandEncoder *encoder, Texture2D *depthTexture)
+{
+	encoder->SetComputePipelineState(m_PipelineState);
+	encoder->SetBuffer(m_CounterBuffer, 0, 0);
+
+	for(int firstLevel = 0; firstLevel < m_MipLevelCount; firstLevel += kLevelsPerDispatch)
+	{
+		int levelCount = m_MipLevelCount - firstLevel < kLevelsPerDispatch ? m_MipLevelCount - firstLevel : kLevelsPerDispatch;
+		int firstWidth = LevelSize(m_PyramidWidth, firstLevel);
+		int firstHeight = LevelSize(m_PyramidHeight, firstLevel);
+		int threadgroupsX = (firstWidth + kTileSize - 1) / kTileSize;
+		int threadgroupsY = (firstHeight + kTileSize - 1) / kTileSize;
+
+		HiZParams params;
+		params.firstSize[0] = firstWidth;
+		params.firstSize[1] = firstHeight;
+		params.levelCount = levelCount;
+		params.threadgroupCount = static_cast<unsigned int>(threadgroupsX * threadgroupsY);
+		if(firstLevel == 0)
+		{
+			params.sourceSize[0] = m_DepthWidth;
+			params.sourceSize[1] = m_DepthHeight;
+			params.sourceLevel = 0;
+			params.fromDepth = 1;
+			encoder->SetTexture(depthTexture, 0);
+		}
+		else
+		{
+			params.sourceSize[0] = LevelSize(m_PyramidWidth, firstLevel - 1);
+			params.sourceSize[1] = LevelSize(m_PyramidHeight, firstLevel - 1);
+			params.sourceLevel = firstLevel - 1;
+			params.fromDepth = 0;
+			encoder->SetTexture(m_PyramidTexture, 0);
+		}
+
+		for(int i = 0; i < levelCount; i++)
+			encoder->SetStorageTexture(m_PyramidTexture, i, firstLevel + i);
+
+		encoder->SetBytes(&params, sizeof(params), 0);
+		encoder->DispatchThreadgroups(threadgroupsX, threadgroupsY, 1);
+	}
+}
+
+} // end namespace render
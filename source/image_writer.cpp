@@ -0,0 +1,380 @@
+#include "render_device/image_writer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(RENDER_DEVICE_HAS_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace render
+{
+
+// IDAT chunks are written as the deflate output fills this much
+static const size_t kChunkSize = 256 * 1024;
+
+// the largest block a stored deflate stream can carry
+static const size_t kStoredBlockSize = 65535;
+
+struct Crc32Table
+{
+	uint32_t entries[256];
+
+	Crc32Table()
+	{
+		for(uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for(int bit = 0; bit < 8; bit++)
+				value = value & 1 ? 0xedb88320u ^ (value >> 1) : value >> 1;
+			entries[i] = value;
+		}
+	}
+};
+
+static uint32_t Crc32(uint32_t crc, const unsigned char *data, size_t size)
+{
+	static const Crc32Table table;
+
+	crc = ~crc;
+	for(size_t i = 0; i < size; i++)
+		crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+#if !defined(RENDER_DEVICE_HAS_ZLIB)
+static uint32_t Adler32(uint32_t adler, const unsigned char *data, size_t size)
+{
+	uint32_t a = adler & 0xffff, b = adler >> 16;
+	while(size > 0)
+	{
+		// 5552 bytes is the most that can be summed before b could overflow
+		size_t blockSize = size < 5552 ? size : 5552;
+		for(size_t i = 0; i < blockSize; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += blockSize;
+		size -= blockSize;
+	}
+	return (b << 16) | a;
+}
+#endif
+
+static void StoreBigEndian(unsigned char *bytes, uint32_t value)
+{
+	bytes[0] = static_cast<unsigned char>(value >> 24);
+	bytes[1] = static_cast<unsigned char>(value >> 16);
+	bytes[2] = static_cast<unsigned char>(value >> 8);
+	bytes[3] = static_cast<unsigned char>(value);
+}
+
+ImageStreamWriter *ImageStreamWriter::Create(const char *path, ImageFileFormat format, uint32_t width, uint32_t height)
+{
+	if(width == 0 || height == 0 || width > 0x7fffffffu / 4 || height > 0x7fffffffu)
+		return nullptr;
+
+	FILE *file = fopen(path, "wb");
+	if(!file)
+	{
+		printf("ERROR::IMAGEWRITER::OPEN_FAILED %s\n", path);
+		return nullptr;
+	}
+
+	ImageStreamWriter *writer = new ImageStreamWriter();
+	writer->m_File = file;
+	writer->m_Format = format;
+	writer->m_Width = width;
+	writer->m_Height = height;
+
+	if(format == IMAGEFILEFORMAT_QOI)
+	{
+		unsigned char header[14] = { 'q', 'o', 'i', 'f' };
+		StoreBigEndian(header + 4, width);
+		StoreBigEndian(header + 8, height);
+		header[12] = 4; // RGBA
+		header[13] = 0; // sRGB with linear alpha
+		writer->m_OutputBuffer = static_cast<unsigned char *>(malloc(kChunkSize));
+		writer->Emit(header, sizeof(header));
+	}
+	else if(format == IMAGEFILEFORMAT_PNG)
+	{
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		fwrite(signature, 1, sizeof(signature), file);
+
+		unsigned char header[13];
+		StoreBigEndian(header, width);
+		StoreBigEndian(header + 4, height);
+		header[8] = 8; // bits per channel
+		header[9] = 6; // RGBA
+		header[10] = 0; // deflate
+		header[11] = 0; // adaptive filtering
+		header[12] = 0; // not interlaced
+		writer->WriteChunk("IHDR", header, sizeof(header));
+
+		writer->m_FilteredRow = static_cast<unsigned char *>(malloc(1 + static_cast<size_t>(width) * 4));
+		writer->m_OutputBuffer = static_cast<unsigned char *>(malloc(kChunkSize));
+
+#if defined(RENDER_DEVICE_HAS_ZLIB)
+		// posters run to gigabytes, so favor throughput over the last few percent of size
+		z_stream *stream = new z_stream();
+		deflateInit(stream, Z_BEST_SPEED);
+		stream->next_out = writer->m_OutputBuffer;
+		stream->avail_out = static_cast<uInt>(kChunkSize);
+		writer->m_DeflateStream = stream;
+#else
+		static const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+		writer->Emit(zlibHeader, sizeof(zlibHeader));
+		writer->m_StoredBlock = static_cast<unsigned char *>(malloc(kStoredBlockSize));
+#endif
+	}
+
+	return writer;
+}
+
+ImageStreamWriter::~ImageStreamWriter()
+{
+	if(m_File)
+		Finish();
+
+#if defined(RENDER_DEVICE_HAS_ZLIB)
+	if(m_DeflateStream)
+	{
+		deflateEnd(static_cast<z_stream *>(m_DeflateStream));
+		delete static_cast<z_stream *>(m_DeflateStream);
+	}
+#endif
+	free(m_StoredBlock);
+	free(m_OutputBuffer);
+	free(m_FilteredRow);
+}
+
+bool ImageStreamWriter::WriteRows(const unsigned char *rows, ptrdiff_t stride, uint32_t rowCount)
+{
+	if(!m_File || rowCount > m_Height - m_RowsWritten)
+		return false;
+
+	size_t rowSize = static_cast<size_t>(m_Width) * 4;
+	for(uint32_t row = 0; row < rowCount && !m_Failed; row++, rows += stride)
+	{
+		if(m_Format == IMAGEFILEFORMAT_RAW)
+		{
+			m_Failed = fwrite(rows, 1, rowSize, m_File) != rowSize;
+			continue;
+		}
+		if(m_Format == IMAGEFILEFORMAT_QOI)
+		{
+			EncodeQoi(rows, m_Width);
+			continue;
+		}
+
+		// the Sub filter costs one subtraction per byte and suits smooth rendered images
+		m_FilteredRow[0] = 1;
+		memcpy(m_FilteredRow + 1, rows, 4);
+		for(size_t i = 4; i < rowSize; i++)
+			m_FilteredRow[1 + i] = static_cast<unsigned char>(rows[i] - rows[i - 4]);
+		Deflate(m_FilteredRow, 1 + rowSize, false);
+	}
+
+	m_RowsWritten += rowCount;
+	return !m_Failed;
+}
+
+bool ImageStreamWriter::Finish()
+{
+	if(!m_File)
+		return false;
+
+	if(m_Format == IMAGEFILEFORMAT_PNG)
+	{
+		Deflate(nullptr, 0, true);
+		FlushOutput();
+		WriteChunk("IEND", nullptr, 0);
+	}
+	else if(m_Format == IMAGEFILEFORMAT_QOI)
+	{
+		if(m_QoiRun > 0)
+		{
+			unsigned char run = static_cast<unsigned char>(0xc0 | (m_QoiRun - 1));
+			Emit(&run, 1);
+		}
+		static const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+		Emit(padding, sizeof(padding));
+		FlushOutput();
+	}
+
+	m_Failed |= fclose(m_File) != 0;
+	m_File = nullptr;
+	return !m_Failed && m_RowsWritten == m_Height;
+}
+
+bool ImageStreamWriter::WriteChunk(const char type[4], const unsigned char *data, size_t size)
+{
+	unsigned char length[4], crcBytes[4];
+	StoreBigEndian(length, static_cast<uint32_t>(size));
+	uint32_t crc = Crc32(0, reinterpret_cast<const unsigned char *>(type), 4);
+	if(size > 0)
+		crc = Crc32(crc, data, size);
+	StoreBigEndian(crcBytes, crc);
+
+	m_Failed |= fwrite(length, 1, 4, m_File) != 4;
+	m_Failed |= fwrite(type, 1, 4, m_File) != 4;
+	if(size > 0)
+		m_Failed |= fwrite(data, 1, size, m_File) != size;
+	m_Failed |= fwrite(crcBytes, 1, 4, m_File) != 4;
+	return !m_Failed;
+}
+
+void ImageStreamWriter::Emit(const unsigned char *data, size_t size)
+{
+	while(size > 0)
+	{
+		size_t count = kChunkSize - m_OutputBufferUsed < size ? kChunkSize - m_OutputBufferUsed : size;
+		memcpy(m_OutputBuffer + m_OutputBufferUsed, data, count);
+		m_OutputBufferUsed += count;
+		data += count;
+		size -= count;
+
+		if(m_OutputBufferUsed == kChunkSize)
+			FlushOutput();
+	}
+}
+
+void ImageStreamWriter::FlushOutput()
+{
+	if(m_OutputBufferUsed == 0)
+		return;
+
+	if(m_Format == IMAGEFILEFORMAT_PNG)
+		WriteChunk("IDAT", m_OutputBuffer, m_OutputBufferUsed);
+	else
+		m_Failed |= fwrite(m_OutputBuffer, 1, m_OutputBufferUsed, m_File) != m_OutputBufferUsed;
+	m_OutputBufferUsed = 0;
+}
+
+void ImageStreamWriter::EncodeQoi(const unsigned char *pixels, uint32_t pixelCount)
+{
+	// the longest op is five bytes, so a pixel never straddles a flush
+	for(uint32_t i = 0; i < pixelCount; i++, pixels += 4)
+	{
+		if(kChunkSize - m_OutputBufferUsed < 8)
+			FlushOutput();
+		unsigned char *out = m_OutputBuffer + m_OutputBufferUsed;
+
+		if(memcmp(pixels, m_QoiPrevious, 4) == 0)
+		{
+			if(++m_QoiRun == 62)
+			{
+				*out++ = static_cast<unsigned char>(0xc0 | (m_QoiRun - 1));
+				m_QoiRun = 0;
+			}
+			m_OutputBufferUsed = out - m_OutputBuffer;
+			continue;
+		}
+
+		if(m_QoiRun > 0)
+		{
+			*out++ = static_cast<unsigned char>(0xc0 | (m_QoiRun - 1));
+			m_QoiRun = 0;
+		}
+
+		unsigned int hash = (pixels[0] * 3 + pixels[1] * 5 + pixels[2] * 7 + pixels[3] * 11) % 64;
+		if(memcmp(pixels, m_QoiIndex[hash], 4) == 0)
+			*out++ = static_cast<unsigned char>(hash);
+		else
+		{
+			memcpy(m_QoiIndex[hash], pixels, 4);
+			if(pixels[3] == m_QoiPrevious[3])
+			{
+				signed char dr = static_cast<signed char>(pixels[0] - m_QoiPrevious[0]);
+				signed char dg = static_cast<signed char>(pixels[1] - m_QoiPrevious[1]);
+				signed char db = static_cast<signed char>(pixels[2] - m_QoiPrevious[2]);
+				int drg = dr - dg, dbg = db - dg;
+				if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					*out++ = static_cast<unsigned char>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+				else if(dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+				{
+					*out++ = static_cast<unsigned char>(0x80 | (dg + 32));
+					*out++ = static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8));
+				}
+				else
+				{
+					*out++ = 0xfe;
+					memcpy(out, pixels, 3);
+					out += 3;
+				}
+			}
+			else
+			{
+				*out++ = 0xff;
+				memcpy(out, pixels, 4);
+				out += 4;
+			}
+		}
+
+		memcpy(m_QoiPrevious, pixels, 4);
+		m_OutputBufferUsed = out - m_OutputBuffer;
+	}
+}
+
+void ImageStreamWriter::Deflate(const unsigned char *data, size_t size, bool last)
+{
+#if defined(RENDER_DEVICE_HAS_ZLIB)
+	z_stream *stream = static_cast<z_stream *>(m_DeflateStream);
+	stream->next_in = const_cast<unsigned char *>(data);
+	stream->avail_in = static_cast<uInt>(size);
+	for(;;)
+	{
+		int result = deflate(stream, last ? Z_FINISH : Z_NO_FLUSH);
+		m_OutputBufferUsed = kChunkSize - stream->avail_out;
+		if(stream->avail_out == 0)
+		{
+			WriteChunk("IDAT", m_OutputBuffer, kChunkSize);
+			stream->next_out = m_OutputBuffer;
+			stream->avail_out = static_cast<uInt>(kChunkSize);
+			m_OutputBufferUsed = 0;
+			continue;
+		}
+		if(result == Z_STREAM_END || (!last && stream->avail_in == 0) || result == Z_STREAM_ERROR)
+			break;
+	}
+#else
+	// without zlib the data goes out uncompressed, in stored blocks
+	m_Adler = Adler32(m_Adler, data, size);
+	while(size > 0 || last)
+	{
+		size_t count = kStoredBlockSize - m_StoredBlockUsed < size ? kStoredBlockSize - m_StoredBlockUsed : size;
+		if(count > 0)
+			memcpy(m_StoredBlock + m_StoredBlockUsed, data, count);
+		m_StoredBlockUsed += count;
+		data += count;
+		size -= count;
+
+		bool final = last && size == 0;
+		if(m_StoredBlockUsed == kStoredBlockSize || final)
+		{
+			unsigned char blockHeader[5];
+			blockHeader[0] = final ? 1 : 0;
+			blockHeader[1] = static_cast<unsigned char>(m_StoredBlockUsed);
+			blockHeader[2] = static_cast<unsigned char>(m_StoredBlockUsed >> 8);
+			blockHeader[3] = static_cast<unsigned char>(~m_StoredBlockUsed);
+			blockHeader[4] = static_cast<unsigned char>(~m_StoredBlockUsed >> 8);
+			Emit(blockHeader, sizeof(blockHeader));
+			Emit(m_StoredBlock, m_StoredBlockUsed);
+			m_StoredBlockUsed = 0;
+		}
+		if(final)
+		{
+			unsigned char adler[4];
+			StoreBigEndian(adler, m_Adler);
+			Emit(adler, sizeof(adler));
+			break;
+		}
+	}
+#endif
+}
+
+} // end namespace render
@@ -0,0 +1,88 @@
+#include "ogl_frame_statistics.h"
+
+#include <cstring>
+
+namespace render
+{
+
+// Apply function to each counter of to with the same counter of from
+template<typename Function>
+static void ForEachCounter(FrameCounters &to, const FrameCounters &from, Function function)
+{
+	function(to.commandBufferCount, from.commandBufferCount);
+	function(to.commandCount, from.commandCount);
+	function(to.commandBytes, from.commandBytes);
+	function(to.largestCommandBufferBytes, from.largestCommandBufferBytes);
+	function(to.renderPassCount, from.renderPassCount);
+	function(to.computePassCount, from.computePassCount);
+	function(to.drawCount, from.drawCount);
+	function(to.instanceCount, from.instanceCount);
+	function(to.triangleCount, from.triangleCount);
+	function(to.dispatchCount, from.dispatchCount);
+	function(to.renderPipelineStateChangeCount, from.renderPipelineStateChangeCount);
+	function(to.computePipelineStateChangeCount, from.computePipelineStateChangeCount);
+	function(to.depthStencilStateChangeCount, from.depthStencilStateChangeCount);
+	function(to.vertexBufferChangeCount, from.vertexBufferChangeCount);
+	function(to.textureChangeCount, from.textureChangeCount);
+	function(to.samplerChangeCount, from.samplerChangeCount);
+	function(to.storageBufferChangeCount, from.storageBufferChangeCount);
+	function(to.viewportChangeCount, from.viewportChangeCount);
+	function(to.glCallCount, from.glCallCount);
+	function(to.bufferBytesUploaded, from.bufferBytesUploaded);
+	function(to.textureBytesUploaded, from.textureBytesUploaded);
+	function(to.uniformBufferCount, from.uniformBufferCount);
+	function(to.uniformBytesUploaded, from.uniformBytesUploaded);
+	function(to.cpuCycles, from.cpuCycles);
+	function(to.cpuInstructions, from.cpuInstructions);
+	function(to.l1DataCacheMisses, from.l1DataCacheMisses);
+	function(to.lastLevelCacheMisses, from.lastLevelCacheMisses);
+	function(to.branchMisses, from.branchMisses);
+}
+
+OpenGLFrameStatistics::OpenGLFrameStatistics()
+{
+	memset(&counters, 0, sizeof(counters));
+}
+
+void OpenGLFrameStatistics::Add(const FrameCounters &tally)
+{
+	ForEachCounter(counters, tally, [](unsigned long long &sum, unsigned long long value) { sum += value; });
+}
+
+void OpenGLFrameStatistics::EndFrame()
+{
+	m_Frames.push_back(counters);
+	if(m_Frames.size() > kWindowFrameCount)
+		m_Frames.pop_front();
+	memset(&counters, 0, sizeof(counters));
+	m_FrameIndex++;
+}
+
+void OpenGLFrameStatistics::GetFrameStatistics(FrameStatistics &statistics) const
+{
+	memset(&statistics, 0, sizeof(statistics));
+	if(m_Frames.empty())
+		return;
+
+	statistics.frameIndex = m_FrameIndex - 1;
+	statistics.frame = m_Frames.back();
+	for(const FrameCounters &frame : m_Frames)
+		ForEachCounter(statistics.average, frame, [](unsigned long long &sum, unsigned long long value) { sum += value; });
+
+	// ratios are taken of the window's sums, before they are rounded to an average
+	const FrameCounters &sum = statistics.average;
+	if(sum.cpuCycles > 0)
+		statistics.instructionsPerCycle = static_cast<double>(sum.cpuInstructions) / sum.cpuCycles;
+	if(sum.drawCount > 0)
+	{
+		statistics.l1DataCacheMissesPerDraw = static_cast<double>(sum.l1DataCacheMisses) / sum.drawCount;
+		statistics.lastLevelCacheMissesPerDraw = static_cast<double>(sum.lastLevelCacheMisses) / sum.drawCount;
+		statistics.branchMissesPerDraw = static_cast<double>(sum.branchMisses) / sum.drawCount;
+	}
+
+	unsigned long long frameCount = m_Frames.size();
+	ForEachCounter(statistics.average, statistics.average, [frameCount](unsigned long long &sum, unsigned long long) { sum /= frameCount; });
+	statistics.averageFrameCount = static_cast<unsigned int>(frameCount);
+}
+
+} // end namespace render
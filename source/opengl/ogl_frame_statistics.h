@@ -0,0 +1,42 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+#include <deque>
+
+// Issue an OpenGL call, counting it into the glCallCount of the FrameCounters given, so the
+// count stays next to the call it counts
+#define OGL_COUNTED(counters, call) ((counters).glCallCount++, call)
+
+namespace render
+{
+
+// The device's frame counters: those of the frame under way, counted into directly, and a
+// window of ended frames they are averaged over. Used from the device's thread only.
+class OpenGLFrameStatistics
+{
+public:
+
+	OpenGLFrameStatistics();
+
+	// Counted into by the commands as they execute
+	FrameCounters counters;
+
+	// Count a command buffer's tally into the frame
+	void Add(const FrameCounters &tally);
+
+	// Close the frame's counters and start the next at zero
+	void EndFrame();
+
+	void GetFrameStatistics(FrameStatistics &statistics) const;
+
+	// Ended frames averaged over at most
+	static const unsigned int kWindowFrameCount = 60;
+
+private:
+
+	std::deque<FrameCounters> m_Frames;
+	unsigned long long m_FrameIndex = 0;
+};
+
+} // end namespace render
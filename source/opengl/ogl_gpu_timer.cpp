@@ -0,0 +1,186 @@
+#include "ogl_gpu_timer.h"
+
+#include "render_device/frame_trace.h"
+
+#include <algorithm>
+
+namespace render
+{
+
+OpenGLGpuTimer::~OpenGLGpuTimer()
+{
+	ReleaseQueries(m_Frame);
+	for(Frame &frame : m_PendingFrames)
+		ReleaseQueries(frame);
+	if(!m_FreeQueries.empty())
+		glDeleteQueries(static_cast<GLsizei>(m_FreeQueries.size()), m_FreeQueries.data());
+}
+
+GLuint OpenGLGpuTimer::AcquireQuery()
+{
+	GLuint query;
+	if(m_FreeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = m_FreeQueries.back();
+		m_FreeQueries.pop_back();
+	}
+	return query;
+}
+
+void OpenGLGpuTimer::ReleaseQueries(Frame &frame)
+{
+	for(const Zone &zone : frame.zones)
+	{
+		m_FreeQueries.push_back(zone.beginQuery);
+		if(zone.endQuery)
+			m_FreeQueries.push_back(zone.endQuery);
+	}
+	frame.zones.clear();
+}
+
+void OpenGLGpuTimer::Begin(const std::string &name)
+{
+	if(m_DebugGroupsSupported)
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+
+	if(m_SkippedDepth > 0 || m_Frame.zones.size() >= kMaxZoneCount)
+	{
+		m_SkippedDepth++;
+		return;
+	}
+
+	Zone zone;
+	zone.name = name;
+	zone.depth = static_cast<unsigned int>(m_OpenZones.size());
+	zone.beginQuery = AcquireQuery();
+	zone.endQuery = 0;
+	glQueryCounter(zone.beginQuery, GL_TIMESTAMP);
+
+	m_OpenZones.push_back(m_Frame.zones.size());
+	m_Frame.zones.push_back(zone);
+}
+
+void OpenGLGpuTimer::End()
+{
+	if(m_SkippedDepth > 0)
+	{
+		m_SkippedDepth--;
+	}
+	else if(!m_OpenZones.empty())
+	{
+		Zone &zone = m_Frame.zones[m_OpenZones.back()];
+		m_OpenZones.pop_back();
+		zone.endQuery = AcquireQuery();
+		glQueryCounter(zone.endQuery, GL_TIMESTAMP);
+	}
+	else
+	{
+		return;
+	}
+
+	if(m_DebugGroupsSupported)
+		glPopDebugGroup();
+}
+
+bool OpenGLGpuTimer::IsAvailable(const Frame &frame)
+{
+	// timestamps complete in order, but the results are only promised once each says so
+	for(auto zone = frame.zones.rbegin(); zone != frame.zones.rend(); ++zone)
+	{
+		GLint available[2] = { GL_FALSE, GL_FALSE };
+		glGetQueryObjectiv(zone->endQuery, GL_QUERY_RESULT_AVAILABLE, &available[0]);
+		glGetQueryObjectiv(zone->beginQuery, GL_QUERY_RESULT_AVAILABLE, &available[1]);
+		if(!available[0] || !available[1])
+			return false;
+	}
+	return true;
+}
+
+void OpenGLGpuTimer::EndFrame()
+{
+	while(!m_OpenZones.empty())
+		End();
+	m_SkippedDepth = 0;
+
+	unsigned long long frameIndex = m_Frame.frameIndex;
+	if(!m_Frame.zones.empty())
+	{
+		m_PendingFrames.push_back(Frame());
+		std::swap(m_PendingFrames.back(), m_Frame);
+	}
+	m_Frame.frameIndex = frameIndex + 1;
+
+	// a GPU that far behind has its oldest frames go untimed
+	while(m_PendingFrames.size() > kMaxPendingFrameCount)
+	{
+		ReleaseQueries(m_PendingFrames.front());
+		m_PendingFrames.pop_front();
+	}
+
+#ifdef RENDER_DEVICE_TRACE
+	// the GPU's clock is set against the trace's once per frame, drifting too little to matter
+	// over the frames a timing waits
+	long long gpuToTraceTime = 0;
+	bool calibrated = false;
+#endif
+
+	while(!m_PendingFrames.empty() && IsAvailable(m_PendingFrames.front()))
+	{
+		Frame &frame = m_PendingFrames.front();
+
+		std::vector<GLuint64> begins(frame.zones.size()), ends(frame.zones.size());
+		for(size_t i = 0; i < frame.zones.size(); i++)
+		{
+			glGetQueryObjectui64v(frame.zones[i].beginQuery, GL_QUERY_RESULT, &begins[i]);
+			glGetQueryObjectui64v(frame.zones[i].endQuery, GL_QUERY_RESULT, &ends[i]);
+		}
+		GLuint64 frameBegin = *std::min_element(begins.begin(), begins.end());
+		GLuint64 frameEnd = *std::max_element(ends.begin(), ends.end());
+
+		m_TimingNames.resize(frame.zones.size());
+		m_Timings.resize(frame.zones.size());
+		for(size_t i = 0; i < frame.zones.size(); i++)
+		{
+			m_TimingNames[i] = frame.zones[i].name;
+			m_Timings[i].name = m_TimingNames[i].c_str();
+			m_Timings[i].depth = frame.zones[i].depth;
+			m_Timings[i].startMilliseconds = (begins[i] - frameBegin) / 1000000.0;
+			m_Timings[i].durationMilliseconds = ends[i] > begins[i] ? (ends[i] - begins[i]) / 1000000.0 : 0.0;
+		}
+#ifdef RENDER_DEVICE_TRACE
+		if(!calibrated)
+		{
+			GLint64 gpuTime = 0;
+			glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+			gpuToTraceTime = static_cast<long long>(GetTraceTime()) - gpuTime;
+			calibrated = true;
+		}
+		for(size_t i = 0; i < frame.zones.size(); i++)
+		{
+			long long begin = std::max(static_cast<long long>(begins[i]) + gpuToTraceTime, 0ll);
+			long long end = std::max(static_cast<long long>(ends[i]) + gpuToTraceTime, begin);
+			AddGpuTraceZone(frame.zones[i].name.c_str(), frame.zones[i].depth, begin, end);
+		}
+#endif
+
+		m_TimedFrameIndex = frame.frameIndex;
+		m_TimedFrameMilliseconds = (frameEnd - frameBegin) / 1000000.0;
+
+		ReleaseQueries(frame);
+		m_PendingFrames.pop_front();
+	}
+}
+
+void OpenGLGpuTimer::GetFrameGpuTimings(FrameGpuTimings &timings) const
+{
+	timings.frameIndex = m_TimedFrameIndex;
+	timings.frameMilliseconds = m_TimedFrameMilliseconds;
+	timings.timings = m_Timings.empty() ? nullptr : m_Timings.data();
+	timings.timingCount = static_cast<unsigned int>(m_Timings.size());
+}
+
+} // end namespace render
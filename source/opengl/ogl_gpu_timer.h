@@ -0,0 +1,86 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+#include "ogl_loader.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+// GPU timings of passes and debug groups from timestamp queries taken as the command buffer
+// executes. Each frame's queries are read once they are all available, a few frames later,
+// so reading never waits on the GPU. Timestamps rather than elapsed-time queries are used
+// because those cannot nest. Used from the device's thread only.
+class OpenGLGpuTimer
+{
+public:
+
+	~OpenGLGpuTimer();
+
+	// Use debug groups of KHR_debug as well, for tools capturing the frame
+	void SetDebugGroupsSupported(bool supported) { m_DebugGroupsSupported = supported; }
+
+	// Take a timestamp opening a zone nested in the one open; past kMaxZoneCount zones in a
+	// frame, zones are left out
+	void Begin(const std::string &name);
+
+	// Take a timestamp closing the innermost open zone
+	void End();
+
+	// Close the frame and read the oldest ones whose queries have all arrived
+	void EndFrame();
+
+	void GetFrameGpuTimings(FrameGpuTimings &timings) const;
+
+	// Zones taken per frame at most, so frames never ended do not grow without bound
+	static const unsigned int kMaxZoneCount = 1024;
+
+	// Frames waiting for their queries at most; older ones are dropped
+	static const unsigned int kMaxPendingFrameCount = 4;
+
+private:
+
+	struct Zone
+	{
+		std::string name;
+		unsigned int depth;
+		GLuint beginQuery;
+		GLuint endQuery; // 0 while open
+	};
+
+	struct Frame
+	{
+		unsigned long long frameIndex = 0;
+		std::vector<Zone> zones;
+	};
+
+	GLuint AcquireQuery();
+
+	// Whether every query of the frame has its result
+	static bool IsAvailable(const Frame &frame);
+
+	void ReleaseQueries(Frame &frame);
+
+	Frame m_Frame;
+
+	// Zones of m_Frame still open, innermost last
+	std::vector<size_t> m_OpenZones;
+	unsigned int m_SkippedDepth = 0;
+
+	std::deque<Frame> m_PendingFrames;
+	std::vector<GLuint> m_FreeQueries;
+
+	// The latest frame read
+	unsigned long long m_TimedFrameIndex = 0;
+	double m_TimedFrameMilliseconds = 0;
+	std::vector<GpuTiming> m_Timings;
+	std::vector<std::string> m_TimingNames;
+
+	bool m_DebugGroupsSupported = false;
+};
+
+} // end namespace render
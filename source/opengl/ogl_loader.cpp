@@ -0,0 +1,122 @@
+#include "ogl_loader.h"
+
+#include "render_device/platform.h"
+
+#include <iostream>
+#include <mutex>
+
+#ifdef OGL_LOAD_GL_VERSION_4_1
+PFNGLGETPROGRAMBINARYPROC ogl_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC ogl_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC ogl_glProgramParameteri = nullptr;
+PFNGLSHADERBINARYPROC ogl_glShaderBinary = nullptr;
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_2
+PFNGLMEMORYBARRIERPROC ogl_glMemoryBarrier = nullptr;
+PFNGLBINDIMAGETEXTUREPROC ogl_glBindImageTexture = nullptr;
+PFNGLTEXSTORAGE2DPROC ogl_glTexStorage2D = nullptr;
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_3
+PFNGLDISPATCHCOMPUTEPROC ogl_glDispatchCompute = nullptr;
+PFNGLDISPATCHCOMPUTEINDIRECTPROC ogl_glDispatchComputeIndirect = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC ogl_glMultiDrawElementsIndirect = nullptr;
+PFNGLGETPROGRAMINTERFACEIVPROC ogl_glGetProgramInterfaceiv = nullptr;
+PFNGLGETPROGRAMRESOURCEIVPROC ogl_glGetProgramResourceiv = nullptr;
+PFNGLGETPROGRAMRESOURCENAMEPROC ogl_glGetProgramResourceName = nullptr;
+PFNGLSHADERSTORAGEBLOCKBINDINGPROC ogl_glShaderStorageBlockBinding = nullptr;
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_6
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC ogl_glMultiDrawElementsIndirectCount = nullptr;
+PFNGLSPECIALIZESHADERPROC ogl_glSpecializeShader = nullptr;
+#endif
+
+#ifdef OGL_LOAD_GL_KHR_parallel_shader_compile
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ogl_glMaxShaderCompilerThreadsKHR = nullptr;
+#endif
+
+#ifdef OGL_LOAD_GL_KHR_debug
+PFNGLPUSHDEBUGGROUPPROC ogl_glPushDebugGroup = nullptr;
+PFNGLPOPDEBUGGROUPPROC ogl_glPopDebugGroup = nullptr;
+#endif
+
+namespace render
+{
+
+template<typename T>
+static bool LoadFunction(T &function, const char *name)
+{
+	function = reinterpret_cast<T>(platform::GetPlatformProcAddress(name));
+	if(!function)
+	{
+		std::cout << "ERROR::OPENGL::MISSING_FUNCTION " << name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Optional entry points may also be exposed under an extension name
+template<typename T>
+static void LoadOptionalFunction(T &function, const char *name, const char *extensionName)
+{
+	function = reinterpret_cast<T>(platform::GetPlatformProcAddress(name));
+	if(!function)
+		function = reinterpret_cast<T>(platform::GetPlatformProcAddress(extensionName));
+}
+
+static bool LoadOpenGLFunctionsOnce()
+{
+	bool success = true;
+
+#ifdef OGL_LOAD_GL_VERSION_4_1
+	success &= LoadFunction(ogl_glGetProgramBinary, "glGetProgramBinary");
+	success &= LoadFunction(ogl_glProgramBinary, "glProgramBinary");
+	success &= LoadFunction(ogl_glProgramParameteri, "glProgramParameteri");
+	success &= LoadFunction(ogl_glShaderBinary, "glShaderBinary");
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_2
+	success &= LoadFunction(ogl_glMemoryBarrier, "glMemoryBarrier");
+	success &= LoadFunction(ogl_glBindImageTexture, "glBindImageTexture");
+	success &= LoadFunction(ogl_glTexStorage2D, "glTexStorage2D");
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_3
+	success &= LoadFunction(ogl_glDispatchCompute, "glDispatchCompute");
+	success &= LoadFunction(ogl_glDispatchComputeIndirect, "glDispatchComputeIndirect");
+	success &= LoadFunction(ogl_glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+	success &= LoadFunction(ogl_glGetProgramInterfaceiv, "glGetProgramInterfaceiv");
+	success &= LoadFunction(ogl_glGetProgramResourceiv, "glGetProgramResourceiv");
+	success &= LoadFunction(ogl_glGetProgramResourceName, "glGetProgramResourceName");
+	success &= LoadFunction(ogl_glShaderStorageBlockBinding, "glShaderStorageBlockBinding");
+#endif
+
+#ifdef OGL_LOAD_GL_VERSION_4_6
+	LoadOptionalFunction(ogl_glMultiDrawElementsIndirectCount, "glMultiDrawElementsIndirectCount", "glMultiDrawElementsIndirectCountARB");
+	LoadOptionalFunction(ogl_glSpecializeShader, "glSpecializeShader", "glSpecializeShaderARB");
+#endif
+
+#ifdef OGL_LOAD_GL_KHR_parallel_shader_compile
+	LoadOptionalFunction(ogl_glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB");
+#endif
+
+#ifdef OGL_LOAD_GL_KHR_debug
+	LoadOptionalFunction(ogl_glPushDebugGroup, "glPushDebugGroup", "glPushDebugGroupKHR");
+	LoadOptionalFunction(ogl_glPopDebugGroup, "glPopDebugGroup", "glPopDebugGroupKHR");
+#endif
+
+	return success;
+}
+
+bool LoadOpenGLFunctions()
+{
+	// the pointers are shared by every context, which may be created on several threads at once
+	static std::once_flag loaded;
+	static bool success = false;
+	std::call_once(loaded, []() { success = LoadOpenGLFunctionsOnce(); });
+	return success;
+}
+
+} // end namespace render
@@ -0,0 +1,170 @@
+#pragma once
+
+// The glad loader bundled with GLFW only covers the OpenGL 3.3 core profile.
+// Entry points and enums from later core versions that the OpenGL render device
+// relies on are declared here and resolved by LoadOpenGLFunctions once a context
+// is current, through the platform's proc address lookup. When glad already
+// provides a version, its declarations are used.
+
+#include <glad/gl.h>
+
+#ifndef GL_VERSION_4_0
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_SAMPLER_CUBE_MAP_ARRAY 0x900C
+#define GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY 0x900F
+#endif
+
+#ifndef GL_VERSION_4_1
+#define OGL_LOAD_GL_VERSION_4_1 1
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (GLAD_API_PTR *PFNGLSHADERBINARYPROC)(GLsizei count, const GLuint *shaders, GLenum binaryFormat, const void *binary, GLsizei length);
+
+extern PFNGLGETPROGRAMBINARYPROC ogl_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC ogl_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC ogl_glProgramParameteri;
+extern PFNGLSHADERBINARYPROC ogl_glShaderBinary;
+
+#define glGetProgramBinary ogl_glGetProgramBinary
+#define glProgramBinary ogl_glProgramBinary
+#define glProgramParameteri ogl_glProgramParameteri
+#define glShaderBinary ogl_glShaderBinary
+#endif
+
+#ifndef GL_VERSION_4_2
+#define OGL_LOAD_GL_VERSION_4_2 1
+
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_ELEMENT_ARRAY_BARRIER_BIT 0x00000002
+#define GL_UNIFORM_BARRIER_BIT 0x00000004
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_PIXEL_BUFFER_BARRIER_BIT 0x00000080
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#define GL_TRANSFORM_FEEDBACK_BARRIER_BIT 0x00000800
+#define GL_ATOMIC_COUNTER_BARRIER_BIT 0x00001000
+#define GL_ALL_BARRIER_BITS 0xFFFFFFFF
+
+typedef void (GLAD_API_PTR *PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (GLAD_API_PTR *PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (GLAD_API_PTR *PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+
+extern PFNGLMEMORYBARRIERPROC ogl_glMemoryBarrier;
+extern PFNGLBINDIMAGETEXTUREPROC ogl_glBindImageTexture;
+extern PFNGLTEXSTORAGE2DPROC ogl_glTexStorage2D;
+
+#define glMemoryBarrier ogl_glMemoryBarrier
+#define glBindImageTexture ogl_glBindImageTexture
+#define glTexStorage2D ogl_glTexStorage2D
+#endif
+
+#ifndef GL_VERSION_4_3
+#define OGL_LOAD_GL_VERSION_4_3 1
+
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DISPATCH_INDIRECT_BUFFER 0x90EE
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_UNIFORM 0x92E1
+#define GL_UNIFORM_BLOCK 0x92E2
+#define GL_PROGRAM_INPUT 0x92E3
+#define GL_SHADER_STORAGE_BLOCK 0x92E6
+#define GL_ACTIVE_RESOURCES 0x92F5
+#define GL_NAME_LENGTH 0x92F9
+#define GL_TYPE 0x92FA
+#define GL_ARRAY_SIZE 0x92FB
+#define GL_BLOCK_INDEX 0x92FD
+#define GL_BUFFER_BINDING 0x9302
+#define GL_BUFFER_DATA_SIZE 0x9303
+#define GL_LOCATION 0x930E
+
+typedef void (GLAD_API_PTR *PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (GLAD_API_PTR *PFNGLDISPATCHCOMPUTEINDIRECTPROC)(GLintptr indirect);
+typedef void (GLAD_API_PTR *PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMINTERFACEIVPROC)(GLuint program, GLenum programInterface, GLenum pname, GLint *params);
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMRESOURCEIVPROC)(GLuint program, GLenum programInterface, GLuint index, GLsizei propCount, const GLenum *props, GLsizei count, GLsizei *length, GLint *params);
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMRESOURCENAMEPROC)(GLuint program, GLenum programInterface, GLuint index, GLsizei bufSize, GLsizei *length, GLchar *name);
+typedef void (GLAD_API_PTR *PFNGLSHADERSTORAGEBLOCKBINDINGPROC)(GLuint program, GLuint storageBlockIndex, GLuint storageBlockBinding);
+
+extern PFNGLDISPATCHCOMPUTEPROC ogl_glDispatchCompute;
+extern PFNGLDISPATCHCOMPUTEINDIRECTPROC ogl_glDispatchComputeIndirect;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC ogl_glMultiDrawElementsIndirect;
+extern PFNGLGETPROGRAMINTERFACEIVPROC ogl_glGetProgramInterfaceiv;
+extern PFNGLGETPROGRAMRESOURCEIVPROC ogl_glGetProgramResourceiv;
+extern PFNGLGETPROGRAMRESOURCENAMEPROC ogl_glGetProgramResourceName;
+extern PFNGLSHADERSTORAGEBLOCKBINDINGPROC ogl_glShaderStorageBlockBinding;
+
+#define glDispatchCompute ogl_glDispatchCompute
+#define glDispatchComputeIndirect ogl_glDispatchComputeIndirect
+#define glMultiDrawElementsIndirect ogl_glMultiDrawElementsIndirect
+#define glGetProgramInterfaceiv ogl_glGetProgramInterfaceiv
+#define glGetProgramResourceiv ogl_glGetProgramResourceiv
+#define glGetProgramResourceName ogl_glGetProgramResourceName
+#define glShaderStorageBlockBinding ogl_glShaderStorageBlockBinding
+#endif
+
+// Optional; left null when neither OpenGL 4.6 nor ARB_indirect_parameters and ARB_gl_spirv
+// are available. Check for the extension before calling: some platforms resolve any name.
+#ifndef GL_VERSION_4_6
+#define OGL_LOAD_GL_VERSION_4_6 1
+
+#define GL_PARAMETER_BUFFER 0x80EE
+#define GL_SHADER_BINARY_FORMAT_SPIR_V 0x9551
+#define GL_SPIR_V_BINARY 0x9552
+
+typedef void (GLAD_API_PTR *PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)(GLenum mode, GLenum type, const void *indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride);
+typedef void (GLAD_API_PTR *PFNGLSPECIALIZESHADERPROC)(GLuint shader, const GLchar *pEntryPoint, GLuint numSpecializationConstants, const GLuint *pConstantIndex, const GLuint *pConstantValue);
+
+extern PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC ogl_glMultiDrawElementsIndirectCount;
+extern PFNGLSPECIALIZESHADERPROC ogl_glSpecializeShader;
+
+#define glMultiDrawElementsIndirectCount ogl_glMultiDrawElementsIndirectCount
+#define glSpecializeShader ogl_glSpecializeShader
+#endif
+
+// Optional; left null when neither KHR_parallel_shader_compile nor ARB_parallel_shader_compile is available
+#ifndef GL_KHR_parallel_shader_compile
+#define OGL_LOAD_GL_KHR_parallel_shader_compile 1
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ogl_glMaxShaderCompilerThreadsKHR;
+
+#define glMaxShaderCompilerThreadsKHR ogl_glMaxShaderCompilerThreadsKHR
+#endif
+
+// Optional; left null when neither OpenGL 4.3 nor KHR_debug is available
+#ifndef GL_KHR_debug
+#define OGL_LOAD_GL_KHR_debug 1
+
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+
+typedef void (GLAD_API_PTR *PFNGLPUSHDEBUGGROUPPROC)(GLenum source, GLuint id, GLsizei length, const GLchar *message);
+typedef void (GLAD_API_PTR *PFNGLPOPDEBUGGROUPPROC)(void);
+
+extern PFNGLPUSHDEBUGGROUPPROC ogl_glPushDebugGroup;
+extern PFNGLPOPDEBUGGROUPPROC ogl_glPopDebugGroup;
+
+#define glPushDebugGroup ogl_glPushDebugGroup
+#define glPopDebugGroup ogl_glPopDebugGroup
+#endif
+
+namespace render
+{
+
+// Resolve the entry points declared above from the current context; returns false if any are missing
+bool LoadOpenGLFunctions();
+
+} // end namespace render
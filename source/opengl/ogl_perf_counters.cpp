@@ -0,0 +1,130 @@
+#include "ogl_perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace render
+{
+
+#if defined(__linux__)
+// A counter of the calling thread's user space work, on any CPU; the group leader starts
+// disabled and the others follow it
+static int OpenPerfEvent(__u32 type, __u64 config, int groupFd)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = groupFd == -1 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+static __u64 GetCacheMissConfig(__u64 cache)
+{
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+bool OpenGLPerfCounters::Open()
+{
+	if(IsOpen())
+		return true;
+
+#if defined(__linux__)
+	m_GroupFd = OpenPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	if(m_GroupFd == -1)
+	{
+		std::cout << "ERROR::PERF_COUNTERS::OPEN_FAILED " << strerror(errno) << std::endl;
+		return false;
+	}
+	m_Fds[COUNTER_CYCLES] = m_GroupFd;
+	m_ReadOrder[0] = COUNTER_CYCLES;
+	m_OpenCount = 1;
+
+	auto add = [this](Counter counter, __u32 type, __u64 config) {
+		if(m_Fds[counter] == -1)
+			m_Fds[counter] = OpenPerfEvent(type, config, m_GroupFd);
+		if(m_Fds[counter] != -1 && m_ReadOrder[m_OpenCount - 1] != counter)
+			m_ReadOrder[m_OpenCount++] = counter;
+	};
+	add(COUNTER_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	add(COUNTER_L1_DATA_CACHE_MISSES, PERF_TYPE_HW_CACHE, GetCacheMissConfig(PERF_COUNT_HW_CACHE_L1D));
+	add(COUNTER_LAST_LEVEL_CACHE_MISSES, PERF_TYPE_HW_CACHE, GetCacheMissConfig(PERF_COUNT_HW_CACHE_LL));
+	// CPUs without last level cache events mostly still count cache misses, which mean the same
+	add(COUNTER_LAST_LEVEL_CACHE_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	add(COUNTER_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+	ioctl(m_GroupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_GroupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void OpenGLPerfCounters::Close()
+{
+#if defined(__linux__)
+	// members first, the group leader last
+	for(int i = COUNTER_COUNT - 1; i >= 0; i--)
+	{
+		if(m_Fds[i] != -1)
+			close(m_Fds[i]);
+		m_Fds[i] = -1;
+	}
+#endif
+	m_GroupFd = -1;
+	m_OpenCount = 0;
+	m_Depth = 0;
+}
+
+bool OpenGLPerfCounters::Read(unsigned long long values[COUNTER_COUNT]) const
+{
+	memset(values, 0, sizeof(unsigned long long) * COUNTER_COUNT);
+#if defined(__linux__)
+	// the value count, then a value per counter in the order they were opened
+	__u64 group[1 + COUNTER_COUNT];
+	if(read(m_GroupFd, group, sizeof(group)) < static_cast<ssize_t>(sizeof(__u64) * (1 + m_OpenCount)))
+		return false;
+	for(unsigned int i = 0; i < m_OpenCount && i < group[0]; i++)
+		values[m_ReadOrder[i]] = group[1 + i];
+	return true;
+#else
+	return false;
+#endif
+}
+
+void OpenGLPerfCounters::Begin()
+{
+	if(m_Depth++ == 0)
+		Read(m_BeginValues);
+}
+
+void OpenGLPerfCounters::End(FrameCounters &counters)
+{
+	if(m_Depth == 0 || --m_Depth > 0)
+		return;
+
+	unsigned long long values[COUNTER_COUNT];
+	if(!Read(values))
+		return;
+	counters.cpuCycles += values[COUNTER_CYCLES] - m_BeginValues[COUNTER_CYCLES];
+	counters.cpuInstructions += values[COUNTER_INSTRUCTIONS] - m_BeginValues[COUNTER_INSTRUCTIONS];
+	counters.l1DataCacheMisses += values[COUNTER_L1_DATA_CACHE_MISSES] - m_BeginValues[COUNTER_L1_DATA_CACHE_MISSES];
+	counters.lastLevelCacheMisses += values[COUNTER_LAST_LEVEL_CACHE_MISSES] - m_BeginValues[COUNTER_LAST_LEVEL_CACHE_MISSES];
+	counters.branchMisses += values[COUNTER_BRANCH_MISSES] - m_BeginValues[COUNTER_BRANCH_MISSES];
+}
+
+} // end namespace render
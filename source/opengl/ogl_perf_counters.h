@@ -0,0 +1,79 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+namespace render
+{
+
+// The CPU's hardware counters of one thread, opened as a perf_event group so they are read
+// together with one system call. Samples nest: only the outermost Begin and End read the
+// counters, so an upload made while encoding is not counted twice. Counters the CPU or the
+// kernel lacks read as 0. Linux only; elsewhere Open fails.
+class OpenGLPerfCounters
+{
+public:
+
+	~OpenGLPerfCounters() { Close(); }
+
+	// Open the counters of the calling thread; false if the kernel refuses the cycle counter
+	bool Open();
+
+	void Close();
+
+	bool IsOpen() const { return m_GroupFd != -1; }
+
+	void Begin();
+
+	// Add what the counters counted since the outermost Begin to counters
+	void End(FrameCounters &counters);
+
+private:
+
+	enum Counter
+	{
+		COUNTER_CYCLES,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_L1_DATA_CACHE_MISSES,
+		COUNTER_LAST_LEVEL_CACHE_MISSES,
+		COUNTER_BRANCH_MISSES,
+		COUNTER_COUNT
+	};
+
+	// The group's values, by Counter
+	bool Read(unsigned long long values[COUNTER_COUNT]) const;
+
+	int m_GroupFd = -1;
+	int m_Fds[COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+
+	// the Counter of each value a group read returns, in the order they were opened
+	Counter m_ReadOrder[COUNTER_COUNT];
+	unsigned int m_OpenCount = 0;
+
+	unsigned int m_Depth = 0;
+	unsigned long long m_BeginValues[COUNTER_COUNT];
+};
+
+// Samples the counters over its scope when they are open
+class OpenGLPerfScope
+{
+public:
+
+	OpenGLPerfScope(OpenGLPerfCounters &perfCounters, FrameCounters &counters) : m_PerfCounters(perfCounters), m_Counters(counters)
+	{
+		if(m_PerfCounters.IsOpen())
+			m_PerfCounters.Begin();
+	}
+
+	~OpenGLPerfScope()
+	{
+		if(m_PerfCounters.IsOpen())
+			m_PerfCounters.End(m_Counters);
+	}
+
+private:
+
+	OpenGLPerfCounters &m_PerfCounters;
+	FrameCounters &m_Counters;
+};
+
+} // end namespace render
@@ -0,0 +1,227 @@
+#include "ogl_pipeline_manifest.h"
+
+#include "ogl_program_cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace render
+{
+
+static const char *kManifestHeader = "# RenderDevice pipeline manifest 1\n";
+
+// Indexed by FunctionType
+static const char *function_type_names[] = { "vertex", "fragment", "compute" };
+
+// Vertex attributes a pipeline may have, and the locations they may bind to; the least every
+// OpenGL implementation supports
+static const unsigned int kMaxManifestAttributes = 16;
+
+uint64_t OpenGLPipelineManifest::AddStage(FunctionType functionType, const std::string &source)
+{
+	uint64_t hash = HashBytes(kHashSeed, &functionType, sizeof(functionType));
+	hash = HashBytes(hash, source.data(), source.size());
+
+	Stage &stage = m_Stages[hash];
+	stage.functionType = functionType;
+	stage.source = source;
+	return hash;
+}
+
+std::string OpenGLPipelineManifest::FormatPipeline(const Pipeline &pipeline)
+{
+	char line[256];
+	if(pipeline.stageCount == 1)
+	{
+		snprintf(line, sizeof(line), "compute %016" PRIx64, pipeline.stageHashes[0]);
+		return line;
+	}
+
+	snprintf(line, sizeof(line), "render %016" PRIx64 " %016" PRIx64 " %d %d %d %d %u %u", pipeline.stageHashes[0], pipeline.stageHashes[1],
+		pipeline.cullEnabled ? 1 : 0, pipeline.frontFace, pipeline.cullFace, pipeline.rasterMode, pipeline.arrayStride,
+		static_cast<unsigned int>(pipeline.attributes.size()));
+	std::string text = line;
+	for(const VertexAttribute &attribute : pipeline.attributes)
+	{
+		snprintf(line, sizeof(line), " %d %lld %u", attribute.format, attribute.offset, attribute.shaderLocation);
+		text += line;
+	}
+	return text;
+}
+
+void OpenGLPipelineManifest::AddPipeline(const Pipeline &pipeline)
+{
+	if(m_PipelineLines.insert(FormatPipeline(pipeline)).second)
+		m_Pipelines.push_back(pipeline);
+}
+
+void OpenGLPipelineManifest::AddRenderPipeline(const std::string &vertexSource, const std::string &fragmentSource, unsigned int arrayStride,
+	const std::vector<VertexAttribute> &attributes, bool cullEnabled, Winding frontFace, Face cullFace, RasterMode rasterMode)
+{
+	Pipeline pipeline;
+	pipeline.stageHashes[0] = AddStage(FUNCTIONTYPE_VERTEX, vertexSource);
+	pipeline.stageHashes[1] = AddStage(FUNCTIONTYPE_FRAGMENT, fragmentSource);
+	pipeline.stageCount = 2;
+	pipeline.arrayStride = arrayStride;
+	pipeline.attributes = attributes;
+	pipeline.cullEnabled = cullEnabled;
+	pipeline.frontFace = frontFace;
+	pipeline.cullFace = cullFace;
+	pipeline.rasterMode = rasterMode;
+	AddPipeline(pipeline);
+}
+
+void OpenGLPipelineManifest::AddComputePipeline(const std::string &computeSource)
+{
+	Pipeline pipeline;
+	pipeline.stageHashes[0] = AddStage(FUNCTIONTYPE_COMPUTE, computeSource);
+	pipeline.stageCount = 1;
+	AddPipeline(pipeline);
+}
+
+bool OpenGLPipelineManifest::Save(const char *path) const
+{
+	FILE *file = fopen(path, "wb");
+	if(!file)
+	{
+		std::cout << "ERROR::PIPELINE_MANIFEST::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	bool success = fputs(kManifestHeader, file) >= 0;
+	for(const auto &stage : m_Stages)
+	{
+		success &= fprintf(file, "source %016" PRIx64 " %s %u\n", stage.first, function_type_names[stage.second.functionType],
+			static_cast<unsigned int>(stage.second.source.size())) > 0;
+		success &= fwrite(stage.second.source.data(), 1, stage.second.source.size(), file) == stage.second.source.size();
+		success &= fputc('\n', file) != EOF;
+	}
+	for(const Pipeline &pipeline : m_Pipelines)
+		success &= fprintf(file, "%s\n", FormatPipeline(pipeline).c_str()) > 0;
+
+	success &= fclose(file) == 0;
+	return success;
+}
+
+bool OpenGLPipelineManifest::Load(const char *path)
+{
+	m_Stages.clear();
+	m_Pipelines.clear();
+	m_PipelineLines.clear();
+
+	FILE *file = fopen(path, "rb");
+	if(!file)
+		return false;
+
+	bool success = true;
+	char header[64] = {};
+	if(!fgets(header, sizeof(header), file) || strcmp(header, kManifestHeader) != 0)
+		success = false;
+
+	char kind[16];
+	while(success && fscanf(file, "%15s", kind) == 1)
+	{
+		if(strcmp(kind, "source") == 0)
+		{
+			uint64_t hash;
+			char typeName[16];
+			unsigned int size;
+			if(fscanf(file, "%" SCNx64 " %15s %u", &hash, typeName, &size) != 3 || fgetc(file) != '\n')
+			{
+				success = false;
+				break;
+			}
+
+			Stage stage;
+			int functionType = -1;
+			for(int i = 0; i < 3; i++)
+			{
+				if(strcmp(typeName, function_type_names[i]) == 0)
+					functionType = i;
+			}
+			if(functionType < 0)
+			{
+				success = false;
+				break;
+			}
+			stage.functionType = static_cast<FunctionType>(functionType);
+			stage.source.resize(size);
+			success = fread(&stage.source[0], 1, size, file) == size;
+			m_Stages[hash] = stage;
+		}
+		else if(strcmp(kind, "render") == 0)
+		{
+			Pipeline pipeline;
+			int cullEnabled, frontFace, cullFace, rasterMode;
+			unsigned int attributeCount;
+			if(fscanf(file, "%" SCNx64 " %" SCNx64 " %d %d %d %d %u %u", &pipeline.stageHashes[0], &pipeline.stageHashes[1],
+				&cullEnabled, &frontFace, &cullFace, &rasterMode, &pipeline.arrayStride, &attributeCount) != 8)
+			{
+				success = false;
+				break;
+			}
+			// the raster state indexes tables of OpenGL enums when the pipeline is built
+			if(frontFace < 0 || frontFace >= WINDING_MAX || cullFace < 0 || cullFace >= FACE_MAX || rasterMode < 0 || rasterMode >= RASTERMODE_MAX ||
+				attributeCount > kMaxManifestAttributes)
+			{
+				success = false;
+				break;
+			}
+			pipeline.stageCount = 2;
+			pipeline.cullEnabled = cullEnabled != 0;
+			pipeline.frontFace = static_cast<Winding>(frontFace);
+			pipeline.cullFace = static_cast<Face>(cullFace);
+			pipeline.rasterMode = static_cast<RasterMode>(rasterMode);
+
+			for(unsigned int i = 0; i < attributeCount && success; i++)
+			{
+				int format;
+				VertexAttribute attribute;
+				success = fscanf(file, "%d %lld %u", &format, &attribute.offset, &attribute.shaderLocation) == 3 &&
+					format >= VERTEXATTRIBUTEFORMAT_UINT8X2 && format <= VERTEXATTRIBUTEFORMAT_SINT32X4 && attribute.offset >= 0 &&
+					attribute.shaderLocation < kMaxManifestAttributes;
+				attribute.format = static_cast<VertexAttributeFormat>(format);
+				pipeline.attributes.push_back(attribute);
+			}
+			if(success)
+				AddPipeline(pipeline);
+		}
+		else if(strcmp(kind, "compute") == 0)
+		{
+			Pipeline pipeline;
+			pipeline.stageCount = 1;
+			success = fscanf(file, "%" SCNx64, &pipeline.stageHashes[0]) == 1;
+			if(success)
+				AddPipeline(pipeline);
+		}
+		else
+		{
+			success = false;
+		}
+	}
+	fclose(file);
+
+	// every stage a pipeline names must be present, and of the kind its place in the pipeline calls for
+	for(const Pipeline &pipeline : m_Pipelines)
+	{
+		for(int i = 0; i < pipeline.stageCount; i++)
+		{
+			auto stage = m_Stages.find(pipeline.stageHashes[i]);
+			FunctionType functionType = pipeline.stageCount == 1 ? FUNCTIONTYPE_COMPUTE : static_cast<FunctionType>(i);
+			success &= stage != m_Stages.end() && stage->second.functionType == functionType;
+		}
+	}
+
+	if(!success)
+	{
+		std::cout << "ERROR::PIPELINE_MANIFEST::MALFORMED " << path << std::endl;
+		m_Stages.clear();
+		m_Pipelines.clear();
+		m_PipelineLines.clear();
+	}
+	return success;
+}
+
+} // end namespace render
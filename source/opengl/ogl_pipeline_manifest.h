@@ -0,0 +1,78 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+// The pipelines created during a session, saved so a later run can build them all before
+// they are needed.
+//
+// Each distinct shader source is kept once under its hash; a pipeline lists the hashes of
+// its stages along with its vertex layout and raster state. The file is text, a line per
+// pipeline and a header line before each source:
+//
+//   source <hash> <vertex | fragment | compute> <byte count>
+//   <source bytes>
+//   render <vertex hash> <fragment hash> <cull> <front face> <cull face> <raster mode> <stride> <attribute count> [<format> <offset> <location>]...
+//   compute <compute hash>
+class OpenGLPipelineManifest
+{
+public:
+
+	struct Stage
+	{
+		FunctionType functionType;
+		std::string source;
+	};
+
+	struct Pipeline
+	{
+		uint64_t stageHashes[2] = {};
+		int stageCount = 0; // 2 for a render pipeline, 1 for compute
+
+		// render pipelines only
+		unsigned int arrayStride = 0;
+		std::vector<VertexAttribute> attributes;
+		bool cullEnabled = true;
+		Winding frontFace = WINDING_CCW;
+		Face cullFace = FACE_BACK;
+		RasterMode rasterMode = RASTERMODE_FILL;
+	};
+
+	// Add a pipeline unless an identical one is already listed
+	void AddRenderPipeline(const std::string &vertexSource, const std::string &fragmentSource, unsigned int arrayStride,
+		const std::vector<VertexAttribute> &attributes, bool cullEnabled, Winding frontFace, Face cullFace, RasterMode rasterMode);
+
+	void AddComputePipeline(const std::string &computeSource);
+
+	bool Save(const char *path) const;
+
+	// Replace the contents with a saved manifest; false, leaving it empty, if it cannot be read
+	// or any entry is malformed or out of range
+	bool Load(const char *path);
+
+	const std::vector<Pipeline> &GetPipelines() const { return m_Pipelines; }
+
+	const Stage &GetStage(uint64_t hash) const { return m_Stages.at(hash); }
+
+private:
+
+	uint64_t AddStage(FunctionType functionType, const std::string &source);
+
+	void AddPipeline(const Pipeline &pipeline);
+
+	static std::string FormatPipeline(const Pipeline &pipeline);
+
+	std::map<uint64_t, Stage> m_Stages;
+	std::vector<Pipeline> m_Pipelines;
+	std::set<std::string> m_PipelineLines; // each pipeline's line, to leave out duplicates
+};
+
+} // end namespace render
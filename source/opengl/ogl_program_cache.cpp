@@ -0,0 +1,171 @@
+#include "ogl_program_cache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace render
+{
+
+// Leads every cache file; a binary is only handed to the driver when all of it matches
+struct ProgramBinaryHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t length;
+};
+
+static const char kProgramBinaryMagic[4] = { 'R', 'D', 'P', 'B' };
+static const uint32_t kProgramBinaryVersion = 1;
+
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for(size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Hashes the string and its terminator, so consecutive strings cannot run together
+static uint64_t HashString(uint64_t hash, const char *string)
+{
+	if(!string)
+		string = "";
+	return HashBytes(hash, string, strlen(string) + 1);
+}
+
+void OpenGLProgramCache::SetDirectory(const char *directory)
+{
+	m_Directory.clear();
+	if(!directory || !directory[0])
+		return;
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if(formatCount <= 0)
+		return;
+
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+
+	m_Directory = directory;
+	if(m_Directory.back() != '/' && m_Directory.back() != '\\')
+		m_Directory += '/';
+
+	m_DriverHash = kHashSeed;
+	m_DriverHash = HashString(m_DriverHash, reinterpret_cast<const char *>(glGetString(GL_VENDOR)));
+	m_DriverHash = HashString(m_DriverHash, reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+	m_DriverHash = HashString(m_DriverHash, reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+	m_DriverHash = HashString(m_DriverHash, reinterpret_cast<const char *>(glGetString(GL_SHADING_LANGUAGE_VERSION)));
+}
+
+uint64_t OpenGLProgramCache::GetKey(const uint64_t *stageKeys, int stageCount) const
+{
+	return HashBytes(m_DriverHash, stageKeys, sizeof(stageKeys[0]) * stageCount);
+}
+
+std::string OpenGLProgramCache::GetPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return m_Directory + name;
+}
+
+bool OpenGLProgramCache::Load(uint64_t key, GLuint program)
+{
+	bool loaded = false;
+
+	FILE *file = fopen(GetPath(key).c_str(), "rb");
+	if(file)
+	{
+		ProgramBinaryHeader header;
+		if(fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, kProgramBinaryMagic, sizeof(header.magic)) == 0 &&
+			header.version == kProgramBinaryVersion && header.key == key && header.length > 0)
+		{
+			std::vector<unsigned char> binary(header.length);
+			if(fread(binary.data(), 1, binary.size(), file) == binary.size())
+			{
+				glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+				// a driver may refuse its own binaries after an update that kept its version strings
+				GLint success = GL_FALSE;
+				glGetProgramiv(program, GL_LINK_STATUS, &success);
+				loaded = success == GL_TRUE;
+			}
+		}
+		fclose(file);
+	}
+
+	if(loaded)
+		m_HitCount++;
+	else
+		m_MissCount++;
+	return loaded;
+}
+
+void OpenGLProgramCache::Store(uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+
+	ProgramBinaryHeader header;
+	memcpy(header.magic, kProgramBinaryMagic, sizeof(header.magic));
+	header.version = kProgramBinaryVersion;
+	header.key = key;
+
+	std::vector<unsigned char> binary(length);
+	GLsizei written = 0;
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+	if(written <= 0)
+		return;
+	header.binaryFormat = binaryFormat;
+	header.length = static_cast<uint32_t>(written);
+
+	// unique per process and store, so concurrent writers never share a temporary file
+	static std::atomic<unsigned int> storeCount(0);
+#ifdef _WIN32
+	int processId = _getpid();
+#else
+	int processId = static_cast<int>(getpid());
+#endif
+	std::string path = GetPath(key);
+	char suffix[48];
+	snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", processId, storeCount++);
+	std::string temporaryPath = path + suffix;
+
+	FILE *file = fopen(temporaryPath.c_str(), "wb");
+	if(!file)
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << temporaryPath << std::endl;
+		return;
+	}
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, header.length, file) == header.length;
+	success &= fclose(file) == 0;
+
+	// rename replaces the file whole; a reader sees the old binary, the new one or none
+	if(!success || rename(temporaryPath.c_str(), path.c_str()) != 0)
+		remove(temporaryPath.c_str());
+}
+
+} // end namespace render
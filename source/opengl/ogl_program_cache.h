@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ogl_loader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace render
+{
+
+// FNV-1a, 64 bit; hash several pieces by passing each call the hash of the ones before,
+// starting from kHashSeed
+static const uint64_t kHashSeed = 14695981039346656037ull;
+
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size);
+
+// Linked program binaries kept on disk across runs, one file per program, so a program
+// built once is loaded with glProgramBinary instead of compiled and linked again.
+//
+// A program's key hashes the driver's vendor, renderer and version strings with the
+// content of every stage, so a driver update or an edited shader misses and the program
+// is rebuilt and stored afresh. Files are written to a temporary name and renamed into
+// place, so processes sharing a directory never see a partly written binary.
+class OpenGLProgramCache
+{
+public:
+
+	// Keep binaries under directory, created if it is missing; null or empty turns the cache
+	// off. Needs the device's context current, and no pipeline being built asynchronously.
+	void SetDirectory(const char *directory);
+
+	// False when off or when the driver offers no binary formats
+	bool IsEnabled() const { return !m_Directory.empty(); }
+
+	// stageKeys hash each stage's type and everything it is compiled from
+	uint64_t GetKey(const uint64_t *stageKeys, int stageCount) const;
+
+	// Load the binary stored under key into program; false if there is none or the driver
+	// rejected it, leaving program to be built from source
+	bool Load(uint64_t key, GLuint program);
+
+	// Store a linked program, which was given GL_PROGRAM_BINARY_RETRIEVABLE_HINT before linking
+	void Store(uint64_t key, GLuint program);
+
+	unsigned int GetHitCount() const { return m_HitCount; }
+
+	unsigned int GetMissCount() const { return m_MissCount; }
+
+private:
+
+	std::string GetPath(uint64_t key) const;
+
+	std::string m_Directory;
+	uint64_t m_DriverHash = 0;
+
+	// counted from the device's thread and its pipeline compiler's
+	std::atomic<unsigned int> m_HitCount{0};
+	std::atomic<unsigned int> m_MissCount{0};
+};
+
+} // end namespace render
@@ -0,0 +1,271 @@
+#include "ogl_program_reflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <set>
+
+namespace render
+{
+
+static bool IsSamplerType(GLenum type)
+{
+	return (type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW) ||
+		(type >= GL_SAMPLER_1D_ARRAY && type <= GL_SAMPLER_CUBE_SHADOW) ||
+		(type >= GL_INT_SAMPLER_1D && type <= GL_UNSIGNED_INT_SAMPLER_BUFFER) ||
+		(type >= GL_SAMPLER_CUBE_MAP_ARRAY && type <= GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY) ||
+		(type >= GL_SAMPLER_2D_MULTISAMPLE && type <= GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY);
+}
+
+// The components per location, locations taken and whether the components are integers of
+// a vertex input's type
+static void GetInputShape(GLenum type, unsigned int &componentCount, unsigned int &locationCount, bool &integer)
+{
+	componentCount = 1;
+	locationCount = 1;
+	integer = false;
+	switch(type)
+	{
+		case GL_FLOAT_VEC2: componentCount = 2; break;
+		case GL_FLOAT_VEC3: componentCount = 3; break;
+		case GL_FLOAT_VEC4: componentCount = 4; break;
+		case GL_INT: case GL_UNSIGNED_INT: integer = true; break;
+		case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: componentCount = 2; integer = true; break;
+		case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: componentCount = 3; integer = true; break;
+		case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: componentCount = 4; integer = true; break;
+		case GL_FLOAT_MAT2: componentCount = 2; locationCount = 2; break;
+		case GL_FLOAT_MAT3: componentCount = 3; locationCount = 3; break;
+		case GL_FLOAT_MAT4: componentCount = 4; locationCount = 4; break;
+		case GL_FLOAT_MAT2x3: componentCount = 3; locationCount = 2; break;
+		case GL_FLOAT_MAT2x4: componentCount = 4; locationCount = 2; break;
+		case GL_FLOAT_MAT3x2: componentCount = 2; locationCount = 3; break;
+		case GL_FLOAT_MAT3x4: componentCount = 4; locationCount = 3; break;
+		case GL_FLOAT_MAT4x2: componentCount = 2; locationCount = 4; break;
+		case GL_FLOAT_MAT4x3: componentCount = 3; locationCount = 4; break;
+		default: break;
+	}
+}
+
+static std::string GetResourceName(GLuint program, GLenum programInterface, GLuint index, GLint nameLength)
+{
+	std::string name(std::max(nameLength, 1), '\0');
+	GLsizei length = 0;
+	glGetProgramResourceName(program, programInterface, index, static_cast<GLsizei>(name.size()), &length, &name[0]);
+	name.resize(length);
+
+	// arrays are named by their first element
+	if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		name.resize(name.size() - 3);
+	return name;
+}
+
+void OpenGLProgramReflection::AddBinding(const Resource &resource, BindingType bindingType, unsigned int index, unsigned int size)
+{
+	ShaderBinding binding;
+	binding.name = nullptr;
+	binding.bindingType = bindingType;
+	binding.index = index;
+	binding.size = size;
+	m_Bindings.push_back(binding);
+	m_Resources.push_back(resource);
+}
+
+void OpenGLProgramReflection::Reflect(GLuint program)
+{
+	m_Bindings.clear();
+	m_Resources.clear();
+	m_Reflected = true;
+
+	// without OpenGL 4.3 the table stays empty
+	if(!program || !glGetProgramInterfaceiv)
+		return;
+
+	static const GLenum blockInterfaces[] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+	static const BindingType blockBindingTypes[] = { BINDINGTYPE_UNIFORM_BLOCK, BINDINGTYPE_STORAGE_BUFFER };
+	for(int i = 0; i < 2; i++)
+	{
+		GLint blockCount = 0;
+		glGetProgramInterfaceiv(program, blockInterfaces[i], GL_ACTIVE_RESOURCES, &blockCount);
+		for(GLint j = 0; j < blockCount; j++)
+		{
+			static const GLenum properties[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+			GLint values[3] = {};
+			glGetProgramResourceiv(program, blockInterfaces[i], j, 3, properties, 3, nullptr, values);
+
+			Resource resource = { GetResourceName(program, blockInterfaces[i], j, values[0]), GL_NONE, static_cast<GLuint>(j), -1, false };
+			AddBinding(resource, blockBindingTypes[i], values[1], values[2]);
+		}
+	}
+
+	GLint uniformCount = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+	for(GLint i = 0; i < uniformCount; i++)
+	{
+		static const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_LOCATION };
+		GLint values[5] = {};
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 5, properties, 5, nullptr, values);
+		if(values[3] != -1 || !IsSamplerType(values[1]))
+			continue;
+
+		GLint unit = 0;
+		glGetUniformiv(program, values[4], &unit);
+		Resource resource = { GetResourceName(program, GL_UNIFORM, i, values[0]), static_cast<GLenum>(values[1]), static_cast<GLuint>(i), values[4], false };
+		for(GLint j = 1; j < values[2] && !resource.rebind; j++)
+		{
+			GLint elementUnit = 0;
+			glGetUniformiv(program, glGetUniformLocation(program, (resource.name + "[" + std::to_string(j) + "]").c_str()), &elementUnit);
+			resource.rebind = elementUnit != unit + j;
+		}
+		AddBinding(resource, BINDINGTYPE_SAMPLER, unit, values[2]);
+	}
+
+	// built-in inputs such as gl_VertexID have no location
+	GLint inputCount = 0;
+	glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputCount);
+	for(GLint i = 0; i < inputCount; i++)
+	{
+		static const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION };
+		GLint values[3] = {};
+		glGetProgramResourceiv(program, GL_PROGRAM_INPUT, i, 3, properties, 3, nullptr, values);
+		if(values[2] < 0)
+			continue;
+
+		unsigned int componentCount, locationCount;
+		bool integer;
+		GetInputShape(values[1], componentCount, locationCount, integer);
+		Resource resource = { GetResourceName(program, GL_PROGRAM_INPUT, i, values[0]), static_cast<GLenum>(values[1]), static_cast<GLuint>(i), -1, false };
+		AddBinding(resource, BINDINGTYPE_VERTEX_INPUT, values[2], componentCount);
+	}
+
+	AssignSlots(program, BINDINGTYPE_UNIFORM_BLOCK);
+	AssignSlots(program, BINDINGTYPE_STORAGE_BUFFER);
+	AssignSlots(program, BINDINGTYPE_SAMPLER);
+
+	for(size_t i = 0; i < m_Bindings.size(); i++)
+		m_Bindings[i].name = m_Resources[i].name.c_str();
+}
+
+void OpenGLProgramReflection::AssignSlots(GLuint program, BindingType bindingType)
+{
+	// slots the shaders chose stay theirs; only a slot taken twice is reassigned
+	std::set<unsigned int> chosenSlots, takenSlots;
+	for(const ShaderBinding &binding : m_Bindings)
+	{
+		if(binding.bindingType == bindingType)
+			chosenSlots.insert(binding.index);
+	}
+
+	GLint currentProgram = 0;
+	bool programSwitched = false;
+	for(size_t i = 0; i < m_Bindings.size(); i++)
+	{
+		ShaderBinding &binding = m_Bindings[i];
+		if(binding.bindingType != bindingType)
+			continue;
+
+		// a sampler array takes a unit per element
+		unsigned int slotCount = bindingType == BINDINGTYPE_SAMPLER ? std::max(binding.size, 1u) : 1;
+		auto isFree = [&](unsigned int first, bool includeChosen) {
+			for(unsigned int slot = first; slot < first + slotCount; slot++)
+			{
+				if(takenSlots.count(slot) || (includeChosen && chosenSlots.count(slot)))
+					return false;
+			}
+			return true;
+		};
+
+		bool moved = !isFree(binding.index, false);
+		if(moved)
+		{
+			unsigned int slot = 0;
+			while(!isFree(slot, true))
+				slot++;
+			binding.index = slot;
+		}
+
+		if(moved || m_Resources[i].rebind)
+		{
+			unsigned int slot = binding.index;
+			const Resource &resource = m_Resources[i];
+			if(bindingType == BINDINGTYPE_UNIFORM_BLOCK)
+			{
+				glUniformBlockBinding(program, resource.resourceIndex, slot);
+			}
+			else if(bindingType == BINDINGTYPE_STORAGE_BUFFER)
+			{
+				glShaderStorageBlockBinding(program, resource.resourceIndex, slot);
+			}
+			else
+			{
+				// sampler units are uniform values, set on the current program
+				if(!programSwitched)
+				{
+					glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+					glUseProgram(program);
+					programSwitched = true;
+				}
+				std::vector<GLint> units(slotCount);
+				for(unsigned int j = 0; j < slotCount; j++)
+					units[j] = slot + j;
+				glUniform1iv(resource.location, slotCount, units.data());
+			}
+		}
+
+		for(unsigned int slot = binding.index; slot < binding.index + slotCount; slot++)
+			takenSlots.insert(slot);
+	}
+
+	if(programSwitched)
+		glUseProgram(currentProgram);
+}
+
+bool OpenGLProgramReflection::ValidateVertexInputs(const std::vector<VertexAttribute> &attributes) const
+{
+	bool valid = true;
+	for(size_t i = 0; i < m_Bindings.size(); i++)
+	{
+		const ShaderBinding &binding = m_Bindings[i];
+		if(binding.bindingType != BINDINGTYPE_VERTEX_INPUT)
+			continue;
+
+		unsigned int componentCount, locationCount;
+		bool integer;
+		GetInputShape(m_Resources[i].type, componentCount, locationCount, integer);
+		if(integer)
+		{
+			std::cout << "ERROR::PIPELINE::INTEGER_VERTEX_INPUT " << binding.name << std::endl;
+			valid = false;
+		}
+
+		for(unsigned int location = binding.index; location < binding.index + locationCount; location++)
+		{
+			bool fed = std::any_of(attributes.begin(), attributes.end(), [location](const VertexAttribute &attribute) {
+				return attribute.shaderLocation == location;
+			});
+			if(!fed)
+			{
+				std::cout << "ERROR::PIPELINE::VERTEX_INPUT_NOT_IN_LAYOUT " << binding.name << " location " << location << std::endl;
+				valid = false;
+			}
+		}
+	}
+	return valid;
+}
+
+const ShaderBinding *OpenGLProgramReflection::GetBindings(unsigned int &bindingCount) const
+{
+	bindingCount = static_cast<unsigned int>(m_Bindings.size());
+	return m_Bindings.empty() ? nullptr : m_Bindings.data();
+}
+
+int OpenGLProgramReflection::GetBindingIndex(BindingType bindingType, const char *name) const
+{
+	for(const ShaderBinding &binding : m_Bindings)
+	{
+		if(binding.bindingType == bindingType && strcmp(binding.name, name) == 0)
+			return static_cast<int>(binding.index);
+	}
+	return -1;
+}
+
+} // end namespace render
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "render_device/render_device.h"
+
+#include "ogl_loader.h"
+
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+// The uniform blocks, samplers, storage blocks and vertex inputs of a linked program, read
+// with program interface queries once so draws bind by slot without looking names up
+class OpenGLProgramReflection
+{
+public:
+
+	// Read the program's resources, giving each block or sampler that shares its slot with an
+	// earlier one of its kind the lowest free slot
+	void Reflect(GLuint program);
+
+	// Whether every vertex input of the program is fed by an attribute of the layout, printing
+	// each that is not; attributes are read as floats, so integer inputs cannot be fed
+	bool ValidateVertexInputs(const std::vector<VertexAttribute> &attributes) const;
+
+	const ShaderBinding *GetBindings(unsigned int &bindingCount) const;
+
+	int GetBindingIndex(BindingType bindingType, const char *name) const;
+
+	bool IsReflected() const { return m_Reflected; }
+
+private:
+
+	// What a binding is in the program, by the binding's position
+	struct Resource
+	{
+		std::string name;
+		GLenum type; // of a sampler or vertex input
+		GLuint resourceIndex;
+		GLint location; // of a sampler
+		bool rebind; // set for a sampler array whose elements are not on consecutive units
+	};
+
+	void AddBinding(const Resource &resource, BindingType bindingType, unsigned int index, unsigned int size);
+
+	// Move each resource of a kind sharing its slot with an earlier one to a free slot
+	void AssignSlots(GLuint program, BindingType bindingType);
+
+	std::vector<ShaderBinding> m_Bindings;
+	std::vector<Resource> m_Resources;
+
+	bool m_Reflected = false;
+};
+
+} // end namespace render
@@ -1,49 +1,448 @@
 #include "ogl_render_device.h"
+#include "ogl_program_reflection.h"
+
+#include "render_device/frame_trace.h"
+#include "render_device/platform.h"
 
 #include <glad/gl.h>
-#include <GLFW/glfw3.h>
 
+#include <cstdlib>
 #include <cstring>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include <map>
 
 #include <iostream>
 
 #include <cassert>
+#include <algorithm>
 
 namespace render
 {
 
+// Whether the context lists the extension
+static bool HasExtension(const char *name)
+{
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for(GLint i = 0; i < extensionCount; i++)
+	{
+		if(strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+			return true;
+	}
+	return false;
+}
+
 class OpenGLFunction : public Function
 {
 public:
 
-	OpenGLFunction(const FunctionType& functionType, const char *code)
-	: Function(functionType, code)
+	// With a shader cache the shader is shared with other functions of the same content;
+	// without one it is the function's own
+	OpenGLFunction(const FunctionType& functionType, const char *code, OpenGLShaderCache *shaderCache = nullptr)
+	: Function(functionType, code), functionType(functionType), source(code), shaderCache(shaderCache)
+	{
+	}
+
+	// A SPIR-V entry point, specialized with the constants
+	OpenGLFunction(const FunctionType& functionType, const std::string &binary, const std::string &entryPoint, const FunctionConstant *constants, unsigned int constantCount, OpenGLShaderCache *shaderCache = nullptr)
+	: Function(functionType, nullptr), functionType(functionType), binary(binary), entryPoint(entryPoint), constants(constants, constants + constantCount), shaderCache(shaderCache)
+	{
+	}
+
+	~OpenGLFunction() override
+	{
+		if(shader && shaderCache)
+			shaderCache->Release(GetContentKey());
+		else if(shader)
+			glDeleteShader(shader);
+	}
+
+	// The same function, compiling a shader of its own
+	OpenGLFunction *CloneUncached() const
+	{
+		if(binary.empty())
+			return new OpenGLFunction(functionType, source.c_str());
+		return new OpenGLFunction(functionType, binary, entryPoint, constants.data(), static_cast<unsigned int>(constants.size()));
+	}
+
+	GLenum GetShaderType() const
+	{
+		static const GLenum shader_type_map[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER };
+		return shader_type_map[functionType];
+	}
+
+	// Hashes the stage and everything the shader is compiled from
+	uint64_t GetContentKey() const
+	{
+		uint64_t key = HashBytes(kHashSeed, &functionType, sizeof(functionType));
+		key = HashBytes(key, source.c_str(), source.size() + 1);
+		key = HashBytes(key, binary.data(), binary.size());
+		key = HashBytes(key, entryPoint.c_str(), entryPoint.size() + 1);
+		for(const FunctionConstant &constant : constants)
+			key = HashBytes(key, &constant, sizeof(constant));
+		return key;
+	}
+
+	// Compiled on first use, so pipelines loaded from the program cache never compile. Errors
+	// are reported when a program using the shader fails to link, so compiling need not wait
+	// for a driver compiling in parallel.
+	GLuint GetShader()
+	{
+		if(shader)
+			return shader;
+
+		if(shaderCache)
+		{
+			shader = shaderCache->Find(GetContentKey());
+			if(shader)
+				return shader;
+		}
+
+		RENDER_TRACE_ZONE("Compile Shader");
+		shader = glCreateShader(GetShaderType());
+		if(binary.empty())
+		{
+			const char *code = source.c_str();
+			glShaderSource(shader, 1, &code, NULL);
+			glCompileShader(shader);
+		}
+		else
+		{
+			std::vector<GLuint> constantIds, constantValues;
+			for(const FunctionConstant &constant : constants)
+			{
+				constantIds.push_back(constant.constantId);
+				constantValues.push_back(constant.value);
+			}
+			glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, binary.data(), static_cast<GLsizei>(binary.size()));
+			glSpecializeShader(shader, entryPoint.c_str(), static_cast<GLuint>(constants.size()), constantIds.data(), constantValues.data());
+		}
+
+		if(shaderCache)
+			shaderCache->Add(GetContentKey(), shader);
+		return shader;
+	}
+
+	FunctionType functionType;
+	std::string source; // GLSL, empty for SPIR-V
+
+	// SPIR-V module, with the entry point and specialization constants
+	std::string binary;
+	std::string entryPoint;
+	std::vector<FunctionConstant> constants;
+
+	GLuint shader = 0;
+	OpenGLShaderCache *shaderCache;
+};
+
+// A program being built, whose link may still be running on the driver's compiler threads
+struct OpenGLProgramLink
+{
+	GLuint program = 0;
+	GLuint shaders[2] = {};
+	int shaderCount = 0;
+	uint64_t cacheKey = 0;
+	bool cached = false; // loaded from the program cache, nothing left to link
+};
+
+// Start building a program from the functions: loaded from the program cache when it holds
+// one, else compiled and linked, which returns at once when the driver compiles in parallel
+static void BeginProgram(OpenGLProgramCache *programCache, OpenGLFunction *const *functions, int functionCount, OpenGLProgramLink &link)
+{
+	link.program = glCreateProgram();
+
+	if(programCache && programCache->IsEnabled())
+	{
+		uint64_t stageKeys[2];
+		for(int i = 0; i < functionCount; i++)
+			stageKeys[i] = functions[i]->GetContentKey();
+		link.cacheKey = programCache->GetKey(stageKeys, functionCount);
+		if(programCache->Load(link.cacheKey, link.program))
+		{
+			link.cached = true;
+			return;
+		}
+
+		// a rejected binary may have left the program unusable for linking
+		glDeleteProgram(link.program);
+		link.program = glCreateProgram();
+		glProgramParameteri(link.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// link shaders
+	link.shaderCount = functionCount;
+	for(int i = 0; i < functionCount; i++)
 	{
-		// shader
-		shader = glCreateShader(functionType == FUNCTIONTYPE_VERTEX ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
-		glShaderSource(shader, 1, &code, NULL);
-		glCompileShader(shader);
+		link.shaders[i] = functions[i]->GetShader();
+		glAttachShader(link.program, link.shaders[i]);
+	}
+	glLinkProgram(link.program);
+}
 
+// Finish building a program, waiting for its link: report errors, or store it in the program cache
+static void EndProgram(OpenGLProgramCache *programCache, OpenGLProgramLink &link)
+{
+	if(link.cached)
+		return;
+
+	RENDER_TRACE_ZONE("Link Program");
+
+	// check for linking errors
+	int success;
+	char infoLog[512];
+	glGetProgramiv(link.program, GL_LINK_STATUS, &success);
+	if(!success)
+	{
 		// check for shader compile errors
-		int success;
-		char infoLog[512];
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-		if(!success)
+		for(int i = 0; i < link.shaderCount; i++)
 		{
-			glGetShaderInfoLog(shader, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::"<< (functionType == FUNCTIONTYPE_VERTEX ? "VERTEX" : "FRAGMENT") << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+			GLint shaderType = 0;
+			glGetShaderiv(link.shaders[i], GL_COMPILE_STATUS, &success);
+			glGetShaderiv(link.shaders[i], GL_SHADER_TYPE, &shaderType);
+			if(!success)
+			{
+				glGetShaderInfoLog(link.shaders[i], 512, NULL, infoLog);
+				const char *shaderName = shaderType == GL_VERTEX_SHADER ? "VERTEX" : shaderType == GL_FRAGMENT_SHADER ? "FRAGMENT" : "COMPUTE";
+				std::cout << "ERROR::SHADER::"<< shaderName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+			}
 		}
+
+		glGetProgramInfoLog(link.program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+	else if(programCache && programCache->IsEnabled())
+	{
+		programCache->Store(link.cacheKey, link.program);
 	}
 
-	~OpenGLFunction() override
+	for(int i = 0; i < link.shaderCount; i++)
+		glDetachShader(link.program, link.shaders[i]);
+	link.shaderCount = 0;
+}
+
+// Link the functions into a program, or load it from the program cache when it holds one
+static GLuint CreateProgram(OpenGLProgramCache *programCache, OpenGLFunction *const *functions, int functionCount)
+{
+	RENDER_TRACE_ZONE("Create Program");
+	OpenGLProgramLink link;
+	BeginProgram(programCache, functions, functionCount, link);
+	EndProgram(programCache, link);
+	return link.program;
+}
+
+// A program built off the device's thread for a pipeline state created asynchronously
+struct OpenGLProgramJob
+{
+	OpenGLProgramLink link;
+
+	// Private copies of the functions, compiled by the worker thread
+	OpenGLFunction *functions[2] = {};
+	int functionCount = 0;
+
+	bool done = false;
+	bool abandoned = false; // the pipeline state was destroyed first; the worker deletes the program
+};
+
+// Builds the programs of pipeline states created asynchronously without blocking the
+// device's thread. With KHR_parallel_shader_compile the driver compiles and links on its
+// own threads and the device polls for completion; without it worker threads do, one per
+// spare core up to four, each in a context sharing objects with the device's. When no
+// shared context can be made, programs are built at once.
+class OpenGLPipelineCompiler
+{
+public:
+
+	OpenGLPipelineCompiler(OpenGLProgramCache *programCache) : programCache(programCache)
 	{
-		glDeleteShader(shader);
+		parallel = HasExtension("GL_KHR_parallel_shader_compile") || HasExtension("GL_ARB_parallel_shader_compile");
+
+		// as many compiler threads as the driver will use
+		if(parallel && glMaxShaderCompilerThreadsKHR)
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
 	}
 
-	int shader = 0;
+	~OpenGLPipelineCompiler()
+	{
+		if(!workerThreads.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			jobQueued.notify_all();
+			for(std::thread &workerThread : workerThreads)
+				workerThread.join();
+		}
+
+		for(const std::shared_ptr<OpenGLProgramJob> &job : jobs)
+		{
+			for(int i = 0; i < job->functionCount; i++)
+				delete job->functions[i];
+		}
+	}
+
+	std::shared_ptr<OpenGLProgramJob> Begin(OpenGLFunction *const *functions, int functionCount)
+	{
+		std::shared_ptr<OpenGLProgramJob> job = std::make_shared<OpenGLProgramJob>();
+
+		if(parallel || !StartWorker())
+		{
+			BeginProgram(programCache, functions, functionCount, job->link);
+			job->done = !parallel;
+			if(job->done)
+				EndProgram(programCache, job->link);
+			return job;
+		}
+
+		// the worker compiles its own shader objects, leaving the functions to this thread
+		job->functionCount = functionCount;
+		for(int i = 0; i < functionCount; i++)
+			job->functions[i] = functions[i]->CloneUncached();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+		jobQueued.notify_one();
+		return job;
+	}
+
+	bool IsDone(OpenGLProgramJob &job)
+	{
+		if(parallel || workerThreads.empty())
+		{
+			if(!job.done)
+			{
+				GLint completed = GL_FALSE;
+				glGetProgramiv(job.link.program, GL_COMPLETION_STATUS_KHR, &completed);
+				if(completed)
+					Wait(job);
+			}
+			return job.done;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		return job.done;
+	}
+
+	void Wait(OpenGLProgramJob &job)
+	{
+		RENDER_TRACE_ZONE("Wait for Program");
+		if(parallel || workerThreads.empty())
+		{
+			if(!job.done)
+			{
+				EndProgram(programCache, job.link);
+				job.done = true;
+			}
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		jobDone.wait(lock, [&]() { return job.done; });
+	}
+
+	// The pipeline state is destroyed; delete its program now or once a worker has built it
+	void Abandon(const std::shared_ptr<OpenGLProgramJob> &job)
+	{
+		if(!workerThreads.empty())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(!job->done)
+			{
+				job->abandoned = true;
+				return;
+			}
+		}
+		glDeleteProgram(job->link.program);
+		job->abandoned = true;
+		job->done = true;
+	}
+
+private:
+
+	bool StartWorker()
+	{
+		if(!workerThreads.empty())
+			return true;
+		if(workerFailed)
+			return false;
+
+		unsigned int workerCount = std::thread::hardware_concurrency();
+		workerCount = std::min(std::max(workerCount, 2u) - 1, 4u);
+
+		platform::PLATFORM_WINDOW_REF window = platform::GetCurrentPlatformWindow();
+		for(unsigned int i = 0; i < workerCount; i++)
+		{
+			platform::PLATFORM_WINDOW_REF context = platform::CreatePlatformSharedContext(window);
+			if(!context)
+				break;
+			StartWorkerThread(context);
+		}
+
+		workerFailed = workerThreads.empty();
+		return !workerFailed;
+	}
+
+	void StartWorkerThread(platform::PLATFORM_WINDOW_REF context)
+	{
+		workerThreads.emplace_back([this, context]()
+		{
+			platform::MakePlatformWindowCurrent(context);
+			RENDER_TRACE_THREAD_NAME("Pipeline Compiler");
+			for(;;)
+			{
+				std::shared_ptr<OpenGLProgramJob> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					jobQueued.wait(lock, [&]() { return stopping || !jobs.empty(); });
+					if(stopping)
+						break;
+					job = jobs.front();
+					jobs.pop_front();
+				}
+
+				{
+					RENDER_TRACE_ZONE("Create Program");
+					BeginProgram(programCache, job->functions, job->functionCount, job->link);
+					EndProgram(programCache, job->link);
+					for(int i = 0; i < job->functionCount; i++)
+						delete job->functions[i];
+					job->functionCount = 0;
+
+					// the program is complete before another context may use it
+					glFinish();
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if(job->abandoned)
+						glDeleteProgram(job->link.program);
+					job->done = true;
+				}
+				jobDone.notify_all();
+			}
+			platform::MakePlatformWindowCurrent(nullptr);
+		});
+	}
+
+	OpenGLProgramCache *programCache;
+	bool parallel = false;
+	bool workerFailed = false;
+
+	std::vector<std::thread> workerThreads;
+	std::mutex mutex;
+	std::condition_variable jobQueued;
+	std::condition_variable jobDone;
+	std::deque<std::shared_ptr<OpenGLProgramJob>> jobs;
+	bool stopping = false;
 };
 
 class OpenGLVertexDescriptor : public VertexDescriptor
@@ -60,7 +459,8 @@ public:
 		const GLvoid *pointer;
 	};
 
-	OpenGLVertexDescriptor(const VertexBufferLayout& vertexBufferLayout) : numVertexAttributes(vertexBufferLayout.attributeCount)
+	OpenGLVertexDescriptor(const VertexBufferLayout& vertexBufferLayout) : numVertexAttributes(vertexBufferLayout.attributeCount),
+		arrayStride(vertexBufferLayout.arrayStride), attributes(vertexBufferLayout.attributes, vertexBufferLayout.attributes + vertexBufferLayout.attributeCount)
 	{
 		static GLenum toOpenGLType[] = { GL_BYTE, GL_SHORT, GL_INT, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT,
 			GL_BYTE, GL_SHORT, GL_INT, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT, GL_HALF_FLOAT, GL_FLOAT, GL_DOUBLE };
@@ -116,7 +516,7 @@ public:
 		}
 	}
 
-	OpenGLVertexDescriptor(const OpenGLVertexDescriptor& other)
+	OpenGLVertexDescriptor(const OpenGLVertexDescriptor& other) : arrayStride(other.arrayStride), attributes(other.attributes)
 	{
 		numVertexAttributes = other.numVertexAttributes;
 		openGLVertexAttributes = new OpenGLVertexAttribute[numVertexAttributes];
@@ -134,30 +534,21 @@ public:
 
 	unsigned int numVertexAttributes = 0;
 	OpenGLVertexAttribute *openGLVertexAttributes = nullptr;
+
+	// The layout as given, for the pipeline manifest
+	unsigned int arrayStride = 0;
+	std::vector<VertexAttribute> attributes;
 };
 
 class OpenGLRenderPipelineState : public RenderPipelineState
 {
 public:
 
-	OpenGLRenderPipelineState(OpenGLFunction *vertexFunction, OpenGLFunction *fragmentFunction, OpenGLVertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL)
+	// The program is the device's, shared with other pipeline states of the same functions and
+	// built by the compiler when it was created asynchronously or prewarmed
+	OpenGLRenderPipelineState(OpenGLPipelineCompiler *compiler, const std::shared_ptr<OpenGLProgramJob> &job, uint64_t programKey, OpenGLVertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL)
+	: programKey(programKey), compiler(compiler), job(job)
 	{
-		// link shaders
-		shaderProgram = glCreateProgram();
-		glAttachShader(shaderProgram, vertexFunction->shader);
-		glAttachShader(shaderProgram, fragmentFunction->shader);
-		glLinkProgram(shaderProgram);
-
-		// check for linking errors
-		int success;
-		char infoLog[512];
-		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-		if(!success)
-		{
-			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-		}
-
 		glGenVertexArrays(1, &vertexArrayObject);
 
 		this->vertexDescriptor = new OpenGLVertexDescriptor(*vertexDescriptor);
@@ -178,11 +569,35 @@ public:
 		delete vertexDescriptor;
 
 		glDeleteVertexArrays(1, &vertexArrayObject);
+	}
 
-		glDeleteProgram(shaderProgram);
+	bool IsReady() override
+	{
+		if(!shaderProgram && (!compiler || compiler->IsDone(*job)))
+			SetProgram(job->link.program);
+		return shaderProgram != 0;
 	}
 
-	unsigned int shaderProgram = 0;
+	void Wait() override
+	{
+		if(!shaderProgram && compiler)
+			compiler->Wait(*job);
+		SetProgram(job->link.program);
+	}
+
+	const ShaderBinding *GetBindings(unsigned int &bindingCount) override
+	{
+		Wait();
+		return reflection.GetBindings(bindingCount);
+	}
+
+	int GetBindingIndex(BindingType bindingType, const char *name) override
+	{
+		Wait();
+		return reflection.GetBindingIndex(bindingType, name);
+	}
+
+	unsigned int shaderProgram = 0; // 0 until ready
 	unsigned int vertexArrayObject = 0;
 	OpenGLVertexDescriptor *vertexDescriptor = nullptr;
 
@@ -191,6 +606,61 @@ public:
 	GLenum frontFace;
 	GLenum cullFace;
 	GLenum polygonMode;
+
+	// The device's reference to the program
+	uint64_t programKey;
+
+	// Drawn with instead while not ready, whatever the encoder's pending pipeline policy
+	OpenGLRenderPipelineState *fallback = nullptr;
+
+private:
+
+	// Reflect the program once it is linked, checking the vertex layout against its inputs
+	void SetProgram(GLuint program)
+	{
+		shaderProgram = program;
+		if(program && !reflection.IsReflected())
+		{
+			reflection.Reflect(program);
+			reflection.ValidateVertexInputs(vertexDescriptor->attributes);
+		}
+	}
+
+	// Null when the program was built at once, before the device had a compiler
+	OpenGLPipelineCompiler *compiler;
+	std::shared_ptr<OpenGLProgramJob> job;
+
+	OpenGLProgramReflection reflection;
+};
+
+class OpenGLComputePipelineState : public ComputePipelineState
+{
+public:
+
+	// The program is the device's, shared with other pipeline states of the same function
+	OpenGLComputePipelineState(GLuint shaderProgram, uint64_t programKey) : shaderProgram(shaderProgram), programKey(programKey)
+	{
+		reflection.Reflect(shaderProgram);
+	}
+
+	const ShaderBinding *GetBindings(unsigned int &bindingCount) override
+	{
+		return reflection.GetBindings(bindingCount);
+	}
+
+	int GetBindingIndex(BindingType bindingType, const char *name) override
+	{
+		return reflection.GetBindingIndex(bindingType, name);
+	}
+
+	unsigned int shaderProgram = 0;
+
+	// The device's reference to the program
+	uint64_t programKey;
+
+private:
+
+	OpenGLProgramReflection reflection;
 };
 
 class OpenGLBuffer : public Buffer
@@ -200,10 +670,14 @@ public:
 	OpenGLBuffer(const render::BufferType& bufferType, long long size, const void *data)
 	: Buffer(bufferType, size, data)
 	{
+		static const GLenum target_map[] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_SHADER_STORAGE_BUFFER };
+		static const GLenum usage_map[] = { GL_STATIC_DRAW, GL_STATIC_DRAW, GL_DYNAMIC_COPY }; // vertex and index buffers are always assuming static, for now
+
+		this->size = size;
 		glGenBuffers(1, &BO);
-		glBindBuffer(bufferType == render::BUFFERTYPE_VERTEX ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, BO);
-		glBufferData(bufferType == render::BUFFERTYPE_VERTEX ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW); // always assuming static, for now
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(target_map[bufferType], BO);
+		glBufferData(target_map[bufferType], size, data, usage_map[bufferType]);
+		glBindBuffer(target_map[bufferType], 0);
 	}
 
 	~OpenGLBuffer() override
@@ -212,21 +686,46 @@ public:
 	}
 
 	unsigned int BO = 0;
+	long long size = 0;
 };
 
+// Indexed by PixelFormat
+static const GLenum pixel_internal_format_map[] = { GL_RGBA8, GL_R32F, GL_RG32F, GL_RGBA16F, GL_RGBA32F, GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8 };
+static const GLenum pixel_format_map[] = { GL_RGBA, GL_RED, GL_RG, GL_RGBA, GL_RGBA, GL_DEPTH_COMPONENT, GL_DEPTH_STENCIL };
+static const GLenum pixel_type_map[] = { GL_UNSIGNED_BYTE, GL_FLOAT, GL_FLOAT, GL_HALF_FLOAT, GL_FLOAT, GL_FLOAT, GL_UNSIGNED_INT_24_8 };
+static const int pixel_size_map[] = { 4, 4, 8, 8, 16, 4, 4 };
+
 class OpenGLTexture2D : public Texture2D
 {
 public:
 
-	OpenGLTexture2D(int width, int height, const void *data = nullptr)
+	OpenGLTexture2D(int width, int height, PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM, int mipLevelCount = 0, const void *data = nullptr)
 	{
+		// a full mip chain ends at 1x1
+		if(mipLevelCount <= 0)
+		{
+			mipLevelCount = 1;
+			for(int size = width > height ? width : height; size > 1; size /= 2)
+				mipLevelCount++;
+		}
+
 		this->width = width;
 		this->height = height;
+		this->pixelFormat = pixelFormat;
+		this->internalFormat = pixel_internal_format_map[pixelFormat];
+		this->mipLevelCount = mipLevelCount;
 		glActiveTexture(GL_TEXTURE0);
 		glGenTextures(1, &texture);
 		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexStorage2D(GL_TEXTURE_2D, mipLevelCount, internalFormat, width, height); // immutable, so it is complete at any level count and can be bound as an image
+		if(data)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, pixel_format_map[pixelFormat], pixel_type_map[pixelFormat], data);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			if(mipLevelCount > 1)
+				glGenerateMipmap(GL_TEXTURE_2D);
+		}
 	}
 
 	~OpenGLTexture2D() override
@@ -237,6 +736,104 @@ public:
 	unsigned int texture = 0;
 	int width = 0;
 	int height = 0;
+	PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM;
+	GLenum internalFormat = GL_RGBA8;
+	int mipLevelCount = 1;
+};
+
+// One slot of the device's readback ring: a pixel pack buffer the copy lands in and the fence that signals its arrival
+class OpenGLPixelReadback : public PixelReadback
+{
+public:
+
+	~OpenGLPixelReadback() override
+	{
+		Release();
+		glDeleteBuffers(1, &buffer);
+	}
+
+	bool IsReady() override
+	{
+		if(!fence)
+			return true;
+
+		// the flush makes sure the fence reaches the GPU even if nothing else is submitted
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+		return fence == nullptr;
+	}
+
+	void Wait() override
+	{
+		if(!fence)
+			return;
+
+		GLenum result;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1s per attempt
+		} while(result == GL_TIMEOUT_EXPIRED);
+
+		if(result == GL_WAIT_FAILED)
+			printf("OpenGL error in PixelReadback::Wait: %d\n", glGetError());
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	const void *GetData() override
+	{
+		if(!mappedData)
+		{
+			Wait();
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+			mappedData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GetByteSize(), GL_MAP_READ_BIT);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		return mappedData;
+	}
+
+	int GetWidth() const override { return width; }
+
+	int GetHeight() const override { return height; }
+
+	PixelFormat GetPixelFormat() const override { return pixelFormat; }
+
+	int GetPixelSize() const override { return pixel_size_map[pixelFormat]; }
+
+	GLsizeiptr GetByteSize() const { return static_cast<GLsizeiptr>(width) * height * GetPixelSize(); }
+
+	// Unmap and drop the fence so the slot can take the next copy
+	void Release()
+	{
+		if(mappedData)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			mappedData = nullptr;
+		}
+		if(fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+		inUse = false;
+	}
+
+	GLuint buffer = 0;
+	GLsizeiptr capacity = 0;
+	GLsync fence = nullptr;
+	void *mappedData = nullptr;
+	bool inUse = false;
+
+	int width = 0;
+	int height = 0;
+	PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM;
 };
 
 class OpenGLDepthStencilState : public DepthStencilState
@@ -360,8 +957,8 @@ public:
 	unsigned int sampler = 0;
 };
 
-OpenGLLibrary::OpenGLLibrary(const char *vertexShaderSource, const char *fragmentShaderSource)
-: Library(vertexShaderSource, fragmentShaderSource)
+OpenGLLibrary::OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *vertexShaderSource, const char *fragmentShaderSource)
+: Library(vertexShaderSource, fragmentShaderSource), m_ShaderCache(shaderCache)
 {
 	this->m_vertexShaderSource = new char[strlen(vertexShaderSource) + 1];
 	this->m_fragmentShaderSource = new char[strlen(fragmentShaderSource) + 1];
@@ -369,24 +966,134 @@ OpenGLLibrary::OpenGLLibrary(const char *vertexShaderSource, const char *fragmen
 	strcpy(this->m_fragmentShaderSource, fragmentShaderSource);
 }
 
+OpenGLLibrary::OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *computeShaderSource)
+: Library(computeShaderSource), m_ShaderCache(shaderCache)
+{
+	this->m_computeShaderSource = new char[strlen(computeShaderSource) + 1];
+	strcpy(this->m_computeShaderSource, computeShaderSource);
+}
+
+// The source compiled as a function: after the #version line go the stage's define, each
+// constant as RENDER_DEVICE_CONSTANT_<id>, any further defines, and for an entry point its
+// name defined as main; #line keeps error lines the source's
+static std::string MakeFunctionSource(const char *source, FunctionType functionType, const char *name, const FunctionConstant *constants, unsigned int constantCount, const std::string &defines = std::string())
+{
+	static const char *stage_define_map[] = { "RENDER_DEVICE_VERTEX", "RENDER_DEVICE_FRAGMENT", "RENDER_DEVICE_COMPUTE" };
+
+	const char *body = source;
+	int bodyLine = 1;
+	const char *version = source + strspn(source, " \t\r\n");
+	if(strncmp(version, "#version", 8) == 0)
+	{
+		const char *end = strchr(version, '\n');
+		body = end ? end + 1 : version + strlen(version);
+		bodyLine = static_cast<int>(std::count(source, body, '\n')) + 1;
+	}
+
+	std::string functionSource(source, body);
+	if(!functionSource.empty() && functionSource.back() != '\n')
+		functionSource += '\n';
+	functionSource += std::string("#define ") + stage_define_map[functionType] + " 1\n";
+	for(unsigned int i = 0; i < constantCount; i++)
+		functionSource += "#define RENDER_DEVICE_CONSTANT_" + std::to_string(constants[i].constantId) + " " + std::to_string(constants[i].value) + "\n";
+	functionSource += defines;
+	if(name)
+		functionSource += std::string("#define ") + name + " main\n";
+	functionSource += "#line " + std::to_string(bodyLine) + "\n";
+	return functionSource + body;
+}
+
+OpenGLLibrary::OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *source, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount)
+: m_ShaderCache(shaderCache), m_Source(source)
+{
+	for(unsigned int i = 0; i < entryPointCount; i++)
+	{
+		OpenGLEntryPoint entryPoint;
+		entryPoint.name = entryPoints[i].name;
+		entryPoint.function = new OpenGLFunction(entryPoints[i].functionType,
+			MakeFunctionSource(source, entryPoints[i].functionType, entryPoints[i].name, nullptr, 0).c_str(), shaderCache);
+		m_EntryPoints.push_back(entryPoint);
+	}
+
+	// submit every compile before any is waited on, so a driver compiling in parallel has
+	// them all at once; errors are reported when a program using one fails to link
+	for(OpenGLEntryPoint &entryPoint : m_EntryPoints)
+		entryPoint.function->GetShader();
+}
+
+OpenGLLibrary::OpenGLLibrary(OpenGLShaderCache *shaderCache, const std::string &binary, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount)
+: m_ShaderCache(shaderCache)
+{
+	// specialized, and so compiled, when a function is created
+	for(unsigned int i = 0; i < entryPointCount; i++)
+	{
+		OpenGLEntryPoint entryPoint;
+		entryPoint.name = entryPoints[i].name;
+		entryPoint.function = new OpenGLFunction(entryPoints[i].functionType, binary, entryPoint.name, nullptr, 0, shaderCache);
+		m_EntryPoints.push_back(entryPoint);
+	}
+}
+
 OpenGLLibrary::~OpenGLLibrary()
 {
 	delete[] m_vertexShaderSource;
 	delete[] m_fragmentShaderSource;
+	delete[] m_computeShaderSource;
+
+	for(OpenGLEntryPoint &entryPoint : m_EntryPoints)
+		delete entryPoint.function;
 }
 
 Function *OpenGLLibrary::CreateFunction(const FunctionType& functionType, const char *name)
+{
+	return CreateFunction(functionType, name, nullptr, 0);
+}
+
+Function *OpenGLLibrary::CreateFunction(const FunctionType& functionType, const char *name, const FunctionConstant *constants, unsigned int constantCount)
+{
+	// shares the entry point's compiled shader through the shader cache when there are no constants
+	for(const OpenGLEntryPoint &entryPoint : m_EntryPoints)
+	{
+		if(entryPoint.function->functionType != functionType || entryPoint.name != name)
+			continue;
+
+		if(!entryPoint.function->binary.empty())
+			return new OpenGLFunction(functionType, entryPoint.function->binary, entryPoint.name, constants, constantCount, m_ShaderCache);
+		if(constantCount == 0)
+			return new OpenGLFunction(functionType, entryPoint.function->source.c_str(), m_ShaderCache);
+		return new OpenGLFunction(functionType, MakeFunctionSource(m_Source.c_str(), functionType, name, constants, constantCount).c_str(), m_ShaderCache);
+	}
+	if(!m_EntryPoints.empty())
+	{
+		std::cout << "ERROR::LIBRARY::ENTRY_POINT_NOT_FOUND " << name << std::endl;
+		return nullptr;
+	}
+
+	const char *source = GetStageSource(functionType);
+	if(!source)
+		return nullptr;
+	if(constantCount == 0)
+		return new OpenGLFunction(functionType, source, m_ShaderCache);
+	return new OpenGLFunction(functionType, MakeFunctionSource(source, functionType, nullptr, constants, constantCount).c_str(), m_ShaderCache);
+}
+
+const char *OpenGLLibrary::GetStageSource(FunctionType functionType) const
 {
 	switch (functionType)
 	{
 		case FUNCTIONTYPE_VERTEX:
 		{
-			return new OpenGLFunction(functionType, m_vertexShaderSource);
+			return m_vertexShaderSource;
 		}
 		break;
 		case FUNCTIONTYPE_FRAGMENT:
 		{
-			return new OpenGLFunction(functionType, m_fragmentShaderSource);
+			return m_fragmentShaderSource;
+		}
+		break;
+		case FUNCTIONTYPE_COMPUTE:
+		{
+			return m_computeShaderSource;
 		}
 		break;
 		default:
@@ -397,6 +1104,58 @@ Function *OpenGLLibrary::CreateFunction(const FunctionType& functionType, const
 	}
 }
 
+void OpenGLLibrary::SetVariantKeywords(const char *const *keywords, unsigned int keywordCount)
+{
+	m_VariantKeywords.assign(keywords, keywords + std::min(keywordCount, 64u));
+	m_VariantSources.clear();
+}
+
+Function *OpenGLLibrary::CreateFunctionVariant(const FunctionType& functionType, const char *name, unsigned long long variantMask)
+{
+	const OpenGLEntryPoint *variantEntryPoint = nullptr;
+	for(const OpenGLEntryPoint &entryPoint : m_EntryPoints)
+	{
+		if(entryPoint.function->functionType == functionType && entryPoint.name == name)
+			variantEntryPoint = &entryPoint;
+	}
+
+	// SPIR-V takes every keyword as a specialization constant, set or not
+	if(variantEntryPoint && !variantEntryPoint->function->binary.empty())
+	{
+		std::vector<FunctionConstant> constants(m_VariantKeywords.size());
+		for(unsigned int i = 0; i < constants.size(); i++)
+		{
+			constants[i].constantId = i;
+			constants[i].value = (variantMask >> i) & 1;
+		}
+		return CreateFunction(functionType, name, constants.data(), static_cast<unsigned int>(constants.size()));
+	}
+
+	const char *source = m_EntryPoints.empty() ? GetStageSource(functionType) : variantEntryPoint ? m_Source.c_str() : nullptr;
+	if(!source)
+	{
+		std::cout << "ERROR::LIBRARY::ENTRY_POINT_NOT_FOUND " << name << std::endl;
+		return nullptr;
+	}
+
+	// bits without a keyword make no difference
+	if(m_VariantKeywords.size() < 64)
+		variantMask &= (1ull << m_VariantKeywords.size()) - 1;
+
+	std::string &variantSource = m_VariantSources[std::make_tuple(static_cast<int>(functionType), variantEntryPoint ? variantEntryPoint->name : std::string(), variantMask)];
+	if(variantSource.empty())
+	{
+		std::string defines;
+		for(unsigned int i = 0; i < m_VariantKeywords.size(); i++)
+		{
+			if((variantMask >> i) & 1)
+				defines += "#define " + m_VariantKeywords[i] + " 1\n";
+		}
+		variantSource = MakeFunctionSource(source, functionType, variantEntryPoint ? name : nullptr, nullptr, 0, defines);
+	}
+	return new OpenGLFunction(functionType, variantSource.c_str(), m_ShaderCache);
+}
+
 void OpenGLLibrary::DestroyFunction(Function *function)
 {
 	delete function;
@@ -404,16 +1163,119 @@ void OpenGLLibrary::DestroyFunction(Function *function)
 
 OpenGLRenderDevice::OpenGLRenderDevice()
 {
+	// Resolve the entry points above OpenGL 3.3 that glad does not provide
+	LoadOpenGLFunctions();
+
+	m_ProgramCache.SetDirectory(getenv("RENDER_DEVICE_PIPELINE_CACHE"));
+
+	GLint majorVersion = 0, minorVersion = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+	m_SpirvSupported = glSpecializeShader && (majorVersion * 10 + minorVersion >= 46 || HasExtension("GL_ARB_gl_spirv"));
+	m_IndirectCountSupported = glMultiDrawElementsIndirectCount && (majorVersion * 10 + minorVersion >= 46 || HasExtension("GL_ARB_indirect_parameters"));
+	m_GpuTimer.SetDebugGroupsSupported(majorVersion * 10 + minorVersion >= 43 || HasExtension("GL_KHR_debug"));
+
+	if(getenv("RENDER_DEVICE_PERF_COUNTERS"))
+		SetPerfCountersEnabled(true);
 }
 
 OpenGLRenderDevice::~OpenGLRenderDevice()
 {
-	// Do nothing !!
+	// programs prewarmed for pipelines this run never created, or of pipeline states not destroyed
+	for(auto &sharedProgram : m_Programs)
+	{
+		if(m_PipelineCompiler)
+			m_PipelineCompiler->Abandon(sharedProgram.second.job);
+		else
+			glDeleteProgram(sharedProgram.second.job->link.program);
+	}
+	m_Programs.clear();
+	m_PrewarmJobs.clear();
+
+	delete m_PipelineCompiler;
+
+	for(OpenGLPixelReadback *pixelReadback : m_PixelReadbacks)
+		delete pixelReadback;
+
+	for(auto &drawableTexture : m_DrawableTextures)
+		DestroyTexture2D(drawableTexture.second);
+
+	for(auto &framebuffer : m_Framebuffers)
+		glDeleteFramebuffers(1, &framebuffer.second);
 }
 
 Library *OpenGLRenderDevice::CreateLibrary(const char *vertexShaderSource, const char *fragmentShaderSource)
 {
-	return new OpenGLLibrary(vertexShaderSource, fragmentShaderSource);
+	return new OpenGLLibrary(&m_ShaderCache, vertexShaderSource, fragmentShaderSource);
+}
+
+Library *OpenGLRenderDevice::CreateLibrary(const char *computeShaderSource)
+{
+	return new OpenGLLibrary(&m_ShaderCache, computeShaderSource);
+}
+
+Library *OpenGLRenderDevice::CreateLibrary(const char *source, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount)
+{
+	// the driver compiles on its own threads once told how many it may use
+	if(!m_PipelineCompiler)
+		m_PipelineCompiler = new OpenGLPipelineCompiler(&m_ProgramCache);
+
+	return new OpenGLLibrary(&m_ShaderCache, source, entryPoints, entryPointCount);
+}
+
+Library *OpenGLRenderDevice::CreateLibraryFromSPIRV(const void *words, size_t size, const char *fallbackSource)
+{
+	static const uint32_t kSpirvMagic = 0x07230203;
+	static const uint32_t kOpEntryPoint = 15;
+	static const uint32_t kOpFunction = 54;
+
+	const uint32_t *code = static_cast<const uint32_t *>(words);
+	size_t wordCount = size / sizeof(uint32_t);
+	if(wordCount < 5 || code[0] != kSpirvMagic)
+	{
+		std::cout << "ERROR::LIBRARY::INVALID_SPIRV" << std::endl;
+		return nullptr;
+	}
+
+	// the entry points are declared ahead of the first function; vertex, fragment and compute
+	// ones are kept, by execution model 0, 4 and 5
+	std::vector<std::string> names;
+	std::vector<FunctionType> functionTypes;
+	for(size_t i = 5; i < wordCount;)
+	{
+		uint32_t instructionWordCount = code[i] >> 16;
+		uint32_t opcode = code[i] & 0xFFFF;
+		if(instructionWordCount == 0 || i + instructionWordCount > wordCount || opcode == kOpFunction)
+			break;
+
+		if(opcode == kOpEntryPoint && instructionWordCount > 3 && (code[i + 1] == 0 || code[i + 1] == 4 || code[i + 1] == 5))
+		{
+			const char *name = reinterpret_cast<const char *>(&code[i + 3]);
+			names.push_back(std::string(name, strnlen(name, (instructionWordCount - 3) * sizeof(uint32_t))));
+			functionTypes.push_back(code[i + 1] == 0 ? FUNCTIONTYPE_VERTEX : code[i + 1] == 4 ? FUNCTIONTYPE_FRAGMENT : FUNCTIONTYPE_COMPUTE);
+		}
+		i += instructionWordCount;
+	}
+
+	std::vector<LibraryEntryPoint> entryPoints(names.size());
+	for(size_t i = 0; i < names.size(); i++)
+	{
+		entryPoints[i].functionType = functionTypes[i];
+		entryPoints[i].name = names[i].c_str();
+	}
+
+	if(m_SpirvSupported)
+	{
+		std::string binary(static_cast<const char *>(words), wordCount * sizeof(uint32_t));
+		return new OpenGLLibrary(&m_ShaderCache, binary, entryPoints.data(), static_cast<unsigned int>(entryPoints.size()));
+	}
+
+	if(!fallbackSource)
+	{
+		std::cout << "ERROR::LIBRARY::SPIRV_UNSUPPORTED" << std::endl;
+		return nullptr;
+	}
+	return CreateLibrary(fallbackSource, entryPoints.data(), static_cast<unsigned int>(entryPoints.size()));
 }
 
 void OpenGLRenderDevice::DestroyLibrary(Library *library)
@@ -421,27 +1283,264 @@ void OpenGLRenderDevice::DestroyLibrary(Library *library)
 	delete library;
 }
 
+void OpenGLRenderDevice::SetPipelineCacheDirectory(const char *directory)
+{
+	m_ProgramCache.SetDirectory(directory);
+}
+
+// Hashes the content of each function; pipeline states whose functions hash the same share a program
+static uint64_t GetProgramSourceKey(OpenGLFunction *const *functions, int functionCount)
+{
+	uint64_t key = kHashSeed;
+	for(int i = 0; i < functionCount; i++)
+	{
+		uint64_t functionKey = functions[i]->GetContentKey();
+		key = HashBytes(key, &functionKey, sizeof(functionKey));
+	}
+	return key;
+}
+
+std::shared_ptr<OpenGLProgramJob> OpenGLRenderDevice::AcquireProgram(OpenGLFunction *const *functions, int functionCount, bool async, uint64_t &key)
+{
+	key = GetProgramSourceKey(functions, functionCount);
+
+	auto sharedProgram = m_Programs.find(key);
+	if(sharedProgram != m_Programs.end())
+	{
+		// the first pipeline state of a prewarmed program takes over the prewarm's reference
+		if(sharedProgram->second.prewarmed)
+			sharedProgram->second.prewarmed = false;
+		else
+			sharedProgram->second.referenceCount++;
+		m_ProgramHitCount++;
+		return sharedProgram->second.job;
+	}
+
+	m_ProgramMissCount++;
+	std::shared_ptr<OpenGLProgramJob> job;
+	if(async)
+	{
+		job = m_PipelineCompiler->Begin(functions, functionCount);
+	}
+	else
+	{
+		job = std::make_shared<OpenGLProgramJob>();
+		job->link.program = CreateProgram(&m_ProgramCache, functions, functionCount);
+		job->done = true;
+	}
+
+	OpenGLSharedProgram &newProgram = m_Programs[key];
+	newProgram.job = job;
+	newProgram.referenceCount = 1;
+	return job;
+}
+
+void OpenGLRenderDevice::ReleaseProgram(uint64_t key)
+{
+	auto sharedProgram = m_Programs.find(key);
+	if(sharedProgram == m_Programs.end() || --sharedProgram->second.referenceCount > 0)
+		return;
+
+	if(m_PipelineCompiler)
+		m_PipelineCompiler->Abandon(sharedProgram->second.job);
+	else
+		glDeleteProgram(sharedProgram->second.job->link.program);
+	m_Programs.erase(sharedProgram);
+}
+
 RenderPipelineState *OpenGLRenderDevice::CreateRenderPipelineState(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled, Winding frontFace, Face cullFace, RasterMode rasterMode)
 {
+	RENDER_TRACE_ZONE("Create Render Pipeline State");
+	OpenGLFunction *oglVertexShader = static_cast<OpenGLFunction *>(vertexShader);
+	OpenGLFunction *oglFragmentShader = static_cast<OpenGLFunction *>(fragmentShader);
+	OpenGLVertexDescriptor *oglVertexDescriptor = static_cast<OpenGLVertexDescriptor *>(vertexDescriptor);
+
+	// the manifest holds GLSL; SPIR-V pipelines are left out
+	if(oglVertexShader->binary.empty() && oglFragmentShader->binary.empty())
+		m_PipelineManifest.AddRenderPipeline(oglVertexShader->source, oglFragmentShader->source, oglVertexDescriptor->arrayStride,
+			oglVertexDescriptor->attributes, cullEnabled, frontFace, cullFace, rasterMode);
+
+	// built at once unless it is already being built for a pipeline state created asynchronously or prewarmed
+	OpenGLFunction *functions[] = { oglVertexShader, oglFragmentShader };
+	uint64_t programKey;
+	std::shared_ptr<OpenGLProgramJob> job = AcquireProgram(functions, 2, false, programKey);
+
+	OpenGLRenderPipelineState *renderPipelineState = new OpenGLRenderPipelineState(m_PipelineCompiler, job, programKey,
+		oglVertexDescriptor, cullEnabled, frontFace, cullFace, rasterMode);
+	renderPipelineState->Wait();
+	return renderPipelineState;
+}
+
+RenderPipelineState *OpenGLRenderDevice::CreateRenderPipelineStateAsync(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled, Winding frontFace, Face cullFace, RasterMode rasterMode, RenderPipelineState *fallbackPipelineState)
+{
+	if(!m_PipelineCompiler)
+		m_PipelineCompiler = new OpenGLPipelineCompiler(&m_ProgramCache);
+
 	OpenGLFunction *oglVertexShader = static_cast<OpenGLFunction *>(vertexShader);
 	OpenGLFunction *oglFragmentShader = static_cast<OpenGLFunction *>(fragmentShader);
 	OpenGLVertexDescriptor *oglVertexDescriptor = static_cast<OpenGLVertexDescriptor *>(vertexDescriptor);
 
-	return new OpenGLRenderPipelineState(oglVertexShader, oglFragmentShader, oglVertexDescriptor, cullEnabled, frontFace, cullFace, rasterMode);
+	// the manifest holds GLSL; SPIR-V pipelines are left out
+	if(oglVertexShader->binary.empty() && oglFragmentShader->binary.empty())
+		m_PipelineManifest.AddRenderPipeline(oglVertexShader->source, oglFragmentShader->source, oglVertexDescriptor->arrayStride,
+			oglVertexDescriptor->attributes, cullEnabled, frontFace, cullFace, rasterMode);
+
+	OpenGLFunction *functions[] = { oglVertexShader, oglFragmentShader };
+	uint64_t programKey;
+	std::shared_ptr<OpenGLProgramJob> job = AcquireProgram(functions, 2, true, programKey);
+
+	OpenGLRenderPipelineState *renderPipelineState = new OpenGLRenderPipelineState(m_PipelineCompiler, job, programKey, oglVertexDescriptor, cullEnabled, frontFace, cullFace, rasterMode);
+	renderPipelineState->fallback = static_cast<OpenGLRenderPipelineState *>(fallbackPipelineState);
+	return renderPipelineState;
 }
 
 void OpenGLRenderDevice::DestroyRenderPipelineState(RenderPipelineState *renderPipelineState)
 {
-	delete static_cast<OpenGLRenderPipelineState *>(renderPipelineState);
+	OpenGLRenderPipelineState *oglRenderPipelineState = static_cast<OpenGLRenderPipelineState *>(renderPipelineState);
+	ReleaseProgram(oglRenderPipelineState->programKey);
+	delete oglRenderPipelineState;
+}
+
+ComputePipelineState *OpenGLRenderDevice::CreateComputePipelineState(Function *computeShader)
+{
+	RENDER_TRACE_ZONE("Create Compute Pipeline State");
+	OpenGLFunction *oglComputeShader = static_cast<OpenGLFunction *>(computeShader);
+
+	if(oglComputeShader->binary.empty())
+		m_PipelineManifest.AddComputePipeline(oglComputeShader->source);
+
+	uint64_t programKey;
+	std::shared_ptr<OpenGLProgramJob> job = AcquireProgram(&oglComputeShader, 1, false, programKey);
+	if(m_PipelineCompiler)
+		m_PipelineCompiler->Wait(*job);
+
+	return new OpenGLComputePipelineState(job->link.program, programKey);
+}
+
+void OpenGLRenderDevice::DestroyComputePipelineState(ComputePipelineState *computePipelineState)
+{
+	OpenGLComputePipelineState *oglComputePipelineState = static_cast<OpenGLComputePipelineState *>(computePipelineState);
+	ReleaseProgram(oglComputePipelineState->programKey);
+	delete oglComputePipelineState;
+}
+
+void OpenGLRenderDevice::GetShaderCacheStatistics(ShaderCacheStatistics &statistics)
+{
+	statistics.shaderHitCount = m_ShaderCache.GetHitCount();
+	statistics.shaderMissCount = m_ShaderCache.GetMissCount();
+	statistics.shaderCount = m_ShaderCache.GetShaderCount();
+	statistics.programHitCount = m_ProgramHitCount;
+	statistics.programMissCount = m_ProgramMissCount;
+	statistics.programCount = static_cast<unsigned int>(m_Programs.size());
+}
+
+bool OpenGLRenderDevice::SavePipelineManifest(const char *path)
+{
+	return m_PipelineManifest.Save(path);
+}
+
+int OpenGLRenderDevice::PrewarmPipelines(const char *path, bool wait)
+{
+	OpenGLPipelineManifest manifest;
+	if(!manifest.Load(path))
+		return -1;
+
+	if(!m_PipelineCompiler)
+		m_PipelineCompiler = new OpenGLPipelineCompiler(&m_ProgramCache);
+
+	int programCount = 0;
+	for(const OpenGLPipelineManifest::Pipeline &pipeline : manifest.GetPipelines())
+	{
+		OpenGLFunction *functions[2] = {};
+		for(int i = 0; i < pipeline.stageCount; i++)
+		{
+			const OpenGLPipelineManifest::Stage &stage = manifest.GetStage(pipeline.stageHashes[i]);
+			functions[i] = new OpenGLFunction(stage.functionType, stage.source.c_str());
+		}
+
+		// listed again when saved, whether or not this run creates it
+		if(pipeline.stageCount == 2)
+			m_PipelineManifest.AddRenderPipeline(functions[0]->source, functions[1]->source, pipeline.arrayStride, pipeline.attributes,
+				pipeline.cullEnabled, pipeline.frontFace, pipeline.cullFace, pipeline.rasterMode);
+		else
+			m_PipelineManifest.AddComputePipeline(functions[0]->source);
+
+		// pipelines differing only in vertex layout or raster state share a program, as do
+		// those already created
+		uint64_t key = GetProgramSourceKey(functions, pipeline.stageCount);
+		if(m_Programs.find(key) == m_Programs.end())
+		{
+			OpenGLSharedProgram &sharedProgram = m_Programs[key];
+			sharedProgram.job = m_PipelineCompiler->Begin(functions, pipeline.stageCount);
+			sharedProgram.referenceCount = 1;
+			sharedProgram.prewarmed = true;
+			m_PrewarmJobs.push_back(sharedProgram.job);
+			programCount++;
+		}
+
+		// shaders attached to a program linking in parallel are deleted once it is done with them
+		for(int i = 0; i < pipeline.stageCount; i++)
+			delete functions[i];
+	}
+
+	if(wait)
+	{
+		for(const std::shared_ptr<OpenGLProgramJob> &job : m_PrewarmJobs)
+			m_PipelineCompiler->Wait(*job);
+	}
+	return programCount;
+}
+
+void OpenGLRenderDevice::GetPrewarmProgress(unsigned int &readyCount, unsigned int &totalCount)
+{
+	readyCount = 0;
+	totalCount = static_cast<unsigned int>(m_PrewarmJobs.size());
+	for(const std::shared_ptr<OpenGLProgramJob> &job : m_PrewarmJobs)
+	{
+		if(m_PipelineCompiler->IsDone(*job))
+			readyCount++;
+	}
+}
+
+void OpenGLRenderDevice::EndFrame()
+{
+	RENDER_TRACE_FRAME();
+	m_GpuTimer.EndFrame();
+	m_FrameStatistics.EndFrame();
+}
+
+void OpenGLRenderDevice::GetFrameGpuTimings(FrameGpuTimings &timings)
+{
+	m_GpuTimer.GetFrameGpuTimings(timings);
+}
+
+void OpenGLRenderDevice::GetFrameStatistics(FrameStatistics &statistics)
+{
+	m_FrameStatistics.GetFrameStatistics(statistics);
+}
+
+bool OpenGLRenderDevice::SetPerfCountersEnabled(bool enabled)
+{
+	if(!enabled)
+	{
+		m_PerfCounters.Close();
+		return true;
+	}
+	return m_PerfCounters.Open();
 }
 
 Buffer *OpenGLRenderDevice::CreateBuffer(const render::BufferType& bufferType, long long size, const void *data)
 {
+	RENDER_TRACE_ZONE("Create Buffer");
+	OpenGLPerfScope perfScope(m_PerfCounters, m_FrameStatistics.counters);
+	if(data)
+		m_FrameStatistics.counters.bufferBytesUploaded += size;
 	return new OpenGLBuffer(bufferType, size, data);
 }
 
 void OpenGLRenderDevice::DestroyBuffer(Buffer *buffer)
 {
+	m_PendingBarriers.erase(buffer);
 	delete buffer;
 }
 
@@ -462,11 +1561,41 @@ void OpenGLRenderDevice::DestroyVertexDescriptor(VertexDescriptor *vertexDescrip
 
 Texture2D *OpenGLRenderDevice::CreateTexture2D(int width, int height, const void *data)
 {
-	return new OpenGLTexture2D(width, height, data);
+	RENDER_TRACE_ZONE("Create Texture");
+	OpenGLPerfScope perfScope(m_PerfCounters, m_FrameStatistics.counters);
+	if(data)
+		m_FrameStatistics.counters.textureBytesUploaded += static_cast<unsigned long long>(width) * height * pixel_size_map[PIXELFORMAT_RGBA8_UNORM];
+	return new OpenGLTexture2D(width, height, PIXELFORMAT_RGBA8_UNORM, 0, data);
+}
+
+Texture2D *OpenGLRenderDevice::CreateTexture2D(int width, int height, PixelFormat pixelFormat, int mipLevelCount, const void *data)
+{
+	RENDER_TRACE_ZONE("Create Texture");
+	OpenGLPerfScope perfScope(m_PerfCounters, m_FrameStatistics.counters);
+	if(data)
+		m_FrameStatistics.counters.textureBytesUploaded += static_cast<unsigned long long>(width) * height * pixel_size_map[pixelFormat];
+	return new OpenGLTexture2D(width, height, pixelFormat, mipLevelCount, data);
 }
 
 void OpenGLRenderDevice::DestroyTexture2D(Texture2D *texture2D)
 {
+	// the texture name may be reused, so no cached framebuffer may keep referring to it
+	if(texture2D)
+	{
+		GLuint texture = static_cast<OpenGLTexture2D *>(texture2D)->texture;
+		for(auto it = m_Framebuffers.begin(); it != m_Framebuffers.end(); )
+		{
+			if(it->first.References(texture))
+			{
+				glDeleteFramebuffers(1, &it->second);
+				it = m_Framebuffers.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	m_PendingBarriers.erase(texture2D);
 	delete texture2D;
 }
 
@@ -553,6 +1682,17 @@ void OpenGLRenderDevice::Clear(float red, float green, float blue, float alpha,
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 
+// Count a draw of count vertices or indices, and the triangles they make, into the frame
+static void CountDraw(FrameCounters &counters, PrimitiveType primitiveType, unsigned long long count, unsigned long long instanceCount)
+{
+	counters.drawCount++;
+	counters.instanceCount += instanceCount;
+	if(primitiveType == PRIMITIVETYPE_TRIANGLE)
+		counters.triangleCount += count / 3 * instanceCount;
+	else if(primitiveType == PRIMITIVETYPE_TRIANGLESTRIP && count > 2)
+		counters.triangleCount += (count - 2) * instanceCount;
+}
+
 void OpenGLRenderDevice::Draw(const PrimitiveType& primitiveType, int offset, int count)
 {
 	GLenum mode;
@@ -578,30 +1718,32 @@ void OpenGLRenderDevice::Draw(const PrimitiveType& primitiveType, int offset, in
 		} break;
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(m_VertexBuffer)->BO);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(m_VertexBuffer)->BO));
 
 	if (m_RenderPipelineState) {
-		glUseProgram(m_RenderPipelineState->shaderProgram);
-		glBindVertexArray(m_RenderPipelineState->vertexArrayObject);
+		OGL_COUNTED(m_FrameStatistics.counters, glUseProgram(m_RenderPipelineState->shaderProgram));
+		OGL_COUNTED(m_FrameStatistics.counters, glBindVertexArray(m_RenderPipelineState->vertexArrayObject));
 		OpenGLVertexDescriptor *vertexDescriptor = m_RenderPipelineState->vertexDescriptor;
 		for(unsigned int j = 0; j < vertexDescriptor->numVertexAttributes; j++)
 		{
-			glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index);
-			glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
+			OGL_COUNTED(m_FrameStatistics.counters, glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index));
+			OGL_COUNTED(m_FrameStatistics.counters, glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
 								  vertexDescriptor->openGLVertexAttributes[j].size,
 								  vertexDescriptor->openGLVertexAttributes[j].type,
 								  vertexDescriptor->openGLVertexAttributes[j].normalized,
 								  vertexDescriptor->openGLVertexAttributes[j].stride,
-								  vertexDescriptor->openGLVertexAttributes[j].pointer);
+								  vertexDescriptor->openGLVertexAttributes[j].pointer));
 		}
 	}
 
-	glDrawArrays(mode, offset, count);
+	OGL_COUNTED(m_FrameStatistics.counters, glDrawArrays(mode, offset, count));
 
-	glBindVertexArray(0);
-	glUseProgram(0);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindVertexArray(0));
+	OGL_COUNTED(m_FrameStatistics.counters, glUseProgram(0));
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	CountDraw(m_FrameStatistics.counters, primitiveType, count, 1);
 }
 
 void OpenGLRenderDevice::DrawIndexed(const PrimitiveType& primitiveType, const IndexType& indexType, Buffer *indexBuffer, long long offset, int count)
@@ -629,49 +1771,51 @@ void OpenGLRenderDevice::DrawIndexed(const PrimitiveType& primitiveType, const I
 		} break;
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(m_VertexBuffer)->BO);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(m_VertexBuffer)->BO));
 
 	if (m_RenderPipelineState) {
-		glUseProgram(m_RenderPipelineState->shaderProgram);
-		glBindVertexArray(m_RenderPipelineState->vertexArrayObject);
+		OGL_COUNTED(m_FrameStatistics.counters, glUseProgram(m_RenderPipelineState->shaderProgram));
+		OGL_COUNTED(m_FrameStatistics.counters, glBindVertexArray(m_RenderPipelineState->vertexArrayObject));
 		OpenGLVertexDescriptor *vertexDescriptor = m_RenderPipelineState->vertexDescriptor;
 		for(unsigned int j = 0; j < vertexDescriptor->numVertexAttributes; j++)
 		{
-			glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index);
-			glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
+			OGL_COUNTED(m_FrameStatistics.counters, glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index));
+			OGL_COUNTED(m_FrameStatistics.counters, glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
 								  vertexDescriptor->openGLVertexAttributes[j].size,
 								  vertexDescriptor->openGLVertexAttributes[j].type,
 								  vertexDescriptor->openGLVertexAttributes[j].normalized,
 								  vertexDescriptor->openGLVertexAttributes[j].stride,
-								  vertexDescriptor->openGLVertexAttributes[j].pointer);
+								  vertexDescriptor->openGLVertexAttributes[j].pointer));
 		}
 	}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(indexBuffer)->BO);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, reinterpret_cast<OpenGLBuffer *>(indexBuffer)->BO));
 	switch (indexType)
 	{
 		case INDEXTYPE_UINT16: {
 			GLenum type = GL_UNSIGNED_SHORT;
 			size_t offsetBytes = offset * sizeof(uint16_t);
-			glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<const void*>(offsetBytes), 0);
+			OGL_COUNTED(m_FrameStatistics.counters, glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<const void*>(offsetBytes), 0));
 		}
 		break;
 		case INDEXTYPE_UINT32: {
 			GLenum type = GL_UNSIGNED_INT;
 			size_t offsetBytes = offset * sizeof(uint32_t);
-			glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<const void*>(offsetBytes), 0);
+			OGL_COUNTED(m_FrameStatistics.counters, glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<const void*>(offsetBytes), 0));
 		}
 		break;
 		default: {
 			assert(false);
 		} break;
 	}
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+	OGL_COUNTED(m_FrameStatistics.counters, glBindVertexArray(0));
+	OGL_COUNTED(m_FrameStatistics.counters, glUseProgram(0));
 
-	glBindVertexArray(0);
-	glUseProgram(0);
+	OGL_COUNTED(m_FrameStatistics.counters, glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	CountDraw(m_FrameStatistics.counters, primitiveType, count, 1);
 }
 
 Texture2D* OpenGLDrawable::GetTexture() { return texture; }
@@ -682,7 +1826,9 @@ CommandBuffer* OpenGLCommandQueue::CreateCommandBuffer() {
     return new OpenGLCommandBuffer(device);
 }
 
-OpenGLCommandBuffer::OpenGLCommandBuffer(OpenGLRenderDevice* device) : device(device) {}
+OpenGLCommandBuffer::OpenGLCommandBuffer(OpenGLRenderDevice* device) : device(device) {
+    memset(&counters, 0, sizeof(counters));
+}
 OpenGLCommandBuffer::~OpenGLCommandBuffer() {}
 
 RenderCommandEncoder* OpenGLCommandBuffer::CreateRenderCommandEncoder(const RenderPassDescriptor& desc) {
@@ -690,64 +1836,198 @@ RenderCommandEncoder* OpenGLCommandBuffer::CreateRenderCommandEncoder(const Rend
     return new OpenGLRenderCommandEncoder(this, desc);
 }
 
+ComputeCommandEncoder* OpenGLCommandBuffer::CreateComputeCommandEncoder() {
+    return new OpenGLComputeCommandEncoder(this);
+}
+
 void OpenGLCommandBuffer::Present(Drawable* drawable) {
+    RENDER_TRACE_ZONE("Present");
     auto oglDrawable = static_cast<OpenGLDrawable*>(drawable);
     if (oglDrawable && oglDrawable->window) {
-        // Ensure all OpenGL commands are finished before swapping
-        glFinish();
-        // Swap buffers without changing context
-        glfwSwapBuffers(static_cast<GLFWwindow*>(oglDrawable->window));
+        // Offscreen drawables stay in their texture; only window drawables need to wait for the GPU
+        if (!oglDrawable->GetTexture()) {
+            // Ensure all OpenGL commands are finished before swapping
+            OGL_COUNTED(device->GetFrameCounters(), glFinish());
+        }
+        platform::PresentPlatformWindow(oglDrawable->window);
     }
 }
 
 void OpenGLCommandBuffer::Commit() {
+    RENDER_TRACE_ZONE("Commit");
+    OpenGLPerfScope perfScope(device->GetPerfCounters(), device->GetFrameCounters());
+
+    // What was recorded is counted into the frame once, as plain sums
+    unsigned long long commandBytes = commands.size() * sizeof(std::function<void()>) + counters.commandBytes;
+    counters.commandBufferCount = 1;
+    counters.commandCount = commands.size();
+    counters.commandBytes = commandBytes;
+    counters.largestCommandBufferBytes = 0;
+    device->AddFrameCounters(counters);
+    FrameCounters& frame = device->GetFrameCounters();
+    frame.largestCommandBufferBytes = std::max(frame.largestCommandBufferBytes, commandBytes);
+    memset(&counters, 0, sizeof(counters));
+
     // Execute all recorded commands
     for (auto& command : commands) {
         command();
     }
     commands.clear();
     hasRenderPass = false;
+
+    // Buffers created during execution are no longer referenced
+    if (!tempBuffers.empty()) {
+        OGL_COUNTED(frame, glDeleteBuffers(static_cast<GLsizei>(tempBuffers.size()), tempBuffers.data()));
+        tempBuffers.clear();
+    }
+}
+
+void OpenGLCommandBuffer::MarkWritten(const void* resource, GLbitfield barriers) {
+    if (resource) {
+        device->GetPendingBarriers()[resource] |= barriers;
+    }
+}
+
+void OpenGLCommandBuffer::RequireBarrier(const void* resource, GLbitfield barrier, GLbitfield& barriers) {
+    std::map<const void*, GLbitfield>& pendingBarriers = device->GetPendingBarriers();
+    auto it = pendingBarriers.find(resource);
+    if (it != pendingBarriers.end()) {
+        barriers |= it->second & barrier;
+    }
+}
+
+void OpenGLCommandBuffer::InsertBarrier(GLbitfield barriers, std::vector<std::function<void()>>& encoderCommands) {
+    if (barriers == 0) {
+        return;
+    }
+
+    OpenGLRenderDevice* device = this->device;
+    encoderCommands.push_back([device, barriers]() {
+        OGL_COUNTED(device->GetFrameCounters(), glMemoryBarrier(barriers));
+    });
+
+    // A barrier makes all prior writes visible to the accesses it covers, whichever resource they went to
+    std::map<const void*, GLbitfield>& pendingBarriers = device->GetPendingBarriers();
+    for (auto it = pendingBarriers.begin(); it != pendingBarriers.end(); ) {
+        it->second &= ~barriers;
+        if (it->second == 0) {
+            it = pendingBarriers.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 OpenGLRenderCommandEncoder::OpenGLRenderCommandEncoder(OpenGLCommandBuffer* commandBuffer, const RenderPassDescriptor& desc)
     : commandBuffer(commandBuffer), renderPassDesc(desc) {
 
+    // Recording is timed from here to EndEncoding
+    RENDER_TRACE_BEGIN("Render Encoding");
+    if (commandBuffer->device->GetPerfCounters().IsOpen()) {
+        commandBuffer->device->GetPerfCounters().Begin();
+    }
+
     // Initialize member variables
     currentRenderPipelineState = nullptr;
     currentDepthStencilState = nullptr;
     currentVertexBuffer = nullptr;
 
-    // Add commands to handle the render pass setup
-    commands.push_back([this]() {
-        // Bind to default framebuffer (0) for the window
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // Handle color clear action
-        if (renderPassDesc.colorAttachments[0].loadAction == RenderPassDescriptor::ColorAttachment::LoadAction_Clear) {
-            glClearColor(
-                renderPassDesc.colorAttachments[0].clearColor[0],
-                renderPassDesc.colorAttachments[0].clearColor[1],
-                renderPassDesc.colorAttachments[0].clearColor[2],
-                renderPassDesc.colorAttachments[0].clearColor[3]
-            );
+    // The pass is timed from its barriers and clears to its last draw
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    commands.push_back([gpuTimer]() {
+        gpuTimer->Begin("Render Pass");
+    });
+
+    // Look up the render targets now so executing the pass is a single bind
+    GLuint framebuffer = commandBuffer->device->GetFramebuffer(desc);
+
+    // Every pass starts with the viewport covering its target: the attachments, or the drawable
+    // of the current window, so none inherits the viewport of the pass before it
+    int targetWidth = 0, targetHeight = 0;
+    for (int i = 0; i < desc.colorAttachmentCount && i < 8 && targetWidth == 0; i++) {
+        if (OpenGLTexture2D* texture = static_cast<OpenGLTexture2D*>(desc.colorAttachments[i].texture)) {
+            targetWidth = std::max(texture->width >> desc.colorAttachments[i].level, 1);
+            targetHeight = std::max(texture->height >> desc.colorAttachments[i].level, 1);
+        }
+    }
+    if (targetWidth == 0 && desc.depthAttachment.texture) {
+        OpenGLTexture2D* texture = static_cast<OpenGLTexture2D*>(desc.depthAttachment.texture);
+        targetWidth = std::max(texture->width >> desc.depthAttachment.level, 1);
+        targetHeight = std::max(texture->height >> desc.depthAttachment.level, 1);
+    }
+    if (framebuffer == 0 && targetWidth == 0) {
+        if (platform::PLATFORM_WINDOW_REF window = platform::GetCurrentPlatformWindow()) {
+            platform::GetPlatformWindowSize(window, targetWidth, targetHeight);
         }
+    }
+
+    // Attachments written through image stores by an earlier dispatch need a barrier first
+    GLbitfield barriers = 0;
+    for (int i = 0; i < desc.colorAttachmentCount && i < 8; i++) {
+        commandBuffer->RequireBarrier(desc.colorAttachments[i].texture, GL_FRAMEBUFFER_BARRIER_BIT, barriers);
+    }
+    commandBuffer->RequireBarrier(desc.depthAttachment.texture, GL_FRAMEBUFFER_BARRIER_BIT, barriers);
+    commandBuffer->InsertBarrier(barriers, commands);
 
-        // Handle depth clear action
-        if (renderPassDesc.depthAttachment.loadAction == RenderPassDescriptor::DepthAttachment::LoadAction_Clear) {
-            glClearDepth(renderPassDesc.depthAttachment.clearDepth);
+    commandBuffer->counters.renderPassCount++;
+
+    // Add commands to handle the render pass setup
+    RenderPassDescriptor passDesc = desc;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, passDesc, framebuffer, targetWidth, targetHeight]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+        if (targetWidth > 0) {
+            OGL_COUNTED(frame, glViewport(0, 0, targetWidth, targetHeight));
         }
 
-        // Perform the clear operation
-        GLbitfield clearMask = 0;
-        if (renderPassDesc.colorAttachments[0].loadAction == RenderPassDescriptor::ColorAttachment::LoadAction_Clear) {
-            clearMask |= GL_COLOR_BUFFER_BIT;
+        // Clears honor the depth write mask, which a depth/stencil state may have turned off
+        bool clearDepth = passDesc.depthAttachment.loadAction == RenderPassDescriptor::DepthAttachment::LoadAction_Clear;
+        GLboolean depthWriteMask = GL_TRUE;
+        if (clearDepth) {
+            OGL_COUNTED(frame, glGetBooleanv(GL_DEPTH_WRITEMASK, &depthWriteMask));
+            OGL_COUNTED(frame, glDepthMask(GL_TRUE));
         }
-        if (renderPassDesc.depthAttachment.loadAction == RenderPassDescriptor::DepthAttachment::LoadAction_Clear) {
-            clearMask |= GL_DEPTH_BUFFER_BIT;
+
+        if (framebuffer == 0) {
+            // Window: a single color buffer
+            GLbitfield clearMask = 0;
+            if (passDesc.colorAttachments[0].loadAction == RenderPassDescriptor::ColorAttachment::LoadAction_Clear) {
+                OGL_COUNTED(frame, glClearColor(
+                    passDesc.colorAttachments[0].clearColor[0],
+                    passDesc.colorAttachments[0].clearColor[1],
+                    passDesc.colorAttachments[0].clearColor[2],
+                    passDesc.colorAttachments[0].clearColor[3]
+                ));
+                clearMask |= GL_COLOR_BUFFER_BIT;
+            }
+            if (clearDepth) {
+                OGL_COUNTED(frame, glClearDepth(passDesc.depthAttachment.clearDepth));
+                clearMask |= GL_DEPTH_BUFFER_BIT;
+            }
+
+            if (clearMask != 0) {
+                OGL_COUNTED(frame, glClear(clearMask));
+            }
+        } else {
+            // Offscreen: each attachment clears on its own
+            for (int i = 0; i < passDesc.colorAttachmentCount && i < 8; i++) {
+                const RenderPassDescriptor::ColorAttachment& attachment = passDesc.colorAttachments[i];
+                if (attachment.texture && attachment.loadAction == RenderPassDescriptor::ColorAttachment::LoadAction_Clear) {
+                    OGL_COUNTED(frame, glClearBufferfv(GL_COLOR, i, attachment.clearColor));
+                }
+            }
+            if (clearDepth && passDesc.depthAttachment.texture) {
+                if (static_cast<OpenGLTexture2D*>(passDesc.depthAttachment.texture)->pixelFormat == PIXELFORMAT_DEPTH24_STENCIL8) {
+                    OGL_COUNTED(frame, glClearBufferfi(GL_DEPTH_STENCIL, 0, passDesc.depthAttachment.clearDepth, 0));
+                } else {
+                    OGL_COUNTED(frame, glClearBufferfv(GL_DEPTH, 0, &passDesc.depthAttachment.clearDepth));
+                }
+            }
         }
 
-        if (clearMask != 0) {
-            glClear(clearMask);
+        if (clearDepth) {
+            OGL_COUNTED(frame, glDepthMask(depthWriteMask));
         }
     });
 }
@@ -756,159 +2036,226 @@ OpenGLRenderCommandEncoder::~OpenGLRenderCommandEncoder() {}
 
 void OpenGLRenderCommandEncoder::SetRenderPipelineState(RenderPipelineState* renderPipelineState) {
 	currentRenderPipelineState = static_cast<OpenGLRenderPipelineState*>(renderPipelineState);
+	commandBuffer->counters.renderPipelineStateChangeCount++;
 
-	// Apply the pipeline state immediately
+	// Apply the pipeline state immediately; one still compiling is bound by the draws
 	if (currentRenderPipelineState) {
-		glUseProgram(currentRenderPipelineState->shaderProgram);
-		glBindVertexArray(currentRenderPipelineState->vertexArrayObject);
+		if (currentRenderPipelineState->IsReady()) {
+			OGL_COUNTED(commandBuffer->counters, glUseProgram(currentRenderPipelineState->shaderProgram));
+		}
+		OGL_COUNTED(commandBuffer->counters, glBindVertexArray(currentRenderPipelineState->vertexArrayObject));
 
 		// Apply raster state
 		if (currentRenderPipelineState->cullEnabled) {
-			glEnable(GL_CULL_FACE);
-			glFrontFace(currentRenderPipelineState->frontFace);
-			glCullFace(currentRenderPipelineState->cullFace);
+			OGL_COUNTED(commandBuffer->counters, glEnable(GL_CULL_FACE));
+			OGL_COUNTED(commandBuffer->counters, glFrontFace(currentRenderPipelineState->frontFace));
+			OGL_COUNTED(commandBuffer->counters, glCullFace(currentRenderPipelineState->cullFace));
 		} else {
-			glDisable(GL_CULL_FACE);
+			OGL_COUNTED(commandBuffer->counters, glDisable(GL_CULL_FACE));
 		}
-		glPolygonMode(GL_FRONT_AND_BACK, currentRenderPipelineState->polygonMode);
+		OGL_COUNTED(commandBuffer->counters, glPolygonMode(GL_FRONT_AND_BACK, currentRenderPipelineState->polygonMode));
 	}
 }
 
+void OpenGLRenderCommandEncoder::SetPendingPipelinePolicy(PendingPipelinePolicy policy, RenderPipelineState* fallbackPipelineState) {
+    pendingPipelinePolicy = policy;
+    this->fallbackPipelineState = static_cast<OpenGLRenderPipelineState*>(fallbackPipelineState);
+}
+
+OpenGLRenderPipelineState* OpenGLRenderCommandEncoder::GetDrawPipelineState() {
+    if (!currentRenderPipelineState || currentRenderPipelineState->IsReady()) {
+        return currentRenderPipelineState;
+    }
+
+    if (currentRenderPipelineState->fallback) {
+        currentRenderPipelineState->fallback->Wait();
+        return currentRenderPipelineState->fallback;
+    }
+
+    switch (pendingPipelinePolicy) {
+        case PENDINGPIPELINEPOLICY_SKIP:
+            return nullptr;
+        case PENDINGPIPELINEPOLICY_FALLBACK:
+            if (fallbackPipelineState) {
+                fallbackPipelineState->Wait();
+                return fallbackPipelineState;
+            }
+            return nullptr;
+        default:
+            currentRenderPipelineState->Wait();
+            return currentRenderPipelineState;
+    }
+}
+
 void OpenGLRenderCommandEncoder::SetDepthStencilState(DepthStencilState* depthStencilState) {
     currentDepthStencilState = static_cast<OpenGLDepthStencilState*>(depthStencilState);
+    commandBuffer->counters.depthStencilStateChangeCount++;
     // Apply depth stencil state immediately
     if (currentDepthStencilState) {
         if (currentDepthStencilState->depthEnabled)
-            glEnable(GL_DEPTH_TEST);
+            OGL_COUNTED(commandBuffer->counters, glEnable(GL_DEPTH_TEST));
         else
-            glDisable(GL_DEPTH_TEST);
-        glDepthFunc(currentDepthStencilState->depthFunc);
-        glDepthMask(currentDepthStencilState->depthWriteEnabled ? GL_TRUE : GL_FALSE);
-        glDepthRange(currentDepthStencilState->depthNear, currentDepthStencilState->depthFar);
+            OGL_COUNTED(commandBuffer->counters, glDisable(GL_DEPTH_TEST));
+        OGL_COUNTED(commandBuffer->counters, glDepthFunc(currentDepthStencilState->depthFunc));
+        OGL_COUNTED(commandBuffer->counters, glDepthMask(currentDepthStencilState->depthWriteEnabled ? GL_TRUE : GL_FALSE));
+        OGL_COUNTED(commandBuffer->counters, glDepthRange(currentDepthStencilState->depthNear, currentDepthStencilState->depthFar));
 
         if (currentDepthStencilState->frontFaceStencilEnabled || currentDepthStencilState->backFaceStencilEnabled)
-            glEnable(GL_STENCIL_TEST);
+            OGL_COUNTED(commandBuffer->counters, glEnable(GL_STENCIL_TEST));
         else
-            glDisable(GL_STENCIL_TEST);
+            OGL_COUNTED(commandBuffer->counters, glDisable(GL_STENCIL_TEST));
 
         // front face
-        glStencilFuncSeparate(GL_FRONT, currentDepthStencilState->frontStencilFunc, currentDepthStencilState->frontFaceRef, currentDepthStencilState->frontFaceReadMask);
-        glStencilMaskSeparate(GL_FRONT, currentDepthStencilState->frontFaceWriteMask);
-        glStencilOpSeparate(GL_FRONT, currentDepthStencilState->frontFaceStencilFail, currentDepthStencilState->frontFaceDepthFail, currentDepthStencilState->frontFaceStencilPass);
+        OGL_COUNTED(commandBuffer->counters, glStencilFuncSeparate(GL_FRONT, currentDepthStencilState->frontStencilFunc, currentDepthStencilState->frontFaceRef, currentDepthStencilState->frontFaceReadMask));
+        OGL_COUNTED(commandBuffer->counters, glStencilMaskSeparate(GL_FRONT, currentDepthStencilState->frontFaceWriteMask));
+        OGL_COUNTED(commandBuffer->counters, glStencilOpSeparate(GL_FRONT, currentDepthStencilState->frontFaceStencilFail, currentDepthStencilState->frontFaceDepthFail, currentDepthStencilState->frontFaceStencilPass));
 
         // back face
-        glStencilFuncSeparate(GL_BACK, currentDepthStencilState->backStencilFunc, currentDepthStencilState->backFaceRef, currentDepthStencilState->backFaceReadMask);
-        glStencilMaskSeparate(GL_BACK, currentDepthStencilState->backFaceWriteMask);
-        glStencilOpSeparate(GL_BACK, currentDepthStencilState->backFaceStencilFail, currentDepthStencilState->backFaceDepthFail, currentDepthStencilState->backFaceStencilPass);
+        OGL_COUNTED(commandBuffer->counters, glStencilFuncSeparate(GL_BACK, currentDepthStencilState->backStencilFunc, currentDepthStencilState->backFaceRef, currentDepthStencilState->backFaceReadMask));
+        OGL_COUNTED(commandBuffer->counters, glStencilMaskSeparate(GL_BACK, currentDepthStencilState->backFaceWriteMask));
+        OGL_COUNTED(commandBuffer->counters, glStencilOpSeparate(GL_BACK, currentDepthStencilState->backFaceStencilFail, currentDepthStencilState->backFaceDepthFail, currentDepthStencilState->backFaceStencilPass));
     }
 }
 
 void OpenGLRenderCommandEncoder::SetVertexBuffer(Buffer* buffer, unsigned int offset, unsigned int index) {
     currentVertexBuffer = buffer;
+    commandBuffer->counters.vertexBufferChangeCount++;
     // Don't execute OpenGL calls here - let the draw commands handle it
 }
 
 void OpenGLRenderCommandEncoder::SetTexture2D(Texture2D* texture, unsigned int index) {
     boundTextures[index] = texture;
-    commands.push_back([texture, index]() {
+    commandBuffer->counters.textureChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, texture, index]() {
+        FrameCounters& frame = device->GetFrameCounters();
         if (texture) {
             OpenGLTexture2D* oglTexture = static_cast<OpenGLTexture2D*>(texture);
-            glActiveTexture(GL_TEXTURE0 + index);
-            glBindTexture(GL_TEXTURE_2D, oglTexture->texture);
+            OGL_COUNTED(frame, glActiveTexture(GL_TEXTURE0 + index));
+            OGL_COUNTED(frame, glBindTexture(GL_TEXTURE_2D, oglTexture->texture));
         } else {
-            glActiveTexture(GL_TEXTURE0 + index);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            OGL_COUNTED(frame, glActiveTexture(GL_TEXTURE0 + index));
+            OGL_COUNTED(frame, glBindTexture(GL_TEXTURE_2D, 0));
         }
     });
 }
 
 void OpenGLRenderCommandEncoder::SetSamplerState(SamplerState* sampler, unsigned int index) {
     boundSamplers[index] = sampler;
-    commands.push_back([sampler, index]() {
+    commandBuffer->counters.samplerChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, sampler, index]() {
+        FrameCounters& frame = device->GetFrameCounters();
         if (sampler) {
             OpenGLSamplerState* oglSampler = static_cast<OpenGLSamplerState*>(sampler);
-            glBindSampler(index, oglSampler->sampler);
+            OGL_COUNTED(frame, glBindSampler(index, oglSampler->sampler));
         } else {
-            glBindSampler(index, 0);
+            OGL_COUNTED(frame, glBindSampler(index, 0));
         }
     });
 }
 
 void OpenGLRenderCommandEncoder::SetVertexBytes(const void* data, size_t size, unsigned int index) {
     vertexBytes[index] = std::make_pair(data, size);
+    // Copy the bytes now so the caller's memory does not need to outlive the encoder
+    std::vector<char> bytes(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    commandBuffer->counters.commandBytes += size;
     // For OpenGL, we'll handle this in the draw commands by creating a temporary buffer
-    commands.push_back([this, data, size, index]() {
+    commands.push_back([this, bytes, index]() {
         if (currentRenderPipelineState) {
-            glUseProgram(currentRenderPipelineState->shaderProgram);
+            FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+            if (OpenGLRenderPipelineState* pipelineState = GetDrawPipelineState()) {
+                OGL_COUNTED(frame, glUseProgram(pipelineState->shaderProgram));
+            }
 
             // Create a temporary uniform buffer for the data
             GLuint ubo;
-            glGenBuffers(1, &ubo);
-            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-            glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
-            glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo);
+            OGL_COUNTED(frame, glGenBuffers(1, &ubo));
+            OGL_COUNTED(frame, glBindBuffer(GL_UNIFORM_BUFFER, ubo));
+            OGL_COUNTED(frame, glBufferData(GL_UNIFORM_BUFFER, bytes.size(), bytes.data(), GL_DYNAMIC_DRAW));
+            OGL_COUNTED(frame, glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo));
 
             // Debug: Check for OpenGL errors
-            GLenum error = glGetError();
+            GLenum error = OGL_COUNTED(frame, glGetError());
             if (error != GL_NO_ERROR) {
                 printf("OpenGL error in SetVertexBytes (index %d): %d\n", index, error);
             }
 
-            // Do not delete the UBO immediately; store for deferred deletion
-            tempVertexUBOs.push_back(ubo);
+            // Deleted once the command buffer has executed
+            commandBuffer->tempBuffers.push_back(ubo);
+
+            frame.uniformBufferCount++;
+            frame.uniformBytesUploaded += bytes.size();
         }
     });
 }
 
 void OpenGLRenderCommandEncoder::SetFragmentBytes(const void* data, size_t size, unsigned int index) {
     fragmentBytes[index] = std::make_pair(data, size);
+    // Copy the bytes now so the caller's memory does not need to outlive the encoder
+    std::vector<char> bytes(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    commandBuffer->counters.commandBytes += size;
     // For OpenGL, we'll handle this in the draw commands by creating a temporary buffer
-    commands.push_back([this, data, size, index]() {
+    commands.push_back([this, bytes, index]() {
         if (currentRenderPipelineState) {
-            glUseProgram(currentRenderPipelineState->shaderProgram);
+            FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+            if (OpenGLRenderPipelineState* pipelineState = GetDrawPipelineState()) {
+                OGL_COUNTED(frame, glUseProgram(pipelineState->shaderProgram));
+            }
 
             // Create a temporary uniform buffer for the data
             GLuint ubo;
-            glGenBuffers(1, &ubo);
-            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-            glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
-            glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo);
+            OGL_COUNTED(frame, glGenBuffers(1, &ubo));
+            OGL_COUNTED(frame, glBindBuffer(GL_UNIFORM_BUFFER, ubo));
+            OGL_COUNTED(frame, glBufferData(GL_UNIFORM_BUFFER, bytes.size(), bytes.data(), GL_DYNAMIC_DRAW));
+            OGL_COUNTED(frame, glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo));
 
             // Debug: Check for OpenGL errors
-            GLenum error = glGetError();
+            GLenum error = OGL_COUNTED(frame, glGetError());
             if (error != GL_NO_ERROR) {
-                printf("OpenGL error in SetVertexBytes (index %d): %d\n", index, error);
+                printf("OpenGL error in SetFragmentBytes (index %d): %d\n", index, error);
             }
 
-            // Do not delete the UBO immediately; store for deferred deletion
-            tempFragmentUBOs.push_back(ubo);
+            // Deleted once the command buffer has executed
+            commandBuffer->tempBuffers.push_back(ubo);
+
+            frame.uniformBufferCount++;
+            frame.uniformBytesUploaded += bytes.size();
         }
     });
 }
 
 void OpenGLRenderCommandEncoder::Draw(PrimitiveType primitiveType, unsigned int vertexStart, unsigned int vertexCount) {
+    InsertDrawBarriers(nullptr);
     commands.push_back([this, primitiveType, vertexStart, vertexCount]() {
+        FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+
+        // A pipeline state still compiling is waited for, skipped or stood in for
+        OpenGLRenderPipelineState* pipelineState = GetDrawPipelineState();
+        if (currentRenderPipelineState && !pipelineState) {
+            return;
+        }
 
-        if (currentRenderPipelineState && currentVertexBuffer) {
-            OpenGLVertexDescriptor* vertexDescriptor = currentRenderPipelineState->vertexDescriptor;
+        if (pipelineState && currentVertexBuffer) {
+            OpenGLVertexDescriptor* vertexDescriptor = pipelineState->vertexDescriptor;
             OpenGLBuffer* oglBuffer = static_cast<OpenGLBuffer*>(currentVertexBuffer);
 
             // Set up pipeline and VAO
-            glUseProgram(currentRenderPipelineState->shaderProgram);
-            glBindVertexArray(currentRenderPipelineState->vertexArrayObject);
+            OGL_COUNTED(frame, glUseProgram(pipelineState->shaderProgram));
+            OGL_COUNTED(frame, glBindVertexArray(pipelineState->vertexArrayObject));
 
             // Bind vertex buffer
-            glBindBuffer(GL_ARRAY_BUFFER, oglBuffer->BO);
+            OGL_COUNTED(frame, glBindBuffer(GL_ARRAY_BUFFER, oglBuffer->BO));
 
             // Set up vertex attributes
             for(unsigned int j = 0; j < vertexDescriptor->numVertexAttributes; j++) {
-                glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index);
-                glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
+                OGL_COUNTED(frame, glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index));
+                OGL_COUNTED(frame, glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
                                       vertexDescriptor->openGLVertexAttributes[j].size,
                                       vertexDescriptor->openGLVertexAttributes[j].type,
                                       vertexDescriptor->openGLVertexAttributes[j].normalized,
                                       vertexDescriptor->openGLVertexAttributes[j].stride,
-                                      vertexDescriptor->openGLVertexAttributes[j].pointer);
+                                      vertexDescriptor->openGLVertexAttributes[j].pointer));
             }
         }
 
@@ -921,40 +2268,51 @@ void OpenGLRenderCommandEncoder::Draw(PrimitiveType primitiveType, unsigned int
             case PRIMITIVETYPE_TRIANGLESTRIP: mode = GL_TRIANGLE_STRIP; break;
             default: assert(false); break;
         }
-        glDrawArrays(mode, vertexStart, vertexCount);
+        OGL_COUNTED(frame, glDrawArrays(mode, vertexStart, vertexCount));
 
         // Check for OpenGL errors
-        GLenum error = glGetError();
+        GLenum error = OGL_COUNTED(frame, glGetError());
         if (error != GL_NO_ERROR) {
             printf("OpenGL error in Draw: %d\n", error);
         }
+
+        CountDraw(frame, primitiveType, vertexCount, 1);
     });
 }
 
 void OpenGLRenderCommandEncoder::DrawIndexed(PrimitiveType primitiveType, unsigned int indexCount, IndexType indexType, unsigned int indexOffset, unsigned int vertexOffset, Buffer* indexBuffer) {
+    InsertDrawBarriers(indexBuffer);
     commands.push_back([this, primitiveType, indexCount, indexType, indexOffset, vertexOffset, indexBuffer]() {
-        if (currentRenderPipelineState && currentVertexBuffer && indexBuffer) {
-            OpenGLVertexDescriptor* vertexDescriptor = currentRenderPipelineState->vertexDescriptor;
+        FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+
+        // A pipeline state still compiling is waited for, skipped or stood in for
+        OpenGLRenderPipelineState* pipelineState = GetDrawPipelineState();
+        if (currentRenderPipelineState && !pipelineState) {
+            return;
+        }
+
+        if (pipelineState && currentVertexBuffer && indexBuffer) {
+            OpenGLVertexDescriptor* vertexDescriptor = pipelineState->vertexDescriptor;
             OpenGLBuffer* oglBuffer = static_cast<OpenGLBuffer*>(currentVertexBuffer);
             OpenGLBuffer* oglIndexBuffer = static_cast<OpenGLBuffer*>(indexBuffer);
 
             // Set up pipeline and VAO
-            glUseProgram(currentRenderPipelineState->shaderProgram);
-            glBindVertexArray(currentRenderPipelineState->vertexArrayObject);
+            OGL_COUNTED(frame, glUseProgram(pipelineState->shaderProgram));
+            OGL_COUNTED(frame, glBindVertexArray(pipelineState->vertexArrayObject));
 
             // Bind buffers
-            glBindBuffer(GL_ARRAY_BUFFER, oglBuffer->BO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oglIndexBuffer->BO);
+            OGL_COUNTED(frame, glBindBuffer(GL_ARRAY_BUFFER, oglBuffer->BO));
+            OGL_COUNTED(frame, glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oglIndexBuffer->BO));
 
             // Set up vertex attributes
             for(unsigned int j = 0; j < vertexDescriptor->numVertexAttributes; j++) {
-                glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index);
-                glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
+                OGL_COUNTED(frame, glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index));
+                OGL_COUNTED(frame, glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
                                       vertexDescriptor->openGLVertexAttributes[j].size,
                                       vertexDescriptor->openGLVertexAttributes[j].type,
                                       vertexDescriptor->openGLVertexAttributes[j].normalized,
                                       vertexDescriptor->openGLVertexAttributes[j].stride,
-                                      vertexDescriptor->openGLVertexAttributes[j].pointer);
+                                      vertexDescriptor->openGLVertexAttributes[j].pointer));
             }
         }
 
@@ -970,31 +2328,140 @@ void OpenGLRenderCommandEncoder::DrawIndexed(PrimitiveType primitiveType, unsign
 
         GLenum type = (indexType == INDEXTYPE_UINT16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
         size_t offsetBytes = indexOffset * (indexType == INDEXTYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
-        glDrawElementsBaseVertex(mode, indexCount, type, reinterpret_cast<const void*>(offsetBytes), vertexOffset);
+        OGL_COUNTED(frame, glDrawElementsBaseVertex(mode, indexCount, type, reinterpret_cast<const void*>(offsetBytes), vertexOffset));
 
         // Check for OpenGL errors
-        GLenum error = glGetError();
+        GLenum error = OGL_COUNTED(frame, glGetError());
         if (error != GL_NO_ERROR) {
             printf("OpenGL error in DrawIndexed: %d\n", error);
         }
+
+        CountDraw(frame, primitiveType, indexCount, 1);
+    });
+}
+
+void OpenGLRenderCommandEncoder::DrawIndexedIndirect(PrimitiveType primitiveType, IndexType indexType, Buffer* indexBuffer, Buffer* indirectBuffer, unsigned int indirectBufferOffset, unsigned int maxDrawCount, Buffer* drawCountBuffer, unsigned int drawCountBufferOffset) {
+    InsertDrawBarriers(indexBuffer, indirectBuffer, drawCountBuffer);
+    commands.push_back([this, primitiveType, indexType, indexBuffer, indirectBuffer, indirectBufferOffset, maxDrawCount, drawCountBuffer, drawCountBufferOffset]() {
+        FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+
+        // A pipeline state still compiling is waited for, skipped or stood in for
+        OpenGLRenderPipelineState* pipelineState = GetDrawPipelineState();
+        if (currentRenderPipelineState && !pipelineState) {
+            return;
+        }
+
+        if (pipelineState && currentVertexBuffer && indexBuffer && indirectBuffer) {
+            OpenGLVertexDescriptor* vertexDescriptor = pipelineState->vertexDescriptor;
+            OpenGLBuffer* oglBuffer = static_cast<OpenGLBuffer*>(currentVertexBuffer);
+            OpenGLBuffer* oglIndexBuffer = static_cast<OpenGLBuffer*>(indexBuffer);
+
+            // Set up pipeline and VAO
+            OGL_COUNTED(frame, glUseProgram(pipelineState->shaderProgram));
+            OGL_COUNTED(frame, glBindVertexArray(pipelineState->vertexArrayObject));
+
+            // Bind buffers
+            OGL_COUNTED(frame, glBindBuffer(GL_ARRAY_BUFFER, oglBuffer->BO));
+            OGL_COUNTED(frame, glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oglIndexBuffer->BO));
+            OGL_COUNTED(frame, glBindBuffer(GL_DRAW_INDIRECT_BUFFER, static_cast<OpenGLBuffer*>(indirectBuffer)->BO));
+
+            // Set up vertex attributes
+            for(unsigned int j = 0; j < vertexDescriptor->numVertexAttributes; j++) {
+                OGL_COUNTED(frame, glEnableVertexAttribArray(vertexDescriptor->openGLVertexAttributes[j].index));
+                OGL_COUNTED(frame, glVertexAttribPointer(vertexDescriptor->openGLVertexAttributes[j].index,
+                                      vertexDescriptor->openGLVertexAttributes[j].size,
+                                      vertexDescriptor->openGLVertexAttributes[j].type,
+                                      vertexDescriptor->openGLVertexAttributes[j].normalized,
+                                      vertexDescriptor->openGLVertexAttributes[j].stride,
+                                      vertexDescriptor->openGLVertexAttributes[j].pointer));
+            }
+        }
+
+        GLenum mode;
+        switch (primitiveType) {
+            case PRIMITIVETYPE_POINT: mode = GL_POINTS; break;
+            case PRIMITIVETYPE_LINE: mode = GL_LINES; break;
+            case PRIMITIVETYPE_LINESTRIP: mode = GL_LINE_STRIP; break;
+            case PRIMITIVETYPE_TRIANGLE: mode = GL_TRIANGLES; break;
+            case PRIMITIVETYPE_TRIANGLESTRIP: mode = GL_TRIANGLE_STRIP; break;
+            default: assert(false); break;
+        }
+
+        GLenum type = (indexType == INDEXTYPE_UINT16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        const void* indirect = reinterpret_cast<const void*>(static_cast<size_t>(indirectBufferOffset));
+        bool countFromBuffer = drawCountBuffer && commandBuffer->device->IsIndirectCountSupported();
+        if (countFromBuffer) {
+            // The draw count is sourced from the GPU, so culled draws cost nothing
+            OGL_COUNTED(frame, glBindBuffer(GL_PARAMETER_BUFFER, static_cast<OpenGLBuffer*>(drawCountBuffer)->BO));
+            OGL_COUNTED(frame, glMultiDrawElementsIndirectCount(mode, type, indirect, static_cast<GLintptr>(drawCountBufferOffset), maxDrawCount, sizeof(DrawIndexedIndirectArguments)));
+            OGL_COUNTED(frame, glBindBuffer(GL_PARAMETER_BUFFER, 0));
+        } else {
+            OGL_COUNTED(frame, glMultiDrawElementsIndirect(mode, type, indirect, maxDrawCount, sizeof(DrawIndexedIndirectArguments)));
+        }
+        OGL_COUNTED(frame, glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+
+        // Check for OpenGL errors
+        GLenum error = OGL_COUNTED(frame, glGetError());
+        if (error != GL_NO_ERROR) {
+            printf("OpenGL error in DrawIndexedIndirect: %d\n", error);
+        }
+
+        // The draws and their instances are written by the GPU, so only the most there can be is known
+        frame.drawCount += maxDrawCount;
+    });
+}
+
+void OpenGLRenderCommandEncoder::InsertDrawBarriers(Buffer* indexBuffer, Buffer* indirectBuffer, Buffer* drawCountBuffer) {
+    GLbitfield barriers = 0;
+    commandBuffer->RequireBarrier(currentVertexBuffer, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT, barriers);
+    commandBuffer->RequireBarrier(indexBuffer, GL_ELEMENT_ARRAY_BARRIER_BIT, barriers);
+    commandBuffer->RequireBarrier(indirectBuffer, GL_COMMAND_BARRIER_BIT, barriers);
+    commandBuffer->RequireBarrier(drawCountBuffer, GL_COMMAND_BARRIER_BIT, barriers);
+    for (auto& binding : boundTextures) {
+        commandBuffer->RequireBarrier(binding.second, GL_TEXTURE_FETCH_BARRIER_BIT, barriers);
+    }
+    commandBuffer->InsertBarrier(barriers, commands);
+}
+
+void OpenGLRenderCommandEncoder::PushDebugGroup(const char* name) {
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    std::string groupName = name;
+    debugGroupDepth++;
+    commands.push_back([gpuTimer, groupName]() {
+        gpuTimer->Begin(groupName);
+    });
+}
+
+void OpenGLRenderCommandEncoder::PopDebugGroup() {
+    if (debugGroupDepth == 0) {
+        return;
+    }
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    debugGroupDepth--;
+    commands.push_back([gpuTimer]() {
+        gpuTimer->End();
     });
 }
 
 void OpenGLRenderCommandEncoder::EndEncoding() {
+    // Close the groups left open, then the pass
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    unsigned int zoneCount = debugGroupDepth + 1;
+    debugGroupDepth = 0;
+    commands.push_back([gpuTimer, zoneCount]() {
+        for (unsigned int i = 0; i < zoneCount; i++) {
+            gpuTimer->End();
+        }
+    });
+
     // Transfer all commands to the command buffer
     commandBuffer->commands.insert(commandBuffer->commands.end(), commands.begin(), commands.end());
     commands.clear();
-    // Clean up temporary vertex UBOs
-    for (GLuint ubo : tempVertexUBOs) {
-        glDeleteBuffers(1, &ubo);
-    }
-    tempVertexUBOs.clear();
 
-    // Clean up temporary fragment UBOs
-    for (GLuint ubo : tempFragmentUBOs) {
-        glDeleteBuffers(1, &ubo);
+    if (commandBuffer->device->GetPerfCounters().IsOpen()) {
+        commandBuffer->device->GetPerfCounters().End(commandBuffer->device->GetFrameCounters());
     }
-    tempFragmentUBOs.clear();
+    RENDER_TRACE_END();
 }
 
 // Add the new methods to OpenGLRenderDevice
@@ -1006,9 +2473,218 @@ void OpenGLRenderDevice::DestroyCommandQueue(CommandQueue* queue) {
     delete static_cast<OpenGLCommandQueue*>(queue);
 }
 
+bool OpenGLFramebufferKey::operator==(const OpenGLFramebufferKey& other) const {
+    return memcmp(colorTextures, other.colorTextures, sizeof(colorTextures)) == 0 &&
+        memcmp(colorLevels, other.colorLevels, sizeof(colorLevels)) == 0 &&
+        depthTexture == other.depthTexture && depthLevel == other.depthLevel;
+}
+
+bool OpenGLFramebufferKey::References(GLuint texture) const {
+    for (GLuint colorTexture : colorTextures) {
+        if (colorTexture == texture) {
+            return true;
+        }
+    }
+    return depthTexture == texture;
+}
+
+size_t OpenGLFramebufferKeyHash::operator()(const OpenGLFramebufferKey& key) const {
+    // FNV-1a over the texture names and levels
+    size_t hash = 2166136261u;
+    auto combine = [&hash](unsigned int value) {
+        hash = (hash ^ value) * 16777619u;
+    };
+    for (int i = 0; i < 8; i++) {
+        combine(key.colorTextures[i]);
+        combine(static_cast<unsigned int>(key.colorLevels[i]));
+    }
+    combine(key.depthTexture);
+    combine(static_cast<unsigned int>(key.depthLevel));
+    return hash;
+}
+
+GLuint OpenGLRenderDevice::GetFramebuffer(const RenderPassDescriptor& desc) {
+    OpenGLFramebufferKey key;
+    bool hasAttachments = false;
+    for (int i = 0; i < desc.colorAttachmentCount && i < 8; i++) {
+        OpenGLTexture2D* texture = static_cast<OpenGLTexture2D*>(desc.colorAttachments[i].texture);
+        if (texture) {
+            key.colorTextures[i] = texture->texture;
+            key.colorLevels[i] = desc.colorAttachments[i].level;
+            hasAttachments = true;
+        }
+    }
+    OpenGLTexture2D* depthTexture = static_cast<OpenGLTexture2D*>(desc.depthAttachment.texture);
+    if (depthTexture) {
+        key.depthTexture = depthTexture->texture;
+        key.depthLevel = desc.depthAttachment.level;
+        hasAttachments = true;
+    }
+
+    if (!hasAttachments) {
+        return 0;
+    }
+
+    auto it = m_Framebuffers.find(key);
+    if (it != m_Framebuffers.end()) {
+        return it->second;
+    }
+
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // draw buffers are framebuffer state, so they are set once here rather than every pass
+    GLenum drawBuffers[8];
+    GLsizei drawBufferCount = 0;
+    for (int i = 0; i < 8; i++) {
+        if (key.colorTextures[i]) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, key.colorTextures[i], key.colorLevels[i]);
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+            drawBufferCount = i + 1;
+        } else {
+            drawBuffers[i] = GL_NONE;
+        }
+    }
+    if (drawBufferCount > 0) {
+        glDrawBuffers(drawBufferCount, drawBuffers);
+    } else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    if (depthTexture) {
+        GLenum attachment = depthTexture->pixelFormat == PIXELFORMAT_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, key.depthTexture, key.depthLevel);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE\n" << std::hex << status << std::dec << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_Framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
 Drawable* OpenGLRenderDevice::GetNextDrawable() {
-    // For default framebuffer, pass nullptr for texture and the GLFWwindow* for window
-    return new OpenGLDrawable(nullptr, glfwGetCurrentContext());
+    platform::PLATFORM_WINDOW_REF window = platform::GetCurrentPlatformWindow();
+    if (!window) {
+        std::cout << "ERROR::DRAWABLE::NO_CURRENT_WINDOW" << std::endl;
+        return nullptr;
+    }
+    if (platform::GetPlatformType() != platform::PLATFORMTYPE_HEADLESS) {
+        // For default framebuffer, pass nullptr for texture
+        return new OpenGLDrawable(nullptr, window);
+    }
+
+    // Headless windows have no default framebuffer, so each renders into a texture of its size,
+    // kept across frames and replaced when the size changes
+    int width = 0, height = 0;
+    platform::GetPlatformWindowSize(window, width, height);
+    if (width <= 0 || height <= 0) {
+        std::cout << "ERROR::DRAWABLE::EMPTY_WINDOW " << width << "x" << height << std::endl;
+        return nullptr;
+    }
+    OpenGLTexture2D*& texture = m_DrawableTextures[window];
+    if (!texture || texture->width != width || texture->height != height) {
+        DestroyTexture2D(texture);
+        texture = new OpenGLTexture2D(width, height, PIXELFORMAT_RGBA8_UNORM, 1);
+    }
+    return new OpenGLDrawable(texture, window);
+}
+
+PixelReadback* OpenGLRenderDevice::ReadPixelsAsync(Texture2D* texture, int x, int y, int width, int height, PixelFormat pixelFormat) {
+    // Read through the cached framebuffer the texture renders into
+    OpenGLTexture2D* oglTexture = static_cast<OpenGLTexture2D*>(texture);
+    bool isDepth = oglTexture->pixelFormat == PIXELFORMAT_DEPTH32_FLOAT || oglTexture->pixelFormat == PIXELFORMAT_DEPTH24_STENCIL8;
+    RenderPassDescriptor desc;
+    if (isDepth) {
+        // A depth-only framebuffer has no color to convert, so depth is read as it is stored
+        pixelFormat = oglTexture->pixelFormat;
+        desc.depthAttachment.texture = texture;
+    } else if (pixelFormat == PIXELFORMAT_DEPTH32_FLOAT || pixelFormat == PIXELFORMAT_DEPTH24_STENCIL8) {
+        std::cout << "ERROR::READBACK::DEPTH_FORMAT_OF_COLOR_TEXTURE" << std::endl;
+        return nullptr;
+    } else {
+        desc.colorAttachments[0].texture = texture;
+    }
+    // Image stores of earlier command buffers are made visible here; textures nothing wrote
+    // that way need no barrier, which contexts below OpenGL 4.2 cannot issue
+    auto pending = m_PendingBarriers.find(texture);
+    if (pending != m_PendingBarriers.end() && (pending->second & GL_FRAMEBUFFER_BARRIER_BIT)) {
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        for (auto it = m_PendingBarriers.begin(); it != m_PendingBarriers.end(); ) {
+            it->second &= ~GL_FRAMEBUFFER_BARRIER_BIT;
+            if (it->second == 0) {
+                it = m_PendingBarriers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return ReadFramebufferAsync(GetFramebuffer(desc), isDepth ? GL_NONE : GL_COLOR_ATTACHMENT0, x, y, width, height, pixelFormat);
+}
+
+PixelReadback* OpenGLRenderDevice::ReadPixelsAsync(Drawable* drawable, int x, int y, int width, int height, PixelFormat pixelFormat) {
+    if (Texture2D* texture = drawable->GetTexture()) {
+        return ReadPixelsAsync(texture, x, y, width, height, pixelFormat);
+    }
+    return ReadFramebufferAsync(0, GL_BACK, x, y, width, height, pixelFormat);
+}
+
+void OpenGLRenderDevice::DestroyPixelReadback(PixelReadback* pixelReadback) {
+    if (pixelReadback) {
+        static_cast<OpenGLPixelReadback*>(pixelReadback)->Release();
+    }
+}
+
+PixelReadback* OpenGLRenderDevice::ReadFramebufferAsync(GLuint framebuffer, GLenum readBuffer, int x, int y, int width, int height, PixelFormat pixelFormat) {
+    // Take the next free slot of the ring, growing it only while every slot is still held by the caller
+    OpenGLPixelReadback* readback = nullptr;
+    for (size_t i = 0; i < m_PixelReadbacks.size() && !readback; i++) {
+        OpenGLPixelReadback* candidate = m_PixelReadbacks[(m_NextPixelReadback + i) % m_PixelReadbacks.size()];
+        if (!candidate->inUse) {
+            readback = candidate;
+        }
+    }
+    if (!readback) {
+        readback = new OpenGLPixelReadback;
+        glGenBuffers(1, &readback->buffer);
+        m_PixelReadbacks.push_back(readback);
+    }
+    m_NextPixelReadback = (std::find(m_PixelReadbacks.begin(), m_PixelReadbacks.end(), readback) - m_PixelReadbacks.begin() + 1) % m_PixelReadbacks.size();
+
+    readback->inUse = true;
+    readback->width = width;
+    readback->height = height;
+    readback->pixelFormat = pixelFormat;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+    if (readback->capacity < readback->GetByteSize()) {
+        readback->capacity = readback->GetByteSize();
+        glBufferData(GL_PIXEL_PACK_BUFFER, readback->capacity, nullptr, GL_STREAM_READ);
+    }
+
+    // With a pack buffer bound, glReadPixels queues the copy and returns without waiting for it
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(readBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, width, height, pixel_format_map[pixelFormat], pixel_type_map[pixelFormat], nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        printf("OpenGL error in ReadPixelsAsync: %d\n", error);
+    }
+
+    return readback;
 }
 
 void OpenGLRenderDevice::DestroyDrawable(Drawable* drawable) {
@@ -1017,8 +2693,11 @@ void OpenGLRenderDevice::DestroyDrawable(Drawable* drawable) {
 }
 
 void OpenGLRenderCommandEncoder::SetViewport(int x, int y, int width, int height) {
-    commands.push_back([x, y, width, height]() {
-        glViewport(x, y, width, height);
+    commandBuffer->counters.viewportChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, x, y, width, height]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glViewport(x, y, width, height));
     });
 }
 
@@ -1028,10 +2707,9 @@ void OpenGLDrawable::GetSize(int& width, int& height) {
         width = texture->width;
         height = texture->height;
     } else {
-        // For default framebuffer (window), get the window size from GLFW
-        GLFWwindow* window = glfwGetCurrentContext();
+        // For default framebuffer (window), get the window size from the platform
         if (window) {
-            glfwGetFramebufferSize(window, &width, &height);
+            platform::GetPlatformWindowSize(window, width, height);
         } else {
             width = 800;  // fallback
             height = 600; // fallback
@@ -1039,4 +2717,196 @@ void OpenGLDrawable::GetSize(int& width, int& height) {
     }
 }
 
+OpenGLComputeCommandEncoder::OpenGLComputeCommandEncoder(OpenGLCommandBuffer* commandBuffer)
+    : commandBuffer(commandBuffer) {
+    // Recording is timed from here to EndEncoding
+    RENDER_TRACE_BEGIN("Compute Encoding");
+    if (commandBuffer->device->GetPerfCounters().IsOpen()) {
+        commandBuffer->device->GetPerfCounters().Begin();
+    }
+    commandBuffer->counters.computePassCount++;
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    commands.push_back([gpuTimer]() {
+        gpuTimer->Begin("Compute Pass");
+    });
+}
+
+OpenGLComputeCommandEncoder::~OpenGLComputeCommandEncoder() {}
+
+void OpenGLComputeCommandEncoder::SetComputePipelineState(ComputePipelineState* computePipelineState) {
+    currentComputePipelineState = static_cast<OpenGLComputePipelineState*>(computePipelineState);
+    commandBuffer->counters.computePipelineStateChangeCount++;
+    GLuint shaderProgram = currentComputePipelineState ? currentComputePipelineState->shaderProgram : 0;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, shaderProgram]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glUseProgram(shaderProgram));
+    });
+}
+
+void OpenGLComputeCommandEncoder::SetBuffer(Buffer* buffer, unsigned int offset, unsigned int index) {
+    boundBuffers[index] = buffer;
+    commandBuffer->counters.storageBufferChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, buffer, offset, index]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        if (buffer) {
+            OpenGLBuffer* oglBuffer = static_cast<OpenGLBuffer*>(buffer);
+            if (offset == 0) {
+                OGL_COUNTED(frame, glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, oglBuffer->BO));
+            } else {
+                OGL_COUNTED(frame, glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, oglBuffer->BO, offset, oglBuffer->size - offset));
+            }
+        } else {
+            OGL_COUNTED(frame, glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, 0));
+        }
+    });
+}
+
+void OpenGLComputeCommandEncoder::SetTexture(Texture2D* texture, unsigned int index) {
+    boundTextures[index] = texture;
+    commandBuffer->counters.textureChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, texture, index]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glActiveTexture(GL_TEXTURE0 + index));
+        OGL_COUNTED(frame, glBindTexture(GL_TEXTURE_2D, texture ? static_cast<OpenGLTexture2D*>(texture)->texture : 0));
+    });
+}
+
+void OpenGLComputeCommandEncoder::SetStorageTexture(Texture2D* texture, unsigned int index, unsigned int mipLevel) {
+    boundStorageTextures[index] = texture;
+    commandBuffer->counters.textureChangeCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, texture, index, mipLevel]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        if (texture) {
+            OpenGLTexture2D* oglTexture = static_cast<OpenGLTexture2D*>(texture);
+            OGL_COUNTED(frame, glBindImageTexture(index, oglTexture->texture, mipLevel, GL_FALSE, 0, GL_READ_WRITE, oglTexture->internalFormat));
+        } else {
+            OGL_COUNTED(frame, glBindImageTexture(index, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8));
+        }
+    });
+}
+
+void OpenGLComputeCommandEncoder::SetBytes(const void* data, size_t size, unsigned int index) {
+    // Copy the bytes now so the caller's memory does not need to outlive the encoder
+    std::vector<char> bytes(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    commandBuffer->counters.commandBytes += size;
+    commandBuffer->counters.uniformBufferCount++;
+    commandBuffer->counters.uniformBytesUploaded += size;
+    OpenGLCommandBuffer* commandBuffer = this->commandBuffer;
+    commands.push_back([commandBuffer, bytes, index]() {
+        FrameCounters& frame = commandBuffer->device->GetFrameCounters();
+        GLuint ubo;
+        OGL_COUNTED(frame, glGenBuffers(1, &ubo));
+        OGL_COUNTED(frame, glBindBuffer(GL_UNIFORM_BUFFER, ubo));
+        OGL_COUNTED(frame, glBufferData(GL_UNIFORM_BUFFER, bytes.size(), bytes.data(), GL_STREAM_DRAW));
+        OGL_COUNTED(frame, glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo));
+        commandBuffer->tempBuffers.push_back(ubo);
+    });
+}
+
+void OpenGLComputeCommandEncoder::TrackDispatchResources(Buffer* indirectBuffer) {
+    // Reads of anything an earlier dispatch wrote need a barrier first
+    GLbitfield barriers = 0;
+    commandBuffer->RequireBarrier(indirectBuffer, GL_COMMAND_BARRIER_BIT, barriers);
+    for (auto& binding : boundBuffers) {
+        commandBuffer->RequireBarrier(binding.second, GL_SHADER_STORAGE_BARRIER_BIT, barriers);
+    }
+    for (auto& binding : boundTextures) {
+        commandBuffer->RequireBarrier(binding.second, GL_TEXTURE_FETCH_BARRIER_BIT, barriers);
+    }
+    for (auto& binding : boundStorageTextures) {
+        commandBuffer->RequireBarrier(binding.second, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, barriers);
+    }
+    commandBuffer->InsertBarrier(barriers, commands);
+
+    // Storage buffers and images are writable from the compute function; each may next be read
+    // only in the ways its kind of resource can be
+    for (auto& binding : boundBuffers) {
+        commandBuffer->MarkWritten(binding.second, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT |
+            GL_COMMAND_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    for (auto& binding : boundStorageTextures) {
+        commandBuffer->MarkWritten(binding.second, GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+            GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    }
+}
+
+void OpenGLComputeCommandEncoder::DispatchThreadgroups(unsigned int threadgroupsX, unsigned int threadgroupsY, unsigned int threadgroupsZ) {
+    TrackDispatchResources(nullptr);
+    commandBuffer->counters.dispatchCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, threadgroupsX, threadgroupsY, threadgroupsZ]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glDispatchCompute(threadgroupsX, threadgroupsY, threadgroupsZ));
+
+        // Check for OpenGL errors
+        GLenum error = OGL_COUNTED(frame, glGetError());
+        if (error != GL_NO_ERROR) {
+            printf("OpenGL error in DispatchThreadgroups: %d\n", error);
+        }
+    });
+}
+
+void OpenGLComputeCommandEncoder::DispatchIndirect(Buffer* indirectBuffer, unsigned int indirectBufferOffset) {
+    TrackDispatchResources(indirectBuffer);
+    commandBuffer->counters.dispatchCount++;
+    OpenGLRenderDevice* device = commandBuffer->device;
+    commands.push_back([device, indirectBuffer, indirectBufferOffset]() {
+        FrameCounters& frame = device->GetFrameCounters();
+        OGL_COUNTED(frame, glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, static_cast<OpenGLBuffer*>(indirectBuffer)->BO));
+        OGL_COUNTED(frame, glDispatchComputeIndirect(static_cast<GLintptr>(indirectBufferOffset)));
+        OGL_COUNTED(frame, glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0));
+
+        // Check for OpenGL errors
+        GLenum error = OGL_COUNTED(frame, glGetError());
+        if (error != GL_NO_ERROR) {
+            printf("OpenGL error in DispatchIndirect: %d\n", error);
+        }
+    });
+}
+
+void OpenGLComputeCommandEncoder::PushDebugGroup(const char* name) {
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    std::string groupName = name;
+    debugGroupDepth++;
+    commands.push_back([gpuTimer, groupName]() {
+        gpuTimer->Begin(groupName);
+    });
+}
+
+void OpenGLComputeCommandEncoder::PopDebugGroup() {
+    if (debugGroupDepth == 0) {
+        return;
+    }
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    debugGroupDepth--;
+    commands.push_back([gpuTimer]() {
+        gpuTimer->End();
+    });
+}
+
+void OpenGLComputeCommandEncoder::EndEncoding() {
+    // Close the groups left open, then the pass
+    OpenGLGpuTimer* gpuTimer = &commandBuffer->device->GetGpuTimer();
+    unsigned int zoneCount = debugGroupDepth + 1;
+    debugGroupDepth = 0;
+    commands.push_back([gpuTimer, zoneCount]() {
+        for (unsigned int i = 0; i < zoneCount; i++) {
+            gpuTimer->End();
+        }
+    });
+
+    // Transfer all commands to the command buffer
+    commandBuffer->commands.insert(commandBuffer->commands.end(), commands.begin(), commands.end());
+    commands.clear();
+
+    if (commandBuffer->device->GetPerfCounters().IsOpen()) {
+        commandBuffer->device->GetPerfCounters().End(commandBuffer->device->GetFrameCounters());
+    }
+    RENDER_TRACE_END();
+}
+
 } // end namespace render
@@ -3,8 +3,18 @@
 #include "render_device/render_device.h"
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <functional>
-#include <glad/gl.h>
+#include <memory>
+#include <string>
+#include <tuple>
+#include "ogl_frame_statistics.h"
+#include "ogl_gpu_timer.h"
+#include "ogl_perf_counters.h"
+#include "ogl_loader.h"
+#include "ogl_pipeline_manifest.h"
+#include "ogl_program_cache.h"
+#include "ogl_shader_cache.h"
 
 namespace render
 {
@@ -12,25 +22,86 @@ namespace render
 class OpenGLDepthStencilState;
 class OpenGLSamplerState;
 class OpenGLRenderPipelineState;
+class OpenGLComputePipelineState;
 class OpenGLBuffer;
 class OpenGLTexture2D;
+class OpenGLPixelReadback;
+class OpenGLPipelineCompiler;
+class OpenGLFunction;
+struct OpenGLProgramJob;
 
 class OpenGLLibrary : public Library
 {
 public:
 
-	OpenGLLibrary(const char *vertexShaderSource, const char *fragmentShaderSource);
+	// Functions share compiled shaders through shaderCache
+	OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *vertexShaderSource, const char *fragmentShaderSource);
+
+	OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *computeShaderSource);
+
+	// Entry points of one source, compiled here
+	OpenGLLibrary(OpenGLShaderCache *shaderCache, const char *source, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount);
+
+	// Entry points of a SPIR-V module, compiled as functions are created and specialized
+	OpenGLLibrary(OpenGLShaderCache *shaderCache, const std::string &binary, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount);
 
 	~OpenGLLibrary();
 
 	Function *CreateFunction(const FunctionType& functionType, const char *name);
 
+	Function *CreateFunction(const FunctionType& functionType, const char *name, const FunctionConstant *constants, unsigned int constantCount) override;
+
+	void SetVariantKeywords(const char *const *keywords, unsigned int keywordCount) override;
+
+	Function *CreateFunctionVariant(const FunctionType& functionType, const char *name, unsigned long long variantMask) override;
+
 	void DestroyFunction(Function *function);
 
 private:
 
 	char* m_vertexShaderSource = nullptr;
 	char* m_fragmentShaderSource = nullptr;
+	char* m_computeShaderSource = nullptr;
+
+	// The source of a stage of a vertex and fragment or compute library, null if it has none
+	const char *GetStageSource(FunctionType functionType) const;
+
+	OpenGLShaderCache *m_ShaderCache;
+
+	// Feature keywords by variant mask bit
+	std::vector<std::string> m_VariantKeywords;
+
+	// GLSL of the variants made so far, by stage, entry point name and mask
+	std::map<std::tuple<int, std::string, unsigned long long>, std::string> m_VariantSources;
+
+	// The GLSL of a library of entry points, for functions specialized with constants
+	std::string m_Source;
+
+	// A function of the source, holding its compiled shader for functions created from it
+	struct OpenGLEntryPoint
+	{
+		std::string name;
+		OpenGLFunction *function;
+	};
+	std::vector<OpenGLEntryPoint> m_EntryPoints;
+};
+
+// Identifies a framebuffer object by the textures and mip levels attached to it
+struct OpenGLFramebufferKey
+{
+	GLuint colorTextures[8] = {};
+	GLint colorLevels[8] = {};
+	GLuint depthTexture = 0;
+	GLint depthLevel = 0;
+
+	bool operator==(const OpenGLFramebufferKey& other) const;
+
+	bool References(GLuint texture) const;
+};
+
+struct OpenGLFramebufferKeyHash
+{
+	size_t operator()(const OpenGLFramebufferKey& key) const;
 };
 
 class OpenGLRenderDevice : public RenderDevice
@@ -43,12 +114,42 @@ public:
 
 	Library *CreateLibrary(const char *vertexShaderSource, const char *fragmentShaderSource);
 
+	Library *CreateLibrary(const char *computeShaderSource);
+
+	Library *CreateLibrary(const char *source, const LibraryEntryPoint *entryPoints, unsigned int entryPointCount) override;
+
+	Library *CreateLibraryFromSPIRV(const void *words, size_t size, const char *fallbackSource = nullptr) override;
+
 	void DestroyLibrary(Library *library);
 
+	void SetPipelineCacheDirectory(const char *directory) override;
+
 	RenderPipelineState *CreateRenderPipelineState(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL) override;
 
+	RenderPipelineState *CreateRenderPipelineStateAsync(Function *vertexShader, Function *fragmentShader, VertexDescriptor *vertexDescriptor, bool cullEnabled = true, Winding frontFace = WINDING_CCW, Face cullFace = FACE_BACK, RasterMode rasterMode = RASTERMODE_FILL, RenderPipelineState *fallbackPipelineState = nullptr) override;
+
 	void DestroyRenderPipelineState(RenderPipelineState *renderPipelineState) override;
 
+	ComputePipelineState *CreateComputePipelineState(Function *computeShader) override;
+
+	void DestroyComputePipelineState(ComputePipelineState *computePipelineState) override;
+
+	void GetShaderCacheStatistics(ShaderCacheStatistics &statistics) override;
+
+	bool SavePipelineManifest(const char *path) override;
+
+	int PrewarmPipelines(const char *path, bool wait = false) override;
+
+	void GetPrewarmProgress(unsigned int &readyCount, unsigned int &totalCount) override;
+
+	void EndFrame() override;
+
+	void GetFrameGpuTimings(FrameGpuTimings &timings) override;
+
+	void GetFrameStatistics(FrameStatistics &statistics) override;
+
+	bool SetPerfCountersEnabled(bool enabled) override;
+
 	Buffer *CreateBuffer(const render::BufferType& bufferType, long long size, const void *data = nullptr) override;
 
 	void DestroyBuffer(Buffer *buffer) override;
@@ -61,6 +162,8 @@ public:
 
 	Texture2D *CreateTexture2D(int width, int height, const void *data = nullptr) override;
 
+	Texture2D *CreateTexture2D(int width, int height, PixelFormat pixelFormat, int mipLevelCount = 1, const void *data = nullptr) override;
+
 	void DestroyTexture2D(Texture2D *texture2D) override;
 
 	void SetTexture2D(unsigned int slot, Texture2D *texture2D) override;
@@ -113,10 +216,99 @@ public:
 	Drawable* GetNextDrawable() override;
 	void DestroyDrawable(Drawable* drawable) override;
 
+	// Pixel readback
+	PixelReadback* ReadPixelsAsync(Texture2D* texture, int x, int y, int width, int height, PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM) override;
+	PixelReadback* ReadPixelsAsync(Drawable* drawable, int x, int y, int width, int height, PixelFormat pixelFormat = PIXELFORMAT_RGBA8_UNORM) override;
+	void DestroyPixelReadback(PixelReadback* pixelReadback) override;
+
+	// Framebuffer object with the attachments of a render pass, created and validated on first
+	// use and cached after that; 0 (the window) when the pass has no textures attached
+	GLuint GetFramebuffer(const RenderPassDescriptor& desc);
+
+	// Timestamps around passes and debug groups, taken as command buffers execute
+	OpenGLGpuTimer& GetGpuTimer() { return m_GpuTimer; }
+
+	// Counters of the frame under way, for what is only known as commands execute
+	FrameCounters& GetFrameCounters() { return m_FrameStatistics.counters; }
+
+	// Count a committed command buffer's tally into the frame
+	void AddFrameCounters(const FrameCounters& tally) { m_FrameStatistics.Add(tally); }
+
+	OpenGLPerfCounters& GetPerfCounters() { return m_PerfCounters; }
+
+	// Barrier bits not yet issued since each resource was last written by a dispatch. Kept here
+	// rather than per command buffer, as a later command buffer may read what one wrote.
+	std::map<const void*, GLbitfield>& GetPendingBarriers() { return m_PendingBarriers; }
+
+	// Whether indirect draws may take their count from a buffer
+	bool IsIndirectCountSupported() const { return m_IndirectCountSupported; }
+
 private:
 	OpenGLRenderPipelineState *m_RenderPipelineState = nullptr;
 	OpenGLDepthStencilState *m_DepthStencilState = nullptr;
 	OpenGLBuffer *m_VertexBuffer = nullptr;
+
+	// Framebuffer objects by attachment set; entries referencing a texture go when it is destroyed
+	std::unordered_map<OpenGLFramebufferKey, GLuint, OpenGLFramebufferKeyHash> m_Framebuffers;
+
+	// Color textures standing in for the default framebuffer of headless windows
+	std::map<void*, OpenGLTexture2D*> m_DrawableTextures;
+
+	// Queues a copy of a framebuffer region into the next free readback slot
+	PixelReadback* ReadFramebufferAsync(GLuint framebuffer, GLenum readBuffer, int x, int y, int width, int height, PixelFormat pixelFormat);
+
+	// Ring of pixel pack buffers; slots are reused once their readback is destroyed
+	std::vector<OpenGLPixelReadback*> m_PixelReadbacks;
+	size_t m_NextPixelReadback = 0;
+
+	// Program binaries on disk, off unless a directory is set
+	OpenGLProgramCache m_ProgramCache;
+
+	// Builds pipeline states created asynchronously and prewarmed programs; made on first use
+	OpenGLPipelineCompiler *m_PipelineCompiler = nullptr;
+
+	// Every pipeline created, and those of manifests prewarmed, for SavePipelineManifest
+	OpenGLPipelineManifest m_PipelineManifest;
+
+	// Compiled shaders shared by the functions of every library
+	OpenGLShaderCache m_ShaderCache;
+
+	// ARB_gl_spirv or OpenGL 4.6; libraries from SPIR-V use their GLSL fallback without it
+	bool m_SpirvSupported = false;
+
+	// ARB_indirect_parameters or OpenGL 4.6; without it indirect draws issue maxDrawCount draws.
+	// The entry point alone does not say, as proc address lookups return stubs for any name.
+	bool m_IndirectCountSupported = false;
+
+	std::map<const void*, GLbitfield> m_PendingBarriers;
+
+	// A program shared by the pipeline states of the same functions, deleted with the last
+	struct OpenGLSharedProgram
+	{
+		std::shared_ptr<OpenGLProgramJob> job;
+		unsigned int referenceCount = 0;
+		bool prewarmed = false; // the reference is PrewarmPipelines', until a pipeline state takes it over
+	};
+
+	// A reference to the program of the functions, begun on the compiler when async or built
+	// at once; key identifies it to ReleaseProgram
+	std::shared_ptr<OpenGLProgramJob> AcquireProgram(OpenGLFunction *const *functions, int functionCount, bool async, uint64_t &key);
+
+	void ReleaseProgram(uint64_t key);
+
+	// Programs by the hash of their functions' types and sources
+	std::unordered_map<uint64_t, OpenGLSharedProgram> m_Programs;
+	unsigned int m_ProgramHitCount = 0;
+	unsigned int m_ProgramMissCount = 0;
+
+	// Every program prewarmed, taken or not, for GetPrewarmProgress
+	std::vector<std::shared_ptr<OpenGLProgramJob>> m_PrewarmJobs;
+
+	OpenGLGpuTimer m_GpuTimer;
+
+	OpenGLFrameStatistics m_FrameStatistics;
+
+	OpenGLPerfCounters m_PerfCounters;
 };
 
 class OpenGLDrawable : public Drawable
@@ -147,14 +339,31 @@ public:
 	OpenGLCommandBuffer(OpenGLRenderDevice* device);
 	~OpenGLCommandBuffer() override;
 	RenderCommandEncoder* CreateRenderCommandEncoder(const RenderPassDescriptor& desc) override;
+	ComputeCommandEncoder* CreateComputeCommandEncoder() override;
 	void Present(Drawable* drawable) override;
 	void Commit() override;
 protected:
+	// Marks a resource as written by a dispatch; later reads, in this or a later command buffer, through
+	// any of 'barriers' must be preceded by a memory barrier
+	void MarkWritten(const void* resource, GLbitfield barriers);
+	// Accumulates the barrier bits still required before a written resource can be accessed through 'barrier'
+	void RequireBarrier(const void* resource, GLbitfield barrier, GLbitfield& barriers);
+	// Records a glMemoryBarrier for the accumulated bits and retires them from every pending resource
+	void InsertBarrier(GLbitfield barriers, std::vector<std::function<void()>>& encoderCommands);
+
 	OpenGLRenderDevice* device;
 	std::vector<std::function<void()>> commands;
 	bool hasRenderPass = false;
 
+	// Buffers created while executing commands, deleted at the end of Commit
+	std::vector<GLuint> tempBuffers;
+
+	// What recording already knows of the frame counters, with commandBytes holding the data
+	// copied into commands; added to the device's at Commit
+	FrameCounters counters;
+
 	friend class OpenGLRenderCommandEncoder;
+	friend class OpenGLComputeCommandEncoder;
 };
 
 class OpenGLRenderCommandEncoder : public RenderCommandEncoder
@@ -166,6 +375,7 @@ public:
 	// Pipeline and state
 	void SetRenderPipelineState(RenderPipelineState* renderPipelineState) override;
 	void SetDepthStencilState(DepthStencilState* depthStencilState) override;
+	void SetPendingPipelinePolicy(PendingPipelinePolicy policy, RenderPipelineState* fallbackPipelineState = nullptr) override;
 
 	// Resource binding
 	void SetVertexBuffer(Buffer* buffer, unsigned int offset, unsigned int index) override;
@@ -179,6 +389,11 @@ public:
 	// Drawing
 	void Draw(PrimitiveType primitiveType, unsigned int vertexStart, unsigned int vertexCount) override;
 	void DrawIndexed(PrimitiveType primitiveType, unsigned int indexCount, IndexType indexType, unsigned int indexOffset, unsigned int vertexOffset, Buffer* indexBuffer) override;
+	void DrawIndexedIndirect(PrimitiveType primitiveType, IndexType indexType, Buffer* indexBuffer, Buffer* indirectBuffer, unsigned int indirectBufferOffset, unsigned int maxDrawCount, Buffer* drawCountBuffer = nullptr, unsigned int drawCountBufferOffset = 0) override;
+
+	// GPU timing
+	void PushDebugGroup(const char* name) override;
+	void PopDebugGroup() override;
 
 	// End the encoder
 	void EndEncoding() override;
@@ -186,6 +401,13 @@ public:
 	void SetViewport(int x, int y, int width, int height) override;
 
 private:
+	// Records a barrier if a draw would read resources written by an earlier dispatch
+	void InsertDrawBarriers(Buffer* indexBuffer, Buffer* indirectBuffer = nullptr, Buffer* drawCountBuffer = nullptr);
+
+	// The pipeline state a draw executes with under the pending pipeline policy; null when
+	// the current one is not ready and the draw is skipped
+	OpenGLRenderPipelineState* GetDrawPipelineState();
+
 	OpenGLCommandBuffer* commandBuffer;
 	RenderPassDescriptor renderPassDesc;
 	std::vector<std::function<void()>> commands;
@@ -193,6 +415,8 @@ private:
 	// State tracking
 	OpenGLRenderPipelineState* currentRenderPipelineState = nullptr;
 	OpenGLDepthStencilState* currentDepthStencilState = nullptr;
+	PendingPipelinePolicy pendingPipelinePolicy = PENDINGPIPELINEPOLICY_WAIT;
+	OpenGLRenderPipelineState* fallbackPipelineState = nullptr;
 
 	// Resource binding
 	Buffer* currentVertexBuffer = nullptr;
@@ -201,9 +425,55 @@ private:
 	std::map<unsigned int, std::pair<const void*, size_t>> vertexBytes;
 	std::map<unsigned int, std::pair<const void*, size_t>> fragmentBytes;
 
-	// Temporary UBOs for deferred deletion
-	std::vector<GLuint> tempVertexUBOs;
-	std::vector<GLuint> tempFragmentUBOs;
+	// Debug groups pushed and not yet popped
+	unsigned int debugGroupDepth = 0;
+};
+
+class OpenGLComputeCommandEncoder : public ComputeCommandEncoder
+{
+public:
+	OpenGLComputeCommandEncoder(OpenGLCommandBuffer* commandBuffer);
+	~OpenGLComputeCommandEncoder() override;
+
+	// Pipeline state
+	void SetComputePipelineState(ComputePipelineState* computePipelineState) override;
+
+	// Resource binding
+	void SetBuffer(Buffer* buffer, unsigned int offset, unsigned int index) override;
+	void SetTexture(Texture2D* texture, unsigned int index) override;
+	void SetStorageTexture(Texture2D* texture, unsigned int index, unsigned int mipLevel = 0) override;
+
+	// Metal-style parameter setting
+	void SetBytes(const void* data, size_t size, unsigned int index) override;
+
+	// Dispatching
+	void DispatchThreadgroups(unsigned int threadgroupsX, unsigned int threadgroupsY, unsigned int threadgroupsZ) override;
+	void DispatchIndirect(Buffer* indirectBuffer, unsigned int indirectBufferOffset) override;
+
+	// GPU timing
+	void PushDebugGroup(const char* name) override;
+	void PopDebugGroup() override;
+
+	// End the encoder
+	void EndEncoding() override;
+
+private:
+	// Records barriers for reads of bound resources, then marks the writable ones as written
+	void TrackDispatchResources(Buffer* indirectBuffer);
+
+	OpenGLCommandBuffer* commandBuffer;
+	std::vector<std::function<void()>> commands;
+
+	// State tracking
+	OpenGLComputePipelineState* currentComputePipelineState = nullptr;
+
+	// Resource binding
+	std::map<unsigned int, Buffer*> boundBuffers;
+	std::map<unsigned int, Texture2D*> boundTextures;
+	std::map<unsigned int, Texture2D*> boundStorageTextures;
+
+	// Debug groups pushed and not yet popped
+	unsigned int debugGroupDepth = 0;
 };
 
 } // end namespace render
@@ -0,0 +1,44 @@
+#include "ogl_shader_cache.h"
+
+namespace render
+{
+
+OpenGLShaderCache::~OpenGLShaderCache()
+{
+	for(auto &shader : m_Shaders)
+		glDeleteShader(shader.second.shader);
+}
+
+GLuint OpenGLShaderCache::Find(uint64_t key)
+{
+	auto entry = m_Shaders.find(key);
+	if(entry == m_Shaders.end())
+	{
+		m_MissCount++;
+		return 0;
+	}
+
+	m_HitCount++;
+	entry->second.referenceCount++;
+	return entry->second.shader;
+}
+
+void OpenGLShaderCache::Add(uint64_t key, GLuint shader)
+{
+	Entry &entry = m_Shaders[key];
+	entry.shader = shader;
+	entry.referenceCount = 1;
+}
+
+void OpenGLShaderCache::Release(uint64_t key)
+{
+	auto entry = m_Shaders.find(key);
+	if(entry == m_Shaders.end() || --entry->second.referenceCount > 0)
+		return;
+
+	// a shader still attached to a program linking in parallel goes once it is detached
+	glDeleteShader(entry->second.shader);
+	m_Shaders.erase(entry);
+}
+
+} // end namespace render
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ogl_loader.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace render
+{
+
+// Compiled shader objects shared by every function compiled from the same content, so a
+// source is compiled once however many libraries and functions are made from it. Each
+// function holds a reference; the shader is deleted when the last one is released.
+// Used from the device's thread only.
+class OpenGLShaderCache
+{
+public:
+
+	~OpenGLShaderCache();
+
+	// The shader stored under key, taking a reference to it; 0 on a miss, when the caller
+	// compiles the shader and adds it
+	GLuint Find(uint64_t key);
+
+	// Store a shader just compiled, with the caller's reference to it
+	void Add(uint64_t key, GLuint shader);
+
+	void Release(uint64_t key);
+
+	unsigned int GetHitCount() const { return m_HitCount; }
+
+	unsigned int GetMissCount() const { return m_MissCount; }
+
+	unsigned int GetShaderCount() const { return static_cast<unsigned int>(m_Shaders.size()); }
+
+private:
+
+	struct Entry
+	{
+		GLuint shader = 0;
+		unsigned int referenceCount = 0;
+	};
+
+	std::unordered_map<uint64_t, Entry> m_Shaders;
+
+	unsigned int m_HitCount = 0;
+	unsigned int m_MissCount = 0;
+};
+
+} // end namespace render
@@ -0,0 +1,314 @@
+#include "render_device/platform.h"
+
+#include "../platform_backend.h"
+
+#include <glad/gl.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace platform
+{
+
+// A headless window is only an OpenGL context, plus a pbuffer when the display cannot make a context current without one
+struct EglWindow
+{
+	EGLContext context = EGL_NO_CONTEXT;
+	EGLSurface surface = EGL_NO_SURFACE;
+	int width = 0;
+	int height = 0;
+	bool shouldClose = false;
+};
+
+class EglPlatform : public PlatformBackend
+{
+public:
+
+	bool InitPlatform() override;
+
+	PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title) override;
+
+	PLATFORM_WINDOW_REF CreatePlatformSharedContext(PLATFORM_WINDOW_REF window) override;
+
+	bool PollPlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	void ClosePlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	PLATFORM_WINDOW_REF GetCurrentPlatformWindow() override;
+
+	void MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window) override;
+
+	void GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height) override;
+
+	void GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection) override;
+
+	void PresentPlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	void *GetPlatformProcAddress(const char *name) override;
+
+	void TerminatePlatform() override;
+
+private:
+
+	EGLDisplay m_Display = EGL_NO_DISPLAY;
+	EGLConfig m_Config = nullptr;
+	bool m_SurfacelessContext = false;
+	bool m_GladLoaded = false;
+
+	// windows may be created from any thread
+	std::mutex m_Mutex;
+	std::vector<EglWindow *> m_Windows;
+};
+
+// EGL tracks the current context per thread, and so does the platform
+static thread_local EglWindow *s_CurrentWindow = nullptr;
+
+PlatformBackend *CreateEglPlatform()
+{
+	return new EglPlatform;
+}
+
+static bool HasExtension(const char *extensions, const char *name)
+{
+	if(!extensions)
+		return false;
+
+	size_t length = std::strlen(name);
+	for(const char *start = extensions; (start = std::strstr(start, name)) != nullptr; start += length)
+	{
+		if((start == extensions || start[-1] == ' ') && (start[length] == ' ' || start[length] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+bool EglPlatform::InitPlatform()
+{
+	// Mesa's surfaceless platform needs neither a display server nor a GPU (llvmpipe renders on the CPU)
+	const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if(HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if(getPlatformDisplay)
+			m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if(m_Display == EGL_NO_DISPLAY)
+		m_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if(m_Display == EGL_NO_DISPLAY || !eglInitialize(m_Display, &major, &minor))
+	{
+		std::cout << "Failed to initialize EGL" << std::endl;
+		return false;
+	}
+
+	if(!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "EGL display does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	// Without EGL_KHR_surfaceless_context every context is made current on a pbuffer
+	m_SurfacelessContext = HasExtension(eglQueryString(m_Display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+	EGLint configCount = 0;
+	if(!eglChooseConfig(m_Display, configAttributes, &m_Config, 1, &configCount) || configCount == 0)
+	{
+		std::cout << "Failed to find an EGL config" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+PLATFORM_WINDOW_REF EglPlatform::CreatePlatformWindow(int width, int height, const char *title)
+{
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3, // required for compute shaders
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	// the client API is per thread, and this may not be the thread that initialized the platform
+	eglBindAPI(EGL_OPENGL_API);
+
+	// contexts share no objects, like GLFW windows created without a share window, so
+	// contexts driven from different threads never contend for a shared object namespace
+	EglWindow *window = new EglWindow;
+	window->width = width;
+	window->height = height;
+	window->context = eglCreateContext(m_Display, m_Config, EGL_NO_CONTEXT, contextAttributes);
+	if(window->context == EGL_NO_CONTEXT)
+	{
+		std::cout << "Failed to create EGL context for " << title << std::endl;
+		delete window;
+		return 0;
+	}
+
+	if(!m_SurfacelessContext)
+	{
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+		window->surface = eglCreatePbufferSurface(m_Display, m_Config, surfaceAttributes);
+	}
+
+	if(!eglMakeCurrent(m_Display, window->surface, window->surface, window->context))
+	{
+		std::cout << "Failed to make the EGL context current" << std::endl;
+		if(window->surface != EGL_NO_SURFACE)
+			eglDestroySurface(m_Display, window->surface);
+		eglDestroyContext(m_Display, window->context);
+		delete window;
+		return 0;
+	}
+
+	s_CurrentWindow = window;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Windows.push_back(window);
+
+	// glad: load all OpenGL function pointers, which are the same for every context of the display
+	// ---------------------------------------------------------------------------------------------
+	if(!m_GladLoaded)
+	{
+		if(!gladLoadGL((GLADloadfunc)eglGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return 0;
+		}
+		m_GladLoaded = true;
+	}
+
+	return (PLATFORM_WINDOW_REF)window;
+}
+
+PLATFORM_WINDOW_REF EglPlatform::CreatePlatformSharedContext(PLATFORM_WINDOW_REF window)
+{
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	EglWindow *sharedWindow = static_cast<EglWindow *>(window);
+	EglWindow *context = new EglWindow;
+	context->width = 1;
+	context->height = 1;
+	context->context = eglCreateContext(m_Display, m_Config, sharedWindow->context, contextAttributes);
+	if(context->context == EGL_NO_CONTEXT)
+	{
+		std::cout << "Failed to create a shared EGL context" << std::endl;
+		delete context;
+		return 0;
+	}
+
+	if(!m_SurfacelessContext)
+	{
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		context->surface = eglCreatePbufferSurface(m_Display, m_Config, surfaceAttributes);
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Windows.push_back(context);
+
+	return (PLATFORM_WINDOW_REF)context;
+}
+
+bool EglPlatform::PollPlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	// no events arrive without a display; the application decides when it is done
+	return !static_cast<EglWindow *>(window)->shouldClose;
+}
+
+void EglPlatform::ClosePlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	static_cast<EglWindow *>(window)->shouldClose = true;
+}
+
+PLATFORM_WINDOW_REF EglPlatform::GetCurrentPlatformWindow()
+{
+	return (PLATFORM_WINDOW_REF)s_CurrentWindow;
+}
+
+void EglPlatform::MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window)
+{
+	EglWindow *eglWindow = static_cast<EglWindow *>(window);
+
+	eglBindAPI(EGL_OPENGL_API);
+	if(eglWindow)
+		eglMakeCurrent(m_Display, eglWindow->surface, eglWindow->surface, eglWindow->context);
+	else
+		eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	s_CurrentWindow = eglWindow;
+}
+
+void EglPlatform::GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height)
+{
+	width = static_cast<EglWindow *>(window)->width;
+	height = static_cast<EglWindow *>(window)->height;
+}
+
+void EglPlatform::GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+{
+	// the same starting camera as a window, without a trackball to move it
+	int width = 1, height = 1;
+	if(window)
+		GetPlatformWindowSize(window, width, height);
+
+	model = glm::mat4(1);
+	view = glm::translate(glm::mat4(1), glm::vec3(0, 0, -3));
+	projection = glm::perspective(glm::radians(45.0f), static_cast<float>(width) / static_cast<float>(height), 0.1f, 100.f);
+}
+
+void EglPlatform::PresentPlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	// nothing to show; drawables are offscreen textures read back by the application
+}
+
+void *EglPlatform::GetPlatformProcAddress(const char *name)
+{
+	return (void *)eglGetProcAddress(name);
+}
+
+void EglPlatform::TerminatePlatform()
+{
+	eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	s_CurrentWindow = nullptr;
+
+	for(EglWindow *window : m_Windows)
+	{
+		if(window->surface != EGL_NO_SURFACE)
+			eglDestroySurface(m_Display, window->surface);
+		eglDestroyContext(m_Display, window->context);
+		delete window;
+	}
+	m_Windows.clear();
+
+	eglTerminate(m_Display);
+	eglReleaseThread();
+}
+
+} // end namespace platform
@@ -1,5 +1,7 @@
 #include "render_device/platform.h"
 
+#include "../platform_backend.h"
+
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
@@ -9,35 +11,45 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <iostream>
+#include <vector>
 
 namespace platform
 {
 
-static float s_Width;
-static float s_Height;
-static glm::mat4 s_Projection(glm::uninitialize);
+// Trackball camera of one window, driven by that window's input callbacks
+struct GlfwWindowState
+{
+	float width = 0.0f;
+	float height = 0.0f;
+	glm::mat4 projection = glm::mat4(1);
 
-static glm::mat3 s_LastModel(1);
-static glm::mat3 s_Model(1);
+	glm::mat3 lastModel = glm::mat3(1);
+	glm::mat3 model = glm::mat3(1);
 
-static glm::vec3 s_BegVec(0);
-static glm::vec3 s_EndVec(0);
-static float s_AdjustWidth;
-static float s_AdjustHeight;
+	glm::vec3 begVec = glm::vec3(0);
+	glm::vec3 endVec = glm::vec3(0);
+	float adjustWidth = 0.0f;
+	float adjustHeight = 0.0f;
 
-static glm::vec2 s_MousePt;
-static bool s_isDragging = false;
+	glm::vec2 mousePt = glm::vec2(0);
+	bool isDragging = false;
 
-static glm::mat4 s_View = glm::translate(glm::mat4(1), glm::vec3(0, 0, -3));
+	glm::mat4 view = glm::translate(glm::mat4(1), glm::vec3(0, 0, -3));
+};
 
-static void SetBounds(float width, float height)
+static GlfwWindowState *GetWindowState(GLFWwindow *window)
+{
+	return static_cast<GlfwWindowState *>(glfwGetWindowUserPointer(window));
+}
+
+static void SetBounds(GlfwWindowState *state, float width, float height)
 {
 	// Set adjustment factor for width/height
-    s_AdjustWidth  = 1.0f / ((width  - 1.0f) * 0.5f);
-    s_AdjustHeight = 1.0f / ((height - 1.0f) * 0.5f);
+    state->adjustWidth  = 1.0f / ((width  - 1.0f) * 0.5f);
+    state->adjustHeight = 1.0f / ((height - 1.0f) * 0.5f);
 }
 
-static void MapToSphere(const glm::vec2 &pt, glm::vec3 &vec)
+static void MapToSphere(const GlfwWindowState *state, const glm::vec2 &pt, glm::vec3 &vec)
 {
     glm::vec2 tempPt;
     float length;
@@ -46,8 +58,8 @@ static void MapToSphere(const glm::vec2 &pt, glm::vec3 &vec)
     tempPt = pt;
 
     // Adjust point coords and scale down to range of [-1 ... 1]
-    tempPt.x =        (tempPt.x * s_AdjustWidth) - 1.0f;
-    tempPt.y = 1.0f - (tempPt.y * s_AdjustHeight);
+    tempPt.x =        (tempPt.x * state->adjustWidth) - 1.0f;
+    tempPt.y = 1.0f - (tempPt.y * state->adjustHeight);
 
     // Compute the square of the length of the vector to the point from the center
     length = (tempPt.x * tempPt.x) + (tempPt.y * tempPt.y);
@@ -72,33 +84,78 @@ static void MapToSphere(const glm::vec2 &pt, glm::vec3 &vec)
     }
 }
 
-void InitPlatform()
+class GlfwPlatform : public PlatformBackend
+{
+public:
+
+	bool InitPlatform() override;
+
+	PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title) override;
+
+	PLATFORM_WINDOW_REF CreatePlatformSharedContext(PLATFORM_WINDOW_REF window) override;
+
+	bool PollPlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	void ClosePlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	PLATFORM_WINDOW_REF GetCurrentPlatformWindow() override;
+
+	void MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window) override;
+
+	void GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height) override;
+
+	void GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection) override;
+
+	void PresentPlatformWindow(PLATFORM_WINDOW_REF window) override;
+
+	void *GetPlatformProcAddress(const char *name) override;
+
+	void TerminatePlatform() override;
+
+private:
+
+	std::vector<GlfwWindowState *> m_WindowStates;
+};
+
+PlatformBackend *CreateGlfwPlatform()
+{
+	return new GlfwPlatform;
+}
+
+bool GlfwPlatform::InitPlatform()
 {
 	// glfw: initialize and configure
     // ------------------------------
-    glfwInit();
+    if(!glfwInit())
+		return false;
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1); // highest version available on OS X
+#else
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // required for compute shaders
+#endif
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // required on OS X
+
+	return true;
 }
 
-static void set_viewport_size(int width, int height)
+static void set_viewport_size(GlfwWindowState *state, int width, int height)
 {
-	s_Width = static_cast<float>(width);
-	s_Height = static_cast<float>(height);
+	state->width = static_cast<float>(width);
+	state->height = static_cast<float>(height);
 
-	SetBounds(s_Width, s_Height);
+	SetBounds(state, state->width, state->height);
 
-	s_Projection = glm::perspective(glm::radians(45.0f), static_cast<float>(s_Width) / static_cast<float>(s_Height), 0.1f, 100.f);
+	state->projection = glm::perspective(glm::radians(45.0f), static_cast<float>(state->width) / static_cast<float>(state->height), 0.1f, 100.f);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 static void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
-	set_viewport_size(width, height);
+	set_viewport_size(GetWindowState(window), width, height);
 
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
@@ -107,40 +164,44 @@ static void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 
 static void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
 {
+	GlfwWindowState *state = GetWindowState(window);
+
 	if(action == GLFW_PRESS)
 	{
 		if(button == GLFW_MOUSE_BUTTON_RIGHT)
 		{
-			s_LastModel = glm::mat3(1);
+			state->lastModel = glm::mat3(1);
 
-			s_Model = glm::mat3(1);
+			state->model = glm::mat3(1);
 		}
 		else if(button == GLFW_MOUSE_BUTTON_LEFT)
 		{
-			s_isDragging = true;
-			s_LastModel = s_Model;
-			MapToSphere(s_MousePt, s_BegVec);
+			state->isDragging = true;
+			state->lastModel = state->model;
+			MapToSphere(state, state->mousePt, state->begVec);
 		}
 	}
 	else if(action == GLFW_RELEASE)
 	{
 		if(button == GLFW_MOUSE_BUTTON_LEFT)
-			s_isDragging = false;
+			state->isDragging = false;
 	}
 }
 
 static void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
 {
-	s_MousePt.x = static_cast<float>(xpos);
-	s_MousePt.y = static_cast<float>(ypos);
+	GlfwWindowState *state = GetWindowState(window);
+
+	state->mousePt.x = static_cast<float>(xpos);
+	state->mousePt.y = static_cast<float>(ypos);
 
-	if(s_isDragging)
+	if(state->isDragging)
 	{
 		// Map the point to the sphere
-		MapToSphere(s_MousePt, s_EndVec);
+		MapToSphere(state, state->mousePt, state->endVec);
 
 		// Compute the vector perpendicular to the begin and end vectors
-		glm::vec3 perp = glm::cross(s_BegVec, s_EndVec);
+		glm::vec3 perp = glm::cross(state->begVec, state->endVec);
 
 		glm::quat quat;
 		if(glm::length(perp) > 1.0e-5) // if the length of the perpendicular vector non-zero
@@ -150,7 +211,7 @@ static void cursor_position_callback(GLFWwindow *window, double xpos, double ypo
 			quat.z = perp.z;
 
 			// In the quaternion values, w is cosine (theta / 2), where theta is rotation angle
-			quat.w = glm::dot(s_BegVec, s_EndVec);
+			quat.w = glm::dot(state->begVec, state->endVec);
 		}
 		else // if its zero
 		{
@@ -158,19 +219,17 @@ static void cursor_position_callback(GLFWwindow *window, double xpos, double ypo
 			quat.x = quat.y = quat.z = quat.w = 0.0f;
 		}
 
-		s_Model = glm::mat3_cast(quat) * s_LastModel;
+		state->model = glm::mat3_cast(quat) * state->lastModel;
 	}
 }
 
 static void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 {
-	s_View[3][2] += yoffset;
+	GetWindowState(window)->view[3][2] += yoffset;
 }
 
-PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title)
+PLATFORM_WINDOW_REF GlfwPlatform::CreatePlatformWindow(int width, int height, const char *title)
 {
-	set_viewport_size(width, height);
-
 	// glfw window creation
     // --------------------
     GLFWwindow *window = glfwCreateWindow(width, height, title, NULL, NULL);
@@ -180,6 +239,12 @@ PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *titl
 		glfwTerminate();
 		return 0;
     }
+
+	GlfwWindowState *state = new GlfwWindowState;
+	set_viewport_size(state, width, height);
+	m_WindowStates.push_back(state);
+	glfwSetWindowUserPointer(window, state);
+
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
@@ -197,7 +262,19 @@ PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *titl
 	return (PLATFORM_WINDOW_REF)window;
 }
 
-bool PollPlatformWindow(PLATFORM_WINDOW_REF window)
+PLATFORM_WINDOW_REF GlfwPlatform::CreatePlatformSharedContext(PLATFORM_WINDOW_REF window)
+{
+	// GLFW contexts come with a window; this one is never shown
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow *context = glfwCreateWindow(1, 1, "", NULL, (GLFWwindow *)window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if(!context)
+		std::cout << "Failed to create a shared GLFW context" << std::endl;
+
+	return (PLATFORM_WINDOW_REF)context;
+}
+
+bool GlfwPlatform::PollPlatformWindow(PLATFORM_WINDOW_REF window)
 {
 	// glfw: poll IO events (keys pressed/released, mouse moved etc.)
 	glfwPollEvents();
@@ -209,25 +286,58 @@ bool PollPlatformWindow(PLATFORM_WINDOW_REF window)
 	return !glfwWindowShouldClose((GLFWwindow *)window);
 }
 
-void GetPlatformViewport(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+void GlfwPlatform::ClosePlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	glfwSetWindowShouldClose((GLFWwindow *)window, true);
+}
+
+PLATFORM_WINDOW_REF GlfwPlatform::GetCurrentPlatformWindow()
 {
-	model = s_Model;
-	view = s_View;
-	projection = s_Projection;
+	return (PLATFORM_WINDOW_REF)glfwGetCurrentContext();
 }
 
-void PresentPlatformWindow(PLATFORM_WINDOW_REF window)
+void GlfwPlatform::MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window)
+{
+	glfwMakeContextCurrent((GLFWwindow *)window);
+}
+
+void GlfwPlatform::GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height)
+{
+	glfwGetFramebufferSize((GLFWwindow *)window, &width, &height);
+}
+
+void GlfwPlatform::GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+{
+	// the starting camera when there is no window to ask
+	GlfwWindowState defaultState;
+	GlfwWindowState *state = window ? GetWindowState((GLFWwindow *)window) : &defaultState;
+
+	model = state->model;
+	view = state->view;
+	projection = state->projection;
+}
+
+void GlfwPlatform::PresentPlatformWindow(PLATFORM_WINDOW_REF window)
 {
 	// glfw: swap buffers
     // -------------------------------------------------------------------------------
     glfwSwapBuffers((GLFWwindow *)window);
 }
 
-void TerminatePlatform()
+void *GlfwPlatform::GetPlatformProcAddress(const char *name)
+{
+	return (void *)glfwGetProcAddress(name);
+}
+
+void GlfwPlatform::TerminatePlatform()
 {
 	// glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
+
+	for(GlfwWindowState *state : m_WindowStates)
+		delete state;
+	m_WindowStates.clear();
 }
 
 } // end namespace platform
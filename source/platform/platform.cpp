@@ -0,0 +1,127 @@
+#include "render_device/platform.h"
+
+#include "platform_backend.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace platform
+{
+
+static PlatformBackend *s_Backend = nullptr;
+static PlatformType s_PlatformType = PLATFORMTYPE_AUTO;
+
+static PlatformType ResolvePlatformType(PlatformType platformType)
+{
+	if(platformType != PLATFORMTYPE_AUTO)
+		return platformType;
+
+	const char *requested = std::getenv("RENDER_DEVICE_PLATFORM");
+	if(requested && std::strcmp(requested, "headless") == 0)
+		return PLATFORMTYPE_HEADLESS;
+	if(requested && std::strcmp(requested, "windowed") == 0)
+		return PLATFORMTYPE_WINDOWED;
+
+#if defined(RENDER_DEVICE_HAS_EGL)
+	// render farm nodes have neither an X11 nor a Wayland display
+	if(!std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY"))
+		return PLATFORMTYPE_HEADLESS;
+#endif
+
+	return PLATFORMTYPE_WINDOWED;
+}
+
+void InitPlatform(PlatformType platformType)
+{
+	s_PlatformType = ResolvePlatformType(platformType);
+
+#if defined(RENDER_DEVICE_HAS_EGL)
+	if(s_PlatformType == PLATFORMTYPE_HEADLESS)
+		s_Backend = CreateEglPlatform();
+#else
+	if(s_PlatformType == PLATFORMTYPE_HEADLESS)
+	{
+		std::cout << "Headless platform unavailable in this build, using windows" << std::endl;
+		s_PlatformType = PLATFORMTYPE_WINDOWED;
+	}
+#endif
+
+	if(s_PlatformType == PLATFORMTYPE_WINDOWED)
+		s_Backend = CreateGlfwPlatform();
+
+	if(!s_Backend->InitPlatform())
+		std::cout << "Failed to initialize the platform" << std::endl;
+}
+
+PlatformType GetPlatformType()
+{
+	return s_PlatformType;
+}
+
+PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title)
+{
+	return s_Backend->CreatePlatformWindow(width, height, title);
+}
+
+PLATFORM_WINDOW_REF CreatePlatformSharedContext(PLATFORM_WINDOW_REF window)
+{
+	return s_Backend->CreatePlatformSharedContext(window);
+}
+
+bool PollPlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	return s_Backend->PollPlatformWindow(window);
+}
+
+void ClosePlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	s_Backend->ClosePlatformWindow(window);
+}
+
+PLATFORM_WINDOW_REF GetCurrentPlatformWindow()
+{
+	return s_Backend ? s_Backend->GetCurrentPlatformWindow() : nullptr;
+}
+
+void MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window)
+{
+	s_Backend->MakePlatformWindowCurrent(window);
+}
+
+void GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height)
+{
+	s_Backend->GetPlatformWindowSize(window, width, height);
+}
+
+void GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+{
+	s_Backend->GetPlatformViewport(window, model, view, projection);
+}
+
+void GetPlatformViewport(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+{
+	s_Backend->GetPlatformViewport(s_Backend->GetCurrentPlatformWindow(), model, view, projection);
+}
+
+void PresentPlatformWindow(PLATFORM_WINDOW_REF window)
+{
+	s_Backend->PresentPlatformWindow(window);
+}
+
+void *GetPlatformProcAddress(const char *name)
+{
+	return s_Backend ? s_Backend->GetPlatformProcAddress(name) : nullptr;
+}
+
+void TerminatePlatform()
+{
+	if(s_Backend)
+	{
+		s_Backend->TerminatePlatform();
+		delete s_Backend;
+		s_Backend = nullptr;
+	}
+}
+
+} // end namespace platform
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "render_device/platform.h"
+
+namespace platform
+{
+
+// A windowing and context creation backend behind the platform functions
+class PlatformBackend
+{
+public:
+
+	// virtual destructor to ensure subclasses have a virtual destructor
+	virtual ~PlatformBackend() {}
+
+	virtual bool InitPlatform() = 0;
+
+	virtual PLATFORM_WINDOW_REF CreatePlatformWindow(int width, int height, const char *title) = 0;
+
+	virtual PLATFORM_WINDOW_REF CreatePlatformSharedContext(PLATFORM_WINDOW_REF window) = 0;
+
+	virtual bool PollPlatformWindow(PLATFORM_WINDOW_REF window) = 0;
+
+	virtual void ClosePlatformWindow(PLATFORM_WINDOW_REF window) = 0;
+
+	virtual PLATFORM_WINDOW_REF GetCurrentPlatformWindow() = 0;
+
+	virtual void MakePlatformWindowCurrent(PLATFORM_WINDOW_REF window) = 0;
+
+	virtual void GetPlatformWindowSize(PLATFORM_WINDOW_REF window, int &width, int &height) = 0;
+
+	virtual void GetPlatformViewport(PLATFORM_WINDOW_REF window, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection) = 0;
+
+	virtual void PresentPlatformWindow(PLATFORM_WINDOW_REF window) = 0;
+
+	virtual void *GetPlatformProcAddress(const char *name) = 0;
+
+	virtual void TerminatePlatform() = 0;
+
+protected:
+
+	// protected default constructor to ensure these are never created directly
+	PlatformBackend() {}
+};
+
+PlatformBackend *CreateGlfwPlatform();
+
+#ifdef RENDER_DEVICE_HAS_EGL
+PlatformBackend *CreateEglPlatform();
+#endif
+
+} // end namespace platform
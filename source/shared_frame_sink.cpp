@@ -0,0 +1,292 @@
+#include "render_device/shared_frame_sink.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace render
+{
+
+static const uint32_t kSharedFrameMagic = 0x52444653; // "RDFS"
+static const uint32_t kSharedFrameVersion = 1;
+static const size_t kSlotAlignment = 4096;
+
+// Start of the shared region. Each position is written by one side only and sits on its
+// own cache line; the signal beside it is bumped after every update for futex waits.
+struct SharedFrameHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t reserved;
+	uint64_t slotSize;
+	uint64_t slotOffset;
+
+	alignas(64) std::atomic<uint64_t> writeIndex;
+	std::atomic<uint32_t> writeSignal;
+
+	alignas(64) std::atomic<uint64_t> readIndex;
+	std::atomic<uint32_t> readSignal;
+
+	// followed by slotCount SharedFrameInfo descriptors, then the slots
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared memory positions need lock-free atomics");
+
+static SharedFrameInfo *GetDescriptors(SharedFrameHeader *header)
+{
+	return reinterpret_cast<SharedFrameInfo *>(header + 1);
+}
+
+static unsigned char *GetSlot(SharedFrameHeader *header, uint64_t index)
+{
+	return reinterpret_cast<unsigned char *>(header) + header->slotOffset + (index % header->slotCount) * header->slotSize;
+}
+
+static uint64_t GetMonotonicNanoseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+// Sleep while signal still reads expected; shared, not private, since the other side is another process
+static void FutexWait(std::atomic<uint32_t> &signal, uint32_t expected, const timespec *timeout)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&signal), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t> &signal)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&signal), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+// Wait until ready() holds, for at most timeoutMilliseconds (negative waits forever)
+template<typename Predicate>
+static bool WaitUntil(std::atomic<uint32_t> &signal, int timeoutMilliseconds, Predicate ready)
+{
+	uint64_t deadline = GetMonotonicNanoseconds() + static_cast<uint64_t>(timeoutMilliseconds) * 1000000ull;
+	for(;;)
+	{
+		// read the signal before the condition, so an update in between makes the wait return at once
+		uint32_t expected = signal.load(std::memory_order_acquire);
+		if(ready())
+			return true;
+		if(timeoutMilliseconds == 0)
+			return false;
+
+		if(timeoutMilliseconds < 0)
+			FutexWait(signal, expected, nullptr);
+		else
+		{
+			uint64_t now = GetMonotonicNanoseconds();
+			if(now >= deadline)
+				return ready();
+			timespec remaining;
+			remaining.tv_sec = static_cast<time_t>((deadline - now) / 1000000000ull);
+			remaining.tv_nsec = static_cast<long>((deadline - now) % 1000000000ull);
+			FutexWait(signal, expected, &remaining);
+		}
+	}
+}
+
+SharedFrameSink *SharedFrameSink::Create(const char *name, unsigned int slotCount, size_t slotSize)
+{
+	if(slotCount == 0 || slotSize == 0)
+		return nullptr;
+
+	slotSize = (slotSize + kSlotAlignment - 1) / kSlotAlignment * kSlotAlignment;
+	size_t slotOffset = sizeof(SharedFrameHeader) + sizeof(SharedFrameInfo) * slotCount;
+	slotOffset = (slotOffset + kSlotAlignment - 1) / kSlotAlignment * kSlotAlignment;
+	size_t mappingSize = slotOffset + slotSize * slotCount;
+
+	int fileDescriptor = static_cast<int>(syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+	if(fileDescriptor < 0)
+	{
+		printf("ERROR::SHAREDFRAMESINK::MEMFD_CREATE_FAILED %s\n", strerror(errno));
+		return nullptr;
+	}
+
+	// sealing the size lets consumers trust the mapping never shrinks under them
+	if(ftruncate(fileDescriptor, static_cast<off_t>(mappingSize)) != 0 || fcntl(fileDescriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0)
+	{
+		printf("ERROR::SHAREDFRAMESINK::RESIZE_FAILED %s\n", strerror(errno));
+		close(fileDescriptor);
+		return nullptr;
+	}
+
+	void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if(mapping == MAP_FAILED)
+	{
+		printf("ERROR::SHAREDFRAMESINK::MMAP_FAILED %s\n", strerror(errno));
+		close(fileDescriptor);
+		return nullptr;
+	}
+
+	// the file starts zeroed, so only the fields that are not zero are written
+	SharedFrameHeader *header = new(mapping) SharedFrameHeader;
+	header->version = kSharedFrameVersion;
+	header->slotCount = slotCount;
+	header->slotSize = slotSize;
+	header->slotOffset = slotOffset;
+	header->writeIndex.store(0, std::memory_order_relaxed);
+	header->readIndex.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = kSharedFrameMagic;
+
+	SharedFrameSink *sink = new SharedFrameSink;
+	sink->m_FileDescriptor = fileDescriptor;
+	sink->m_Mapping = mapping;
+	sink->m_MappingSize = mappingSize;
+	sink->m_SlotSize = slotSize;
+	return sink;
+}
+
+SharedFrameSink::~SharedFrameSink()
+{
+	munmap(m_Mapping, m_MappingSize);
+	close(m_FileDescriptor);
+}
+
+void *SharedFrameSink::BeginFrame(int timeoutMilliseconds)
+{
+	SharedFrameHeader *header = static_cast<SharedFrameHeader *>(m_Mapping);
+
+	bool slotFree = WaitUntil(header->readSignal, timeoutMilliseconds, [&]()
+	{
+		return m_WriteIndex - header->readIndex.load(std::memory_order_acquire) < header->slotCount;
+	});
+	if(!slotFree)
+	{
+		m_DroppedFrameCount++;
+		return nullptr;
+	}
+
+	m_FrameBegun = true;
+	return GetSlot(header, m_WriteIndex);
+}
+
+void SharedFrameSink::EndFrame(const SharedFrameInfo &info)
+{
+	if(!m_FrameBegun)
+		return;
+
+	SharedFrameHeader *header = static_cast<SharedFrameHeader *>(m_Mapping);
+	SharedFrameInfo &descriptor = GetDescriptors(header)[m_WriteIndex % header->slotCount];
+	descriptor = info;
+	if(descriptor.size > m_SlotSize)
+	{
+		printf("ERROR::SHAREDFRAMESINK::FRAME_TOO_LARGE %llu > %zu\n", static_cast<unsigned long long>(descriptor.size), m_SlotSize);
+		descriptor.size = m_SlotSize;
+	}
+	if(descriptor.timestamp == 0)
+		descriptor.timestamp = GetMonotonicNanoseconds();
+
+	// the release orders the slot data and descriptor before the position the consumer polls
+	m_WriteIndex++;
+	header->writeIndex.store(m_WriteIndex, std::memory_order_release);
+	header->writeSignal.fetch_add(1, std::memory_order_release);
+	FutexWake(header->writeSignal);
+	m_FrameBegun = false;
+}
+
+bool SharedFrameSink::WriteFrame(const void *data, const SharedFrameInfo &info, int timeoutMilliseconds)
+{
+	if(info.size > m_SlotSize)
+	{
+		printf("ERROR::SHAREDFRAMESINK::FRAME_TOO_LARGE %llu > %zu\n", static_cast<unsigned long long>(info.size), m_SlotSize);
+		return false;
+	}
+
+	void *slot = BeginFrame(timeoutMilliseconds);
+	if(!slot)
+		return false;
+
+	memcpy(slot, data, info.size);
+	EndFrame(info);
+	return true;
+}
+
+SharedFrameSource *SharedFrameSource::Open(int fileDescriptor)
+{
+	struct stat status;
+	if(fstat(fileDescriptor, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(SharedFrameHeader))
+		return nullptr;
+
+	size_t mappingSize = static_cast<size_t>(status.st_size);
+	void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if(mapping == MAP_FAILED)
+	{
+		printf("ERROR::SHAREDFRAMESOURCE::MMAP_FAILED %s\n", strerror(errno));
+		return nullptr;
+	}
+
+	SharedFrameHeader *header = static_cast<SharedFrameHeader *>(mapping);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(header->magic != kSharedFrameMagic || header->version != kSharedFrameVersion || header->slotCount == 0 ||
+		header->slotOffset + header->slotSize * header->slotCount > mappingSize)
+	{
+		printf("ERROR::SHAREDFRAMESOURCE::INVALID_REGION\n");
+		munmap(mapping, mappingSize);
+		return nullptr;
+	}
+
+	SharedFrameSource *source = new SharedFrameSource;
+	source->m_Mapping = mapping;
+	source->m_MappingSize = mappingSize;
+	source->m_SlotSize = header->slotSize;
+	source->m_ReadIndex = header->readIndex.load(std::memory_order_acquire);
+	return source;
+}
+
+SharedFrameSource::~SharedFrameSource()
+{
+	munmap(m_Mapping, m_MappingSize);
+}
+
+const void *SharedFrameSource::AcquireFrame(SharedFrameInfo &info, int timeoutMilliseconds)
+{
+	SharedFrameHeader *header = static_cast<SharedFrameHeader *>(m_Mapping);
+
+	bool frameReady = WaitUntil(header->writeSignal, timeoutMilliseconds, [&]()
+	{
+		return header->writeIndex.load(std::memory_order_acquire) != m_ReadIndex;
+	});
+	if(!frameReady)
+		return nullptr;
+
+	info = GetDescriptors(header)[m_ReadIndex % header->slotCount];
+	// the producer's descriptor is not trusted to stay within the slot validated by Open
+	if(info.size > m_SlotSize)
+	{
+		printf("ERROR::SHAREDFRAMESOURCE::FRAME_TOO_LARGE %llu > %llu\n", static_cast<unsigned long long>(info.size), static_cast<unsigned long long>(m_SlotSize));
+		info.size = m_SlotSize;
+	}
+	m_FrameAcquired = true;
+	return GetSlot(header, m_ReadIndex);
+}
+
+void SharedFrameSource::ReleaseFrame()
+{
+	if(!m_FrameAcquired)
+		return;
+
+	SharedFrameHeader *header = static_cast<SharedFrameHeader *>(m_Mapping);
+	m_ReadIndex++;
+	header->readIndex.store(m_ReadIndex, std::memory_order_release);
+	header->readSignal.fetch_add(1, std::memory_order_release);
+	FutexWake(header->readSignal);
+	m_FrameAcquired = false;
+}
+
+} // end namespace render
@@ -0,0 +1,114 @@
+#include "render_device/thread_pool.h"
+
+#include <atomic>
+
+namespace render
+{
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if(threadCount == 0)
+	{
+		unsigned int hardwareThreadCount = std::thread::hardware_concurrency();
+		threadCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+	}
+
+	for(unsigned int i = 0; i < threadCount; i++)
+		m_Threads.push_back(std::thread(&ThreadPool::WorkerMain, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	for(std::thread &thread : m_Threads)
+		thread.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Idle.wait(lock, [this] { return m_Tasks.empty() && m_RunningTaskCount == 0; });
+}
+
+void ThreadPool::ParallelFor(unsigned int taskCount, const std::function<void(unsigned int)> &task)
+{
+	if(taskCount == 0)
+		return;
+
+	// workers and the caller pull indices until they run out, so uneven tasks balance themselves
+	struct SharedState
+	{
+		std::atomic<unsigned int> nextIndex;
+		unsigned int remainingHelpers;
+		std::mutex mutex;
+		std::condition_variable finished;
+	} state;
+	state.nextIndex = 0;
+
+	auto run = [&state, &task, taskCount]()
+	{
+		for(unsigned int i = state.nextIndex++; i < taskCount; i = state.nextIndex++)
+			task(i);
+	};
+
+	unsigned int helperCount = taskCount - 1 < GetThreadCount() ? taskCount - 1 : GetThreadCount();
+	state.remainingHelpers = helperCount;
+	for(unsigned int i = 0; i < helperCount; i++)
+	{
+		Submit([&state, &run]()
+		{
+			run();
+
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if(--state.remainingHelpers == 0)
+				state.finished.notify_one();
+		});
+	}
+
+	run();
+
+	// helpers reference this stack frame, so wait for all of them even if the work is done
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.finished.wait(lock, [&state] { return state.remainingHelpers == 0; });
+}
+
+void ThreadPool::WorkerMain()
+{
+	for(;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_TaskAvailable.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+			if(m_Tasks.empty())
+				return; // stopping with nothing left to do
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+			m_RunningTaskCount++;
+		}
+
+		task();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_RunningTaskCount--;
+		if(m_Tasks.empty() && m_RunningTaskCount == 0)
+			m_Idle.notify_all();
+	}
+}
+
+} // end namespace render
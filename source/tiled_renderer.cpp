@@ -0,0 +1,191 @@
+#include "render_device/tiled_renderer.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+// A tile whose pixels are still on their way back from the GPU
+struct PendingTile
+{
+	PixelReadback *readback;
+	uint32_t band;
+	uint32_t x;
+	uint32_t columns;
+	uint32_t rows;
+	bool lastInBand;
+};
+
+TiledRenderer::TiledRenderer(RenderDevice *renderDevice, int tileWidth, int tileHeight)
+: m_RenderDevice(renderDevice), m_TileWidth(tileWidth), m_TileHeight(tileHeight)
+{
+	m_ColorTexture = m_RenderDevice->CreateTexture2D(m_TileWidth, m_TileHeight, PIXELFORMAT_RGBA8_UNORM);
+	m_DepthTexture = m_RenderDevice->CreateTexture2D(m_TileWidth, m_TileHeight, PIXELFORMAT_DEPTH32_FLOAT);
+}
+
+TiledRenderer::~TiledRenderer()
+{
+	m_RenderDevice->DestroyTexture2D(m_DepthTexture);
+	m_RenderDevice->DestroyTexture2D(m_ColorTexture);
+}
+
+void TiledRenderer::SetClearColor(float red, float green, float blue, float alpha)
+{
+	m_ClearColor[0] = red;
+	m_ClearColor[1] = green;
+	m_ClearColor[2] = blue;
+	m_ClearColor[3] = alpha;
+}
+
+glm::mat4 TiledRenderer::GetTileProjection(const glm::mat4 &projection, uint32_t width, uint32_t height, int x, int y, int tileWidth, int tileHeight)
+{
+	// scale the tile's part of normalized device coordinates up to [-1, 1]; applied in clip
+	// space, before the divide, this narrows the frustum to the tile for any projection
+	double scaleX = static_cast<double>(width) / tileWidth;
+	double scaleY = static_cast<double>(height) / tileHeight;
+	double centerX = (2.0 * x + tileWidth) / width - 1.0;
+	double centerY = (2.0 * y + tileHeight) / height - 1.0;
+
+	glm::mat4 tileTransform(1.0f);
+	tileTransform[0][0] = static_cast<float>(scaleX);
+	tileTransform[1][1] = static_cast<float>(scaleY);
+	tileTransform[3][0] = static_cast<float>(-scaleX * centerX);
+	tileTransform[3][1] = static_cast<float>(-scaleY * centerY);
+	return tileTransform * projection;
+}
+
+bool TiledRenderer::Render(CommandQueue *commandQueue, const char *path, ImageFileFormat format, uint32_t width, uint32_t height,
+	const glm::mat4 &projection, const DrawFunction &draw)
+{
+	ImageStreamWriter *writer = ImageStreamWriter::Create(path, format, width, height);
+	if(!writer)
+		return false;
+
+	uint32_t tileWidth = static_cast<uint32_t>(m_TileWidth);
+	uint32_t tileHeight = static_cast<uint32_t>(m_TileHeight);
+	uint32_t bandCount = (height + tileHeight - 1) / tileHeight;
+	uint32_t tilesPerBand = (width + tileWidth - 1) / tileWidth;
+	size_t rowSize = static_cast<size_t>(width) * 4;
+
+	// two bands: one being written to disk while the next is assembled
+	std::vector<unsigned char> bands[2];
+	bands[0].resize(rowSize * tileHeight);
+	bands[1].resize(rowSize * tileHeight);
+	uint32_t bandRowsToWrite[2] = { 0, 0 }; // non-zero while a band waits for or is being written
+	bool rendering = true, writeFailed = false;
+	std::mutex mutex;
+	std::condition_variable bandChanged;
+
+	std::thread writerThread([&]()
+	{
+		for(uint32_t band = 0; ; band++)
+		{
+			uint32_t rows;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				bandChanged.wait(lock, [&]() { return bandRowsToWrite[band % 2] > 0 || !rendering; });
+				rows = bandRowsToWrite[band % 2];
+				if(rows == 0)
+					break;
+			}
+
+			bool written = writer->WriteRows(bands[band % 2].data(), static_cast<ptrdiff_t>(rowSize), rows);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				bandRowsToWrite[band % 2] = 0;
+				writeFailed |= !written;
+			}
+			bandChanged.notify_all();
+		}
+	});
+
+	// copy a tile into its band, flipping it top-down, and pass on the band it completes
+	auto collectTile = [&](const PendingTile &tile)
+	{
+		const unsigned char *data = static_cast<const unsigned char *>(tile.readback->GetData());
+		unsigned char *band = bands[tile.band % 2].data();
+		size_t tileRowSize = static_cast<size_t>(tile.columns) * 4;
+		for(uint32_t row = 0; row < tile.rows; row++)
+			memcpy(band + row * rowSize + tile.x * 4, data + (tileHeight - 1 - row) * tileRowSize, tileRowSize);
+		m_RenderDevice->DestroyPixelReadback(tile.readback);
+
+		if(tile.lastInBand)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				bandRowsToWrite[tile.band % 2] = tile.rows;
+			}
+			bandChanged.notify_all();
+		}
+	};
+
+	RenderPassDescriptor renderPassDescriptor;
+	renderPassDescriptor.colorAttachments[0].texture = m_ColorTexture;
+	memcpy(renderPassDescriptor.colorAttachments[0].clearColor, m_ClearColor, sizeof(m_ClearColor));
+	renderPassDescriptor.depthAttachment.texture = m_DepthTexture;
+
+	std::deque<PendingTile> pendingTiles;
+	for(uint32_t band = 0; band < bandCount; band++)
+	{
+		// wait for the writer to finish with the band this one replaces
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			bandChanged.wait(lock, [&]() { return bandRowsToWrite[band % 2] == 0; });
+			if(writeFailed)
+				break;
+		}
+
+		uint32_t top = band * tileHeight;
+		uint32_t rows = height - top < tileHeight ? height - top : tileHeight;
+		for(uint32_t tileIndex = 0; tileIndex < tilesPerBand; tileIndex++)
+		{
+			uint32_t x = tileIndex * tileWidth;
+			uint32_t columns = width - x < tileWidth ? width - x : tileWidth;
+
+			// edge tiles render a whole tile hanging off the image and keep only the inside
+			int bottom = static_cast<int>(height) - static_cast<int>(top) - m_TileHeight;
+			glm::mat4 tileProjection = GetTileProjection(projection, width, height, static_cast<int>(x), bottom, m_TileWidth, m_TileHeight);
+
+			CommandBuffer *commandBuffer = commandQueue->CreateCommandBuffer();
+			RenderCommandEncoder *encoder = commandBuffer->CreateRenderCommandEncoder(renderPassDescriptor);
+			draw(encoder, tileProjection);
+			encoder->EndEncoding();
+			commandBuffer->Commit();
+			delete encoder;
+			delete commandBuffer;
+
+			PendingTile tile = { m_RenderDevice->ReadPixelsAsync(m_ColorTexture, 0, 0, static_cast<int>(columns), m_TileHeight),
+				band, x, columns, rows, tileIndex + 1 == tilesPerBand };
+			pendingTiles.push_back(tile);
+
+			// keep one tile in flight behind the one just queued
+			if(pendingTiles.size() > 1)
+			{
+				collectTile(pendingTiles.front());
+				pendingTiles.pop_front();
+			}
+		}
+	}
+
+	for(const PendingTile &tile : pendingTiles)
+		collectTile(tile);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		rendering = false;
+	}
+	bandChanged.notify_all();
+	writerThread.join();
+
+	bool finished = writer->Finish();
+	delete writer;
+	return finished && !writeFailed;
+}
+
+} // end namespace render
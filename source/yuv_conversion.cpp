@@ -0,0 +1,284 @@
+#include "render_device/yuv_conversion.h"
+#include "render_device/thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YUV_SIMD_SSE2 1
+#endif
+
+namespace render
+{
+
+static const int kRowPairsPerTask = 32;
+
+// One thread per output texel, i.e. per four bytes of the frame
+static const char *conversionShaderSource = "#version 430 core\n"
+	"layout(local_size_x = 8, local_size_y = 8) in;\n"
+	"layout(binding = 0) uniform sampler2D source;\n"
+	"layout(rgba8, binding = 0) writeonly uniform image2D destination;\n"
+	"layout(std140, binding = 0) uniform YuvParams {\n"
+	"   ivec2 size;\n"
+	"   int interleavedChroma;\n"
+	"};\n"
+	"// the source is bottom-up like every render target, the frame top-down\n"
+	"ivec3 Fetch(ivec2 pixel)\n"
+	"{\n"
+	"   vec3 color = texelFetch(source, ivec2(pixel.x, size.y - 1 - pixel.y), 0).rgb;\n"
+	"   return ivec3(round(clamp(color, 0.0, 1.0) * 255.0));\n"
+	"}\n"
+	"int Luma(ivec3 c)\n"
+	"{\n"
+	"   return ((66 * c.r + 129 * c.g + 25 * c.b + 128) >> 8) + 16;\n"
+	"}\n"
+	"// (U, V) of the 2x2 block of a chroma sample\n"
+	"ivec2 Chroma(ivec2 chromaTexel)\n"
+	"{\n"
+	"   ivec2 pixel = chromaTexel * 2;\n"
+	"   ivec3 c = (Fetch(pixel) + Fetch(pixel + ivec2(1, 0)) + Fetch(pixel + ivec2(0, 1)) + Fetch(pixel + ivec2(1, 1)) + 2) >> 2;\n"
+	"   return ivec2(((-38 * c.r - 74 * c.g + 112 * c.b + 128) >> 8) + 128,\n"
+	"                ((112 * c.r - 94 * c.g - 18 * c.b + 128) >> 8) + 128);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"   ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+	"   if(texel.x >= size.x / 4 || texel.y >= size.y * 3 / 2)\n"
+	"      return;\n"
+	"   int offset = texel.y * size.x + texel.x * 4;\n"
+	"   int lumaSize = size.x * size.y;\n"
+	"   ivec4 bytes;\n"
+	"   if(offset < lumaSize)\n"
+	"   {\n"
+	"      ivec2 pixel = ivec2(offset % size.x, offset / size.x);\n"
+	"      for(int i = 0; i < 4; i++)\n"
+	"         bytes[i] = Luma(Fetch(pixel + ivec2(i, 0)));\n"
+	"   }\n"
+	"   else if(interleavedChroma != 0)\n"
+	"   {\n"
+	"      offset -= lumaSize;\n"
+	"      ivec2 chromaTexel = ivec2((offset % size.x) / 2, offset / size.x);\n"
+	"      bytes.xy = Chroma(chromaTexel);\n"
+	"      bytes.zw = Chroma(chromaTexel + ivec2(1, 0));\n"
+	"   }\n"
+	"   else\n"
+	"   {\n"
+	"      offset -= lumaSize;\n"
+	"      int plane = offset / (lumaSize / 4);\n"
+	"      offset -= plane * (lumaSize / 4);\n"
+	"      ivec2 chromaTexel = ivec2(offset % (size.x / 2), offset / (size.x / 2));\n"
+	"      for(int i = 0; i < 4; i++)\n"
+	"         bytes[i] = Chroma(chromaTexel + ivec2(i, 0))[plane];\n"
+	"   }\n"
+	"   imageStore(destination, texel, vec4(bytes) / 255.0);\n"
+	"}\n";
+
+// Matches the std140 YuvParams block above
+struct YuvParams
+{
+	int size[2];
+	int interleavedChroma;
+	int padding;
+};
+
+static inline unsigned char Luma(int r, int g, int b)
+{
+	return static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline unsigned char ChromaU(int r, int g, int b)
+{
+	return static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline unsigned char ChromaV(int r, int g, int b)
+{
+	return static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Convert pixels [begin, end) of two rows; u and v advance by chromaStep per sample,
+// which is 2 when they point into an interleaved NV12 plane
+static void ConvertRowPairScalar(const unsigned char *row0, const unsigned char *row1, int begin, int end, unsigned char *luma0, unsigned char *luma1, unsigned char *u, unsigned char *v, int chromaStep)
+{
+	for(int x = begin; x < end; x += 2)
+	{
+		const unsigned char *a = row0 + x * 4;
+		const unsigned char *b = row1 + x * 4;
+		luma0[x] = Luma(a[0], a[1], a[2]);
+		luma0[x + 1] = Luma(a[4], a[5], a[6]);
+		luma1[x] = Luma(b[0], b[1], b[2]);
+		luma1[x + 1] = Luma(b[4], b[5], b[6]);
+
+		int r = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+		int g = (a[1] + a[5] + b[1] + b[5] + 2) >> 2;
+		int bl = (a[2] + a[6] + b[2] + b[6] + 2) >> 2;
+		u[(x / 2) * chromaStep] = ChromaU(r, g, bl);
+		v[(x / 2) * chromaStep] = ChromaV(r, g, bl);
+	}
+}
+
+#if defined(YUV_SIMD_SSE2)
+
+// Each 32 bit lane holds one pixel. Masking splits it into the 16 bit pairs (R, B) and
+// (G, A), so a multiply-add against a pair of coefficients weighs two channels at once.
+static inline __m128i Coefficients(short low, short high)
+{
+	return _mm_set_epi16(high, low, high, low, high, low, high, low);
+}
+
+static inline __m128i Weigh(__m128i rb, __m128i ga, __m128i rbCoefficients, __m128i gCoefficient, int offset)
+{
+	__m128i sum = _mm_add_epi32(_mm_madd_epi16(rb, rbCoefficients), _mm_madd_epi16(ga, gCoefficient));
+	return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8), _mm_set1_epi32(offset));
+}
+
+static inline __m128i LumaOf4(__m128i pixels)
+{
+	const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+	__m128i rb = _mm_and_si128(pixels, mask);
+	__m128i ga = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+	return Weigh(rb, ga, Coefficients(66, 25), Coefficients(129, 0), 16);
+}
+
+// Average the 2x2 blocks of 4 pixels from each row into 2 chroma samples of (R, B) and (G, A) pairs
+static inline void Average2x2(__m128i a0, __m128i a1, __m128i b0, __m128i b1, __m128i &rb, __m128i &ga)
+{
+	const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+	__m128i rb0 = _mm_add_epi16(_mm_and_si128(a0, mask), _mm_and_si128(b0, mask));
+	__m128i rb1 = _mm_add_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask));
+	__m128i ga0 = _mm_add_epi16(_mm_and_si128(_mm_srli_epi32(a0, 8), mask), _mm_and_si128(_mm_srli_epi32(b0, 8), mask));
+	__m128i ga1 = _mm_add_epi16(_mm_and_si128(_mm_srli_epi32(a1, 8), mask), _mm_and_si128(_mm_srli_epi32(b1, 8), mask));
+
+	// add the even and odd columns
+	__m128i rbEven = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(rb0), _mm_castsi128_ps(rb1), _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i rbOdd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(rb0), _mm_castsi128_ps(rb1), _MM_SHUFFLE(3, 1, 3, 1)));
+	__m128i gaEven = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(ga0), _mm_castsi128_ps(ga1), _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i gaOdd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(ga0), _mm_castsi128_ps(ga1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+	const __m128i two = _mm_set1_epi16(2);
+	rb = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(rbEven, rbOdd), two), 2);
+	ga = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(gaEven, gaOdd), two), 2);
+}
+
+// Sixteen pixels of two rows per iteration, the remainder in scalar code
+static void ConvertRowPair(const unsigned char *row0, const unsigned char *row1, int width, unsigned char *luma0, unsigned char *luma1, unsigned char *u, unsigned char *v, int chromaStep)
+{
+	int x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		__m128i a[4], b[4];
+		for(int i = 0; i < 4; i++)
+		{
+			a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 4) + i);
+			b[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 4) + i);
+		}
+
+		__m128i luma0Words = _mm_packs_epi32(LumaOf4(a[0]), LumaOf4(a[1]));
+		__m128i luma0Words1 = _mm_packs_epi32(LumaOf4(a[2]), LumaOf4(a[3]));
+		__m128i luma1Words = _mm_packs_epi32(LumaOf4(b[0]), LumaOf4(b[1]));
+		__m128i luma1Words1 = _mm_packs_epi32(LumaOf4(b[2]), LumaOf4(b[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(luma0 + x), _mm_packus_epi16(luma0Words, luma0Words1));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(luma1 + x), _mm_packus_epi16(luma1Words, luma1Words1));
+
+		__m128i rb0, ga0, rb1, ga1;
+		Average2x2(a[0], a[1], b[0], b[1], rb0, ga0);
+		Average2x2(a[2], a[3], b[2], b[3], rb1, ga1);
+		__m128i uWords = _mm_packs_epi32(Weigh(rb0, ga0, Coefficients(-38, 112), Coefficients(-74, 0), 128), Weigh(rb1, ga1, Coefficients(-38, 112), Coefficients(-74, 0), 128));
+		__m128i vWords = _mm_packs_epi32(Weigh(rb0, ga0, Coefficients(112, -18), Coefficients(-94, 0), 128), Weigh(rb1, ga1, Coefficients(112, -18), Coefficients(-94, 0), 128));
+		__m128i uBytes = _mm_packus_epi16(uWords, uWords);
+		__m128i vBytes = _mm_packus_epi16(vWords, vWords);
+		if(chromaStep == 2)
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm_unpacklo_epi8(uBytes, vBytes));
+		else
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2), uBytes);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2), vBytes);
+		}
+	}
+	ConvertRowPairScalar(row0, row1, x, width, luma0, luma1, u, v, chromaStep);
+}
+
+#else
+
+static void ConvertRowPair(const unsigned char *row0, const unsigned char *row1, int width, unsigned char *luma0, unsigned char *luma1, unsigned char *u, unsigned char *v, int chromaStep)
+{
+	ConvertRowPairScalar(row0, row1, 0, width, luma0, luma1, u, v, chromaStep);
+}
+
+#endif
+
+void ConvertRgbaToYuv(const unsigned char *rgba, ptrdiff_t rgbaStride, int width, int height, YuvLayout layout, unsigned char *yuv, ThreadPool *threadPool)
+{
+	unsigned char *lumaPlane = yuv;
+	unsigned char *chromaPlane = yuv + static_cast<size_t>(width) * height;
+	int rowPairCount = height / 2;
+
+	std::function<void(unsigned int)> convertTask = [=](unsigned int taskIndex)
+	{
+		int end = static_cast<int>(taskIndex + 1) * kRowPairsPerTask;
+		for(int pair = static_cast<int>(taskIndex) * kRowPairsPerTask; pair < end && pair < rowPairCount; pair++)
+		{
+			const unsigned char *row0 = rgba + rgbaStride * (pair * 2);
+			unsigned char *luma0 = lumaPlane + static_cast<size_t>(width) * (pair * 2);
+			if(layout == YUVLAYOUT_NV12)
+			{
+				unsigned char *uv = chromaPlane + static_cast<size_t>(width) * pair;
+				ConvertRowPair(row0, row0 + rgbaStride, width, luma0, luma0 + width, uv, uv + 1, 2);
+			}
+			else
+			{
+				unsigned char *u = chromaPlane + static_cast<size_t>(width / 2) * pair;
+				unsigned char *v = u + static_cast<size_t>(width / 2) * rowPairCount;
+				ConvertRowPair(row0, row0 + rgbaStride, width, luma0, luma0 + width, u, v, 1);
+			}
+		}
+	};
+
+	unsigned int taskCount = static_cast<unsigned int>((rowPairCount + kRowPairsPerTask - 1) / kRowPairsPerTask);
+	if(threadPool)
+		threadPool->ParallelFor(taskCount, convertTask);
+	else
+	{
+		for(unsigned int i = 0; i < taskCount; i++)
+			convertTask(i);
+	}
+}
+
+YuvConversionPass::YuvConversionPass(RenderDevice *renderDevice, int width, int height, YuvLayout layout)
+: m_RenderDevice(renderDevice), m_Width(width), m_Height(height), m_Layout(layout)
+{
+	m_Library = m_RenderDevice->CreateLibrary(conversionShaderSource);
+	m_Function = m_Library->CreateFunction(FUNCTIONTYPE_COMPUTE, "main");
+	m_PipelineState = m_RenderDevice->CreateComputePipelineState(m_Function);
+
+	m_OutputTexture = m_RenderDevice->CreateTexture2D(m_Width / 4, m_Height * 3 / 2, PIXELFORMAT_RGBA8_UNORM);
+}
+
+YuvConversionPass::~YuvConversionPass()
+{
+	m_RenderDevice->DestroyTexture2D(m_OutputTexture);
+
+	m_RenderDevice->DestroyComputePipelineState(m_PipelineState);
+	m_Library->DestroyFunction(m_Function);
+	m_RenderDevice->DestroyLibrary(m_Library);
+}
+
+void YuvConversionPass::Encode(ComputeCommandEncoder *encoder, Texture2D *colorTexture)
+{
+	YuvParams params;
+	params.size[0] = m_Width;
+	params.size[1] = m_Height;
+	params.interleavedChroma = m_Layout == YUVLAYOUT_NV12 ? 1 : 0;
+	params.padding = 0;
+
+	encoder->SetComputePipelineState(m_PipelineState);
+	encoder->SetTexture(colorTexture, 0);
+	encoder->SetStorageTexture(m_OutputTexture, 0);
+	encoder->SetBytes(&params, sizeof(params), 0);
+	encoder->DispatchThreadgroups((m_Width / 4 + 7) / 8, (m_Height * 3 / 2 + 7) / 8, 1);
+}
+
+PixelReadback *YuvConversionPass::ReadAsync()
+{
+	return m_RenderDevice->ReadPixelsAsync(m_OutputTexture, 0, 0, m_Width / 4, m_Height * 3 / 2);
+}
+
+} // end namespace render